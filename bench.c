@@ -0,0 +1,76 @@
+#include <bench.h>
+#include <interrupt.h>
+#include <serial.h>
+#include <cpu.h>
+#include <io.h>
+
+/* defined by kernel.ld */
+extern bench_t _bench_start[];
+extern bench_t _bench_end[];
+
+static uint32_t samples[BENCH_REPS];
+
+static void bench_sort(uint32_t* values, uint32_t count)
+{
+  uint32_t i, j, value;
+
+  for (i = 1; i < count; i++) {
+    value = values[i];
+    for (j = i; j > 0 && values[j - 1] > value; j--) {
+      values[j] = values[j - 1];
+    }
+    values[j] = value;
+  }
+}
+
+static void bench_run(bench_t* bench)
+{
+  uint64_t start;
+  uint32_t k, p99;
+
+  for (k = 0; k < BENCH_WARMUP; k++) {
+    bench->run(bench->iterations);
+  }
+
+  for (k = 0; k < BENCH_REPS; k++) {
+    interrupts_disable();
+    start = rdtsc();
+    bench->run(bench->iterations);
+    samples[k] = (uint32_t)(rdtsc() - start);
+    interrupts_enable();
+  }
+
+  bench_sort(samples, BENCH_REPS);
+  p99 = (BENCH_REPS * 99 + 99) / 100 - 1;
+
+  serial_print("bench %s %u %u %u\n", bench->name,
+    samples[0] / bench->iterations,
+    samples[BENCH_REPS / 2] / bench->iterations,
+    samples[p99] / bench->iterations);
+}
+
+void bench_run_all()
+{
+  bench_t* bench;
+
+  if (!cpu_has(CPU_FEATURE_TSC)) {
+    serial_print("# no TSC, no benchmarks\n");
+    return;
+  }
+
+  serial_print("# name min median p99, TSC cycles per operation at %u kHz\n", cpu_info.tsc_khz);
+  for (bench = _bench_start; bench < _bench_end; bench++) {
+    bench_run(bench);
+  }
+  serial_print("# end of benchmarks\n");
+}
+
+void bench_exit(uint8_t code)
+{
+  outportb(BENCH_EXIT_PORT, code);
+
+  /* still here, so not in QEMU */
+  while (1) {
+    __asm__ __volatile__ ("cli; hlt");
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/* runs thrown away before measuring, to warm caches and TLBs */
+#define BENCH_WARMUP 16
+
+/* measured runs per benchmark */
+#define BENCH_REPS 128
+
+/* QEMU's isa-debug-exit device, see "make bench" */
+#define BENCH_EXIT_PORT 0xF4
+
+typedef void (*bench_fn_t)(uint32_t iterations);
+
+typedef struct {
+  char* name;
+  bench_fn_t run;
+  uint32_t iterations; /* operations per run; results are per operation */
+} bench_t;
+
+/*
+  Registers a benchmark; the body does the measured operation
+  "iterations" times:
+
+    BENCH(memset_64, 1000)
+    {
+      while (iterations--) {
+        memset(buf, 0, 64);
+      }
+    }
+
+  Entries are collected in the .bench section by kernel.ld, as an array;
+  the explicit alignment keeps the compiler from padding them apart.
+ */
+#define BENCH(label, count) \
+  static void bench_##label(uint32_t iterations); \
+  static bench_t bench_entry_##label \
+    __attribute__((section(".bench"), used, aligned(__alignof__(bench_t)))) = \
+    { #label, bench_##label, count }; \
+  static void bench_##label(uint32_t iterations)
+
+/*
+  Runs every registered benchmark with interrupts disabled, writing a
+  line per benchmark to serial:
+
+    bench <name> <min> <median> <p99>
+
+  in TSC cycles per operation.
+ */
+void bench_run_all();
+
+/* ends the emulator with exit status (code << 1) | 1; halts on real hardware */
+void bench_exit(uint8_t code);
+
+#endif
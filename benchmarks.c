@@ -0,0 +1,144 @@
+#include <bench.h>
+#include <interrupt.h>
+#include <memory.h>
+#include <string.h>
+#include <screen.h>
+#include <frame.h>
+#include <slab.h>
+#include <fat.h>
+#include <virtio_blk.h>
+
+/* the benchmarks "make bench" runs; see bench.h */
+
+static uint8_t source[PAGE_SIZE];
+static uint8_t destination[PAGE_SIZE];
+/* where results go, so the calls are not optimized away */
+static volatile uint32_t sink;
+
+BENCH(memcpy_64, 256)
+{
+  while (iterations--) {
+    memcpy(destination, source, 64);
+  }
+}
+
+BENCH(memcpy_4096, 16)
+{
+  while (iterations--) {
+    memcpy(destination, source, PAGE_SIZE);
+  }
+}
+
+BENCH(memset_64, 256)
+{
+  while (iterations--) {
+    memset(destination, 0, 64);
+  }
+}
+
+BENCH(memset_4096, 16)
+{
+  while (iterations--) {
+    memset(destination, 0, PAGE_SIZE);
+  }
+}
+
+/* a FAT directory entry's 8.3 name, the most common compare */
+BENCH(memcmp_11, 256)
+{
+  static const uint8_t name[] = "KERNEL  BIN";
+  while (iterations--) {
+    sink = memcmp(source, name, 11);
+  }
+}
+
+BENCH(memchr_4096, 16)
+{
+  while (iterations--) {
+    sink = (uint32_t)memchr(source, 1, PAGE_SIZE);
+  }
+}
+
+BENCH(strlen_64, 256)
+{
+  static const char s[] = "The quick brown fox jumps over the lazy dog, and then some more.";
+  while (iterations--) {
+    sink = strlen(s);
+  }
+}
+
+BENCH(strcmp_64, 256)
+{
+  static const char a[] = "The quick brown fox jumps over the lazy dog, and then some more.";
+  static const char b[] = "The quick brown fox jumps over the lazy dog, and then some more!";
+  while (iterations--) {
+    sink = strcmp(a, b);
+  }
+}
+
+/* a page worth of entries, most of a floppy's FAT */
+BENCH(fat12_unpack_2048, 16)
+{
+  while (iterations--) {
+    fat12_unpack(source, (uint16_t*)destination, PAGE_SIZE / sizeof(uint16_t));
+  }
+}
+
+/* four requests of 64 KB in flight together; "make bench" attaches the disk */
+static uint8_t disk_buffer[64 * PAGE_SIZE];
+
+BENCH(virtio_blk_read_256k, 4)
+{
+  while (iterations-- && virtio_blk_capacity()) {
+    virtio_blk_transfer(0, disk_buffer, sizeof(disk_buffer) / VIRTIO_BLK_SECTOR, 0);
+  }
+}
+
+/* a full line, so every run scrolls */
+BENCH(console_line, 4)
+{
+  while (iterations--) {
+    printstr("The quick brown fox jumps over the lazy dog, then prints a newline.\n");
+  }
+}
+
+static void breakpoint(trap_frame_t* frame)
+{
+  /* nothing, the round trip is what we measure */
+}
+
+/* "int $3" into the kernel and back through isr_common */
+BENCH(interrupt_round_trip, 64)
+{
+  interrupt_register(EXCEPTION_BREAKPOINT, breakpoint);
+  while (iterations--) {
+    __asm__ __volatile__ ("int $3");
+  }
+  interrupt_register(EXCEPTION_BREAKPOINT, 0);
+}
+
+BENCH(frame_alloc_free, 64)
+{
+  while (iterations--) {
+    uint32_t frame = frame_alloc();
+    if (frame) {
+      frame_unref(frame);
+    }
+  }
+}
+
+/* a 64 byte object, from this CPU's magazine and back */
+BENCH(slab_alloc_free, 64)
+{
+  static slab_cache_t cache;
+
+  if (!cache.size) {
+    slab_cache_init(&cache, 64);
+  }
+  while (iterations--) {
+    void* object = slab_alloc(&cache);
+    if (object) {
+      slab_free(&cache, object);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#include <boot.h>
+#include <frame.h>
+
+#define MEMORY_HIGH 0x100000
+
+boot_info_t boot_info;
+
+static void copy_string(char* dest, const char* src, uint32_t size)
+{
+  uint32_t k;
+  for (k = 0; k + 1 < size && src[k]; k++) {
+    dest[k] = src[k];
+  }
+  dest[k] = 0;
+}
+
+/* the end of the available region that starts at 1 MB, 0 if there is none */
+static uint32_t multiboot_memory_top(multiboot_info_t* info)
+{
+  uint32_t address = info->memory_map;
+  uint32_t end = info->memory_map + info->memory_map_length;
+  multiboot_memory_t* region;
+
+  for (; address < end; address += region->size + sizeof(region->size)) {
+    region = (multiboot_memory_t*)address;
+    if (region->type != MULTIBOOT_MEMORY_AVAILABLE ||
+        region->base > MEMORY_HIGH || region->base + region->length <= MEMORY_HIGH) {
+      continue;
+    }
+    /* all we manage is far below 4 GB anyway */
+    return region->base + region->length > 0xFFFFF000 ? 0xFFFFF000 : (uint32_t)(region->base + region->length);
+  }
+  return 0;
+}
+
+static void boot_multiboot(multiboot_info_t* info)
+{
+  boot_info.loader = BOOT_LOADER_MULTIBOOT;
+
+  if (info->flags & MULTIBOOT_INFO_MEMORY_MAP) {
+    boot_info.memory_top = multiboot_memory_top(info);
+  }
+  if (!boot_info.memory_top && (info->flags & MULTIBOOT_INFO_MEMORY)) {
+    boot_info.memory_top = MEMORY_HIGH + info->memory_upper * 1024;
+  }
+  if (info->flags & MULTIBOOT_INFO_COMMAND_LINE) {
+    copy_string(boot_info.command_line, (char*)info->command_line, BOOT_COMMAND_LINE);
+  }
+  if (info->flags & MULTIBOOT_INFO_LOADER_NAME) {
+    copy_string(boot_info.name, (char*)info->loader_name, BOOT_NAME);
+  } else {
+    copy_string(boot_info.name, "multiboot", BOOT_NAME);
+  }
+}
+
+void init_boot(uint32_t magic, uint32_t info)
+{
+  if (magic == BOOT_MULTIBOOT_MAGIC) {
+    boot_multiboot((multiboot_info_t*)info);
+  } else if (magic == BOOT_STAGE2_MAGIC) {
+    boot_info.loader = BOOT_LOADER_STAGE2;
+    boot_info.vbe = (vbe_handoff_t*)info;
+    copy_string(boot_info.name, "stage2", BOOT_NAME);
+  } else {
+    /* an older stage2, the only other way in */
+    boot_info.loader = BOOT_LOADER_UNKNOWN;
+    boot_info.vbe = (vbe_handoff_t*)VBE_HANDOFF_ADDR;
+    copy_string(boot_info.name, "unknown", BOOT_NAME);
+  }
+
+  /* stage2 can't tell us, so assume what the kernel always did */
+  if (!boot_info.memory_top) {
+    boot_info.memory_top = FRAME_MEMORY_DEFAULT;
+  }
+
+  if (boot_info.vbe && boot_info.vbe->magic != VBE_MAGIC) {
+    boot_info.vbe = 0;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <vbe.h>
+
+/*
+  What kernel_entry.s finds in %eax: which loader started the kernel.
+  %ebx then points at what that loader left for us.
+ */
+#define BOOT_MULTIBOOT_MAGIC 0x2BADB002 /* %ebx: a multiboot_info_t */
+#define BOOT_STAGE2_MAGIC 0x32475453 /* "STG2"; %ebx: the vbe_handoff_t */
+
+/* boot_info_t.loader */
+#define BOOT_LOADER_UNKNOWN 0
+#define BOOT_LOADER_STAGE2 1
+#define BOOT_LOADER_MULTIBOOT 2
+
+#define BOOT_NAME 32
+#define BOOT_COMMAND_LINE 128
+
+/* multiboot_info_t.flags */
+#define MULTIBOOT_INFO_MEMORY 0x001
+#define MULTIBOOT_INFO_COMMAND_LINE 0x004
+#define MULTIBOOT_INFO_MEMORY_MAP 0x040
+#define MULTIBOOT_INFO_LOADER_NAME 0x200
+
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+/* the part of the Multiboot 0.6.96 information structure we use */
+typedef struct {
+  uint32_t flags;
+  uint32_t memory_lower; /* KB below 1 MB */
+  uint32_t memory_upper; /* KB from 1 MB up to the first hole */
+  uint32_t boot_device;
+  uint32_t command_line;
+  uint32_t modules_count;
+  uint32_t modules;
+  uint32_t symbols[4];
+  uint32_t memory_map_length;
+  uint32_t memory_map;
+  uint32_t drives_length;
+  uint32_t drives;
+  uint32_t config_table;
+  uint32_t loader_name;
+} __attribute__((packed)) multiboot_info_t;
+
+typedef struct {
+  uint32_t size; /* of the rest of the entry, which may grow */
+  uint64_t base;
+  uint64_t length;
+  uint32_t type;
+} __attribute__((packed)) multiboot_memory_t;
+
+/* the same facts, whichever way we booted */
+typedef struct {
+  uint8_t loader; /* BOOT_LOADER_* */
+  uint32_t memory_top; /* end of the usable memory starting at 1 MB */
+  vbe_handoff_t* vbe; /* the framebuffer mode stage2 set up, or 0 */
+  char name[BOOT_NAME]; /* of the loader */
+  char command_line[BOOT_COMMAND_LINE];
+} boot_info_t;
+
+extern boot_info_t boot_info;
+
+/*
+  Fills in boot_info from what the loader handed kernel_main(). Must be
+  the first thing the kernel does: a Multiboot loader leaves its strings
+  right behind the kernel, where the frame allocator starts.
+ */
+void init_boot(uint32_t magic, uint32_t info);
+
+#endif
@@ -6,12 +6,8 @@
 # http://www.independent-software.com/writing-your-own-bootloader-for-a-toy-operating-system-4/
 #
 # Creating the floppy:
-# Use WinImage to create a 1.44 MB floppy
-# (I tried using OSX Disk Utility, but I think it creates a bad floppy)
-#
-# Next, copy the floppy as empty_floppy.img and my_os.img
-# Make the bootblock, "make"
-# Mount my_os.img and copy stage2.bin as SECOND.BIN
+# "make my_os.img" builds it with util/mkfloppy, with this boot block
+# and stage2.bin as SECOND.BIN
 # Run "make qemu"
 
 # When the BIOS jumps to your code you can't rely on
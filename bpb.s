@@ -2,11 +2,9 @@
 # and should be the 58 next bytes right after the 3 byte jmp instruction that's
 # in the beginning of the boot sector.
 #
-# Although this file contains meaningful values, it is essentially
-# discarded as we keep whatever is on the actual floppy instead.
-#
-# The values are kept for "pedagogical reasons" and as a way of
-# having meaningful symbol names to use in bootblock.s and stage2.s
+# util/mkfloppy writes the same values into the floppy image it builds,
+# keep the two in sync. They also give us meaningful symbol names to use
+# in bootblock.s and stage2.s
 
 # OEM name
 oem:                                    .ascii "MSWIN4.1"
@@ -21,15 +19,8 @@ oem:                                    .ascii "MSWIN4.1"
 # 3.5-inch (90 mm) Double Sided, 80 tracks per side, 18 or 36 sectors per track (1440 KB, known as “1.44 MB”; or 2880 KB, known as “2.88 MB”).
 # 512 bytes per sector * 18 sectors per track * 80 tracks per side * 2 sides = 1440 KB
 #
-# Copy BPB from floppy to bootblock:
-# Set block size to 1 byte so we can skip first 11 bytes (jump instruction + OEM ID)
-# Length of BPB is 51 bytes (BPB 2.0 + BPB 3.31 + EBPB)
-#
-# Place the BPB within the bootblock
-# $ dd if=empty_floppy.img of=bootblock.bin bs=1 skip=11 seek=11 count=51 conv=notrunc
-# Copy bootblock back into floppy
-# $ cp empty_floppy.img bootblock.img
-# $ dd if=bootblock.bin of=bootblock.img bs=512 count=1 conv=notrunc
+# Length of BPB is 51 bytes (BPB 2.0 + BPB 3.31 + EBPB), starting at the
+# 11th byte (after the jump instruction + OEM ID)
 
 # BIOS parameter block
 # ======================================================================
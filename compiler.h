@@ -0,0 +1,12 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+/*
+  Marks a function that runs all the time: on every interrupt, system
+  call or log message. Optimized builds put these in .text.hot, which
+  kernel.ld keeps together at the start of the kernel, so the hot paths
+  share as few cache lines and TLB entries as possible.
+ */
+#define HOT __attribute__((hot))
+
+#endif
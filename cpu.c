@@ -0,0 +1,183 @@
+#include <cpu.h>
+#include <pit.h>
+#include <log.h>
+
+/* EFLAGS.ID; if it can be toggled, the CPU supports CPUID */
+#define EFLAGS_ID (1 << 21)
+
+#define CPUID_LEAF_EXTENDED_FEATURES 0x7
+#define CPUID_LEAF_EXTENDED 0x80000000
+#define CPUID_LEAF_POWER_MANAGEMENT 0x80000007
+
+/* the features that need the SSE state enabled */
+#define CPU_FEATURES_SSE (CPU_FEATURE_SSE | CPU_FEATURE_SSE2)
+#define CPU_FEATURES_ECX_SSE (CPU_FEATURE_ECX_SSE3 | CPU_FEATURE_ECX_SSSE3 | \
+  CPU_FEATURE_ECX_SSE41 | CPU_FEATURE_ECX_SSE42)
+
+/* defined by kernel.ld, the CPU_DISPATCH() entries */
+extern cpu_dispatch_t _dispatch_start[];
+extern cpu_dispatch_t _dispatch_end[];
+
+cpu_info_t cpu_info;
+
+static uint32_t has_cpuid()
+{
+  uint32_t before, after;
+
+  __asm__ __volatile__ (
+    "pushfl\n\t"
+    "pushfl\n\t"
+    "popl %0\n\t"
+    "movl %0, %1\n\t"
+    "xorl %2, %1\n\t"
+    "pushl %1\n\t"
+    "popfl\n\t"
+    "pushfl\n\t"
+    "popl %1\n\t"
+    "popfl"
+    : "=&r" (before), "=&r" (after)
+    : "i" (EFLAGS_ID));
+
+  return (before ^ after) & EFLAGS_ID;
+}
+
+/*
+  The FPU reports errors as exception 16 and "wait" traps while TS is
+  set; SSE needs the OS to promise it saves the state with fxsave.
+ */
+static void cpu_enable_fpu()
+{
+  uint32_t cr0 = read_cr0();
+
+  if (!cpu_has(CPU_FEATURE_FPU)) {
+    write_cr0(cr0 | CR0_EM);
+    return;
+  }
+
+  write_cr0((cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+  __asm__ __volatile__ ("fninit");
+
+  if (cpu_has(CPU_FEATURE_FXSR | CPU_FEATURE_SSE)) {
+    write_cr4(read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    cpu_info.sse = 1;
+  }
+}
+
+static uint32_t cpu_supports(const cpu_variant_t* variant)
+{
+  if (!cpu_has(variant->features) || !cpu_has_ecx(variant->features_ecx) ||
+      !cpu_has_ebx7(variant->features_ebx7)) {
+    return 0;
+  }
+  return cpu_info.sse || !((variant->features & CPU_FEATURES_SSE) || (variant->features_ecx & CPU_FEATURES_ECX_SSE));
+}
+
+/* binds every CPU_DISPATCH() pointer to the best variant this CPU runs */
+static void cpu_dispatch()
+{
+  cpu_dispatch_t* dispatch;
+  uint32_t k;
+
+  for (dispatch = _dispatch_start; dispatch < _dispatch_end; dispatch++) {
+    for (k = 0; k < dispatch->count; k++) {
+      if (cpu_supports(&dispatch->variants[k])) {
+        *dispatch->pointer = dispatch->variants[k].function;
+        break;
+      }
+    }
+  }
+}
+
+void init_cpu()
+{
+  uint32_t a, b, c, d;
+
+  cpu_info.max_leaf = 0;
+  cpu_info.max_extended_leaf = 0;
+  cpu_info.features = 0;
+  cpu_info.features_ecx = 0;
+  cpu_info.features_ebx7 = 0;
+  cpu_info.invariant_tsc = 0;
+  cpu_info.sse = 0;
+  cpu_info.tsc_khz = 0;
+
+  /* anything older than a late 486 */
+  if (!has_cpuid()) {
+    return;
+  }
+
+  cpuid(0, &a, &b, &c, &d);
+  cpu_info.max_leaf = a;
+  *(uint32_t*)&cpu_info.vendor[0] = b;
+  *(uint32_t*)&cpu_info.vendor[4] = d;
+  *(uint32_t*)&cpu_info.vendor[8] = c;
+  cpu_info.vendor[12] = 0;
+
+  if (cpu_info.max_leaf < 1) {
+    return;
+  }
+
+  cpuid(1, &a, &b, &c, &d);
+  cpu_info.stepping = a & 0xF;
+  cpu_info.model = (a >> 4) & 0xF;
+  cpu_info.family = (a >> 8) & 0xF;
+
+  if (cpu_info.family == 0xF) {
+    cpu_info.family += (a >> 20) & 0xFF;
+  }
+  if (cpu_info.family == 0x6 || cpu_info.family >= 0xF) {
+    cpu_info.model |= ((a >> 16) & 0xF) << 4;
+  }
+
+  cpu_info.features = d;
+  cpu_info.features_ecx = c;
+
+  /* the Pentium Pro reports SEP, but does not implement SYSENTER/SYSEXIT */
+  if (cpu_info.family == 6 && cpu_info.model < 3 && cpu_info.stepping < 3) {
+    cpu_info.features &= ~CPU_FEATURE_SEP;
+  }
+
+  if (cpu_info.max_leaf >= CPUID_LEAF_EXTENDED_FEATURES) {
+    cpuid(CPUID_LEAF_EXTENDED_FEATURES, &a, &b, &c, &d);
+    cpu_info.features_ebx7 = b;
+  }
+
+  /* leaves that do not exist return garbage, rather than zeroes */
+  cpuid(CPUID_LEAF_EXTENDED, &a, &b, &c, &d);
+  if (a > CPUID_LEAF_EXTENDED && a < CPUID_LEAF_EXTENDED + 0x10000) {
+    cpu_info.max_extended_leaf = a;
+  }
+  if (cpu_info.max_extended_leaf >= CPUID_LEAF_POWER_MANAGEMENT) {
+    cpuid(CPUID_LEAF_POWER_MANAGEMENT, &a, &b, &c, &d);
+    cpu_info.invariant_tsc = (d & CPU_FEATURE_INVARIANT_TSC) != 0;
+  }
+
+  cpu_enable_fpu();
+  cpu_dispatch();
+
+  if (cpu_has(CPU_FEATURE_TSC)) {
+    cpu_info.tsc_khz = pit_tsc_khz();
+  }
+}
+
+void cpu_report()
+{
+  cpu_dispatch_t* dispatch;
+  uint32_t k;
+
+  log_write(LOG_INFO, "cpu: %s family %u model %u stepping %u, TSC %u kHz%s",
+    cpu_info.max_leaf ? cpu_info.vendor : "no CPUID", cpu_info.family, cpu_info.model, cpu_info.stepping,
+    cpu_info.tsc_khz, cpu_info.invariant_tsc ? " (invariant)" : "");
+  log_write(LOG_INFO, "cpu: features %08x %08x %08x%s%s%s%s%s%s", cpu_info.features, cpu_info.features_ecx,
+    cpu_info.features_ebx7, cpu_has(CPU_FEATURE_PSE) ? " pse" : "", cpu_has(CPU_FEATURE_PAE) ? " pae" : "",
+    cpu_has(CPU_FEATURE_APIC) ? " apic" : "", cpu_has(CPU_FEATURE_SEP) ? " sep" : "",
+    cpu_info.sse ? " sse" : "", cpu_has_ecx(CPU_FEATURE_ECX_SSSE3) ? " ssse3" : "");
+
+  for (dispatch = _dispatch_start; dispatch < _dispatch_end; dispatch++) {
+    for (k = 0; k < dispatch->count; k++) {
+      if (dispatch->variants[k].function == *dispatch->pointer) {
+        log_write(LOG_INFO, "cpu: %s is %s", dispatch->name, dispatch->variants[k].name);
+      }
+    }
+  }
+}
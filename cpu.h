@@ -0,0 +1,283 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* CPUID.01h:EDX feature bits */
+#define CPU_FEATURE_FPU (1 << 0)
+#define CPU_FEATURE_PSE (1 << 3)
+#define CPU_FEATURE_TSC (1 << 4)
+#define CPU_FEATURE_MSR (1 << 5)
+#define CPU_FEATURE_PAE (1 << 6)
+#define CPU_FEATURE_APIC (1 << 9)
+#define CPU_FEATURE_SEP (1 << 11)
+#define CPU_FEATURE_FXSR (1 << 24)
+#define CPU_FEATURE_SSE (1 << 25)
+#define CPU_FEATURE_SSE2 (1 << 26)
+
+/* CPUID.01h:ECX feature bits, for cpu_has_ecx() */
+#define CPU_FEATURE_ECX_SSE3 (1 << 0)
+#define CPU_FEATURE_ECX_SSSE3 (1 << 9)
+#define CPU_FEATURE_ECX_SSE41 (1 << 19)
+#define CPU_FEATURE_ECX_SSE42 (1 << 20)
+#define CPU_FEATURE_ECX_POPCNT (1 << 23)
+
+/* CPUID.07h:EBX feature bits, for cpu_has_ebx7() */
+#define CPU_FEATURE_EBX7_ERMS (1 << 9) /* "rep movsb" and "rep stosb" are the fastest way */
+
+/* CPUID.80000007h:EDX, the TSC ticks at the same rate in every P- and C-state */
+#define CPU_FEATURE_INVARIANT_TSC (1 << 8)
+
+/* control register bits */
+#define CR0_MP (1 << 1) /* "wait" honours TS */
+#define CR0_EM (1 << 2) /* no FPU, emulate it */
+#define CR0_TS (1 << 3)
+#define CR0_NE (1 << 5) /* FPU errors as exception 16, rather than through the PIC */
+#define CR0_WP (1 << 16) /* honour read-only pages in ring 0 as well */
+#define CR0_PG (1 << 31)
+#define CR4_OSFXSR (1 << 9) /* fxsave/fxrstor and the SSE instructions */
+#define CR4_OSXMMEXCPT (1 << 10) /* SSE errors as exception 19 */
+
+/* model specific registers */
+#define MSR_IA32_SYSENTER_CS 0x174
+#define MSR_IA32_SYSENTER_ESP 0x175
+#define MSR_IA32_SYSENTER_EIP 0x176
+
+/* only the boot processor is brought up; the host test build runs CPUs as threads */
+#ifndef CPUS
+#define CPUS 1
+#endif
+
+typedef struct {
+  uint32_t max_leaf; /* highest basic CPUID leaf, 0 if CPUID is missing */
+  uint32_t max_extended_leaf; /* highest 0x8000xxxx leaf, or 0 */
+  char vendor[13]; /* "GenuineIntel", "AuthenticAMD", ... */
+  uint8_t family;
+  uint8_t model;
+  uint8_t stepping;
+  uint32_t features; /* CPUID.01h:EDX, with quirks applied */
+  uint32_t features_ecx; /* CPUID.01h:ECX */
+  uint32_t features_ebx7; /* CPUID.07h:EBX */
+  uint8_t invariant_tsc;
+  uint8_t sse; /* non-zero once init_cpu() enabled the SSE state */
+  uint32_t tsc_khz; /* 0 without a TSC */
+} cpu_info_t;
+
+extern cpu_info_t cpu_info;
+
+/*
+  Detects what the CPU supports and fills in "cpu_info", turns on the
+  FPU, and SSE where there is one, then binds the CPU_DISPATCH() entries.
+  The xmm registers then belong to the kernel outside interrupt
+  handlers: they are not saved on interrupts or process switches, so
+  handlers must not use SSE, nor call what does, like strlen(), and
+  user programs must not count on them keeping their values.
+ */
+void init_cpu();
+
+/* logs what init_cpu() found, and which variants it picked */
+void cpu_report();
+
+/*
+  One implementation of a routine, and the features it needs. The
+  CPU_FEATURE_SSE*, and any CPU_FEATURE_ECX_* bit, also need the SSE
+  state to be enabled.
+ */
+typedef struct {
+  void* function;
+  const char* name;
+  uint32_t features; /* CPU_FEATURE_* */
+  uint32_t features_ecx; /* CPU_FEATURE_ECX_* */
+  uint32_t features_ebx7; /* CPU_FEATURE_EBX7_* */
+} cpu_variant_t;
+
+typedef struct {
+  const char* name;
+  void** pointer;
+  const cpu_variant_t* variants;
+  uint32_t count;
+} cpu_dispatch_t;
+
+/*
+  Points the function pointer "pointer" at the first of the variants,
+  best first, that this CPU supports, once at boot:
+
+    static uint32_t (*strlen_best)(const char* s) = strlen_words;
+
+    CPU_DISPATCH(strlen, strlen_best,
+      CPU_VARIANT(strlen_sse2, CPU_FEATURE_SSE2, 0, 0),
+      CPU_VARIANT(strlen_words, 0, 0, 0));
+
+  The last variant should need nothing; the pointer's initial value is
+  what runs before init_cpu(). Entries are collected in the .dispatch
+  section, like BENCH() entries.
+ */
+#define CPU_VARIANT(function, features, features_ecx, features_ebx7) \
+  { (void*)function, #function, features, features_ecx, features_ebx7 }
+
+#define CPU_DISPATCH(label, pointer, ...) \
+  static const cpu_variant_t dispatch_variants_##label[] = { __VA_ARGS__ }; \
+  static cpu_dispatch_t dispatch_entry_##label \
+    __attribute__((section(".dispatch"), used, aligned(__alignof__(cpu_dispatch_t)))) = \
+    { #label, (void**)&pointer, dispatch_variants_##label, \
+      sizeof(dispatch_variants_##label) / sizeof(cpu_variant_t) }
+
+/* index of the CPU running this code, below CPUS */
+#ifdef __i386__
+static inline uint32_t cpu_id()
+{
+  return 0;
+}
+#else
+/* set by each thread of the host test build, see test/mock.c */
+extern __thread uint32_t mock_cpu;
+
+static inline uint32_t cpu_id()
+{
+  return mock_cpu;
+}
+#endif
+
+/* returns non-zero if all of the CPU_FEATURE_* bits in "feature" are present */
+static inline uint32_t cpu_has(uint32_t feature)
+{
+  return (cpu_info.features & feature) == feature;
+}
+
+/* the same for CPU_FEATURE_ECX_* bits */
+static inline uint32_t cpu_has_ecx(uint32_t feature)
+{
+  return (cpu_info.features_ecx & feature) == feature;
+}
+
+/* the same for CPU_FEATURE_EBX7_* bits */
+static inline uint32_t cpu_has_ebx7(uint32_t feature)
+{
+  return (cpu_info.features_ebx7 & feature) == feature;
+}
+
+/*
+  Disables interrupts, returning the flags for interrupts_restore() to
+  put back, so the two nest. The host test build (not 32-bit) runs in
+  user space, where "cli" would fault and nothing needs it.
+ */
+static inline uint32_t interrupts_save()
+{
+  uint32_t eflags = 0;
+#ifdef __i386__
+  __asm__ __volatile__ ("pushfl; popl %0; cli" : "=r" (eflags) : : "memory");
+#endif
+  return eflags;
+}
+
+static inline void interrupts_restore(uint32_t eflags)
+{
+#ifdef __i386__
+  __asm__ __volatile__ ("pushl %0; popfl" : : "r" (eflags) : "memory", "cc");
+#endif
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d)
+{
+  __asm__ __volatile__ ("cpuid" : "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d) : "a" (leaf), "c" (0));
+}
+
+/* always inlined, so ring 3 code (USER_TEXT) can use it as well */
+static inline __attribute__((always_inline)) uint64_t rdtsc()
+{
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/* reads performance counter "counter"; ring 3 may only use it with CR4.PCE set */
+static inline uint64_t rdpmc(uint32_t counter)
+{
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (counter));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+  64 by 32 bit division, as there is no libgcc to do it for us. Dividing
+  the high half first keeps either "divl" from overflowing.
+ */
+static inline uint64_t div64(uint64_t n, uint32_t d, uint32_t* remainder)
+{
+  uint32_t high = n >> 32, low = n, quotient;
+
+  quotient = high / d;
+  high %= d;
+  __asm__ ("divl %4" : "=a" (low), "=d" (high) : "a" (low), "d" (high), "rm" (d));
+
+  if (remainder) {
+    *remainder = high;
+  }
+  return ((uint64_t)quotient << 32) | low;
+}
+
+static inline uint64_t rdmsr(uint32_t msr)
+{
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdmsr" : "=a" (lo), "=d" (hi) : "c" (msr));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value)
+{
+  __asm__ __volatile__ ("wrmsr" : : "c" (msr), "a" ((uint32_t)value), "d" ((uint32_t)(value >> 32)));
+}
+
+static inline uint32_t read_cr0()
+{
+  uint32_t value;
+  __asm__ __volatile__ ("mov %%cr0, %0" : "=r" (value));
+  return value;
+}
+
+static inline void write_cr0(uint32_t value)
+{
+  __asm__ __volatile__ ("mov %0, %%cr0" : : "r" (value) : "memory");
+}
+
+/* Pentium and later, or a 486 with CPUID */
+static inline uint32_t read_cr4()
+{
+  uint32_t value;
+  __asm__ __volatile__ ("mov %%cr4, %0" : "=r" (value));
+  return value;
+}
+
+static inline void write_cr4(uint32_t value)
+{
+  __asm__ __volatile__ ("mov %0, %%cr4" : : "r" (value) : "memory");
+}
+
+/* the faulting address of the last page fault */
+static inline uint32_t read_cr2()
+{
+  uint32_t value;
+  __asm__ __volatile__ ("mov %%cr2, %0" : "=r" (value));
+  return value;
+}
+
+static inline uint32_t read_cr3()
+{
+  uint32_t value;
+  __asm__ __volatile__ ("mov %%cr3, %0" : "=r" (value));
+  return value;
+}
+
+/* loads a page directory, flushing the (non-global) TLB entries */
+static inline void write_cr3(uint32_t value)
+{
+  __asm__ __volatile__ ("mov %0, %%cr3" : : "r" (value) : "memory");
+}
+
+/* flushes the TLB entry of a single page; 486 and later */
+static inline void invlpg(uint32_t address)
+{
+  __asm__ __volatile__ ("invlpg (%0)" : : "r" (address) : "memory");
+}
+
+#endif
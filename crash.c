@@ -0,0 +1,209 @@
+#include <stddef.h>
+#include <crash.h>
+#include <cpu.h>
+#include <tss.h>
+#include <paging.h>
+#include <symbols.h>
+#include <serial.h>
+#include <screen.h>
+#include <string.h>
+#include <log.h>
+
+#define CRASH_LINE 128
+
+/* defined in isr.s */
+extern void isr_double_fault();
+
+/* defined by kernel.ld; the kernel stacks are in .bss */
+extern uint8_t _bss[];
+extern uint8_t _bss_end[];
+
+static char* exception_names[EXCEPTIONS] = {
+  "Divide error",
+  "Debug",
+  "NMI",
+  "Breakpoint",
+  "Overflow",
+  "BOUND range exceeded",
+  "Invalid opcode",
+  "Device not available",
+  "Double fault",
+  "Coprocessor segment overrun",
+  "Invalid TSS",
+  "Segment not present",
+  "Stack fault",
+  "General protection",
+  "Page fault",
+  "Reserved",
+  "x87 FPU error",
+  "Alignment check",
+  "Machine check",
+  "SIMD exception",
+  "Virtualization exception",
+  "Control protection",
+  "Reserved", "Reserved", "Reserved", "Reserved", "Reserved", "Reserved",
+  "Hypervisor injection",
+  "VMM communication",
+  "Security exception",
+  "Reserved"
+};
+
+static volatile uint32_t crashing;
+
+/* not on the stack, which may be about to run out */
+static crash_dump_t dump;
+
+void init_crash()
+{
+  tss_set_double_fault(isr_double_fault, (uint32_t)paging_kernel_directory());
+}
+
+/* straight to the screen and the serial port, without the log in between */
+static void crash_print(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void crash_print(const char* fmt, ...)
+{
+  char line[CRASH_LINE];
+  va_list args;
+  uint32_t n;
+
+  va_start(args, fmt);
+  n = vformat(line, CRASH_LINE, fmt, args);
+  va_end(args);
+
+  serial_write(line, n);
+  printstrl(line, n);
+}
+
+static void crash_print_address(uint32_t address)
+{
+  uint32_t offset;
+  int32_t index = symbol_index(address, &offset);
+
+  if (index < 0) {
+    crash_print("  %08x\n", address);
+  } else {
+    crash_print("  %08x %s+0x%x\n", address, symbol_name(index), offset);
+  }
+}
+
+void crash_print_registers(trap_frame_t* frame, uint32_t esp)
+{
+  crash_print("eax %08x ebx %08x ecx %08x edx %08x\n", frame->eax, frame->ebx, frame->ecx, frame->edx);
+  crash_print("esi %08x edi %08x ebp %08x esp %08x\n", frame->esi, frame->edi, frame->ebp, esp);
+  crash_print("cs %04x ds %04x es %04x fs %04x gs %04x eflags %08x\n",
+    frame->cs, frame->ds, frame->es, frame->fs, frame->gs, frame->eflags);
+}
+
+static void crash_halt() __attribute__((noreturn));
+static void crash_halt()
+{
+  while (1) {
+    __asm__ __volatile__ ("cli; hlt");
+  }
+}
+
+static void crash_report(trap_frame_t* frame, uint32_t esp) __attribute__((noreturn));
+static void crash_report(trap_frame_t* frame, uint32_t esp)
+{
+  /* before anything else can fault and change it */
+  uint32_t cr2 = read_cr2(), k, *words;
+  uint8_t* bytes;
+
+  interrupts_disable();
+  if (crashing++) {
+    /* crashed while reporting a crash, nothing is to be trusted now */
+    crash_halt();
+  }
+
+  dump.magic = CRASH_MAGIC;
+  dump.version = CRASH_VERSION;
+  dump.size = sizeof(dump);
+  dump.cr0 = read_cr0();
+  dump.cr2 = cr2;
+  dump.cr3 = read_cr3();
+  /* CR4 came with the Pentium, as did the TSC */
+  if (cpu_has(CPU_FEATURE_TSC)) {
+    dump.timestamp = rdtsc();
+    dump.cr4 = read_cr4();
+  }
+  dump.frame = *frame;
+  dump.esp = esp;
+
+  /* user stacks are not ours to walk */
+  if (!trap_from_user(frame)) {
+    dump.depth = symbol_backtrace(frame->ebp, dump.backtrace, CRASH_FRAMES);
+    if (!(esp & 3) && esp >= (uint32_t)_bss && esp < (uint32_t)_bss_end) {
+      dump.stack_count = ((uint32_t)_bss_end - esp) / 4;
+      if (dump.stack_count > CRASH_STACK) {
+        dump.stack_count = CRASH_STACK;
+      }
+      for (k = 0; k < dump.stack_count; k++) {
+        dump.stack[k] = ((uint32_t*)esp)[k];
+      }
+    }
+  }
+
+  words = (uint32_t*)&dump;
+  dump.checksum = 0;
+  for (k = 0; k < offsetof(crash_dump_t, checksum) / 4; k++) {
+    dump.checksum += words[k];
+  }
+
+  /* get out what was logged before, it may tell how we got here */
+  log_drain();
+
+  screen_set_color(SCREEN_COLOR(LIGHT_RED, BLACK));
+  crash_print("\nUnhandled %s (vector %u, error 0x%x) at %04x:%08x\n",
+    frame->vector < EXCEPTIONS ? exception_names[frame->vector] : "interrupt",
+    frame->vector, frame->error_code, frame->cs, frame->eip);
+  crash_print_registers(frame, esp);
+  crash_print("cr0 %08x cr2 %08x cr3 %08x cr4 %08x\n", dump.cr0, dump.cr2, dump.cr3, dump.cr4);
+
+  crash_print("backtrace:\n");
+  crash_print_address(frame->eip);
+  for (k = 0; k < dump.depth; k++) {
+    crash_print_address(dump.backtrace[k]);
+  }
+
+  /* as is, without turning '\n' into "\r\n" */
+  bytes = (uint8_t*)&dump;
+  for (k = 0; k < sizeof(dump); k++) {
+    serial_putc(bytes[k]);
+  }
+  crash_print("\ncrash dump of %u bytes sent to serial, see util/crashdump\n", (uint32_t)sizeof(dump));
+
+  crash_halt();
+}
+
+void crash(trap_frame_t* frame)
+{
+  crash_report(frame, trap_esp(frame));
+}
+
+void crash_double_fault(uint32_t error_code)
+{
+  const tss_t* tss = tss_interrupted();
+  trap_frame_t frame;
+
+  frame.gs = tss->gs;
+  frame.fs = tss->fs;
+  frame.es = tss->es;
+  frame.ds = tss->ds;
+  frame.edi = tss->edi;
+  frame.esi = tss->esi;
+  frame.ebp = tss->ebp;
+  frame.esp = tss->esp;
+  frame.ebx = tss->ebx;
+  frame.edx = tss->edx;
+  frame.ecx = tss->ecx;
+  frame.eax = tss->eax;
+  frame.vector = EXCEPTION_DOUBLE_FAULT;
+  frame.error_code = error_code;
+  frame.eip = tss->eip;
+  frame.cs = tss->cs;
+  frame.eflags = tss->eflags;
+  frame.user_esp = tss->esp;
+  frame.user_ss = tss->ss;
+
+  crash_report(&frame, tss->esp);
+}
@@ -0,0 +1,53 @@
+#ifndef CRASH_H
+#define CRASH_H
+
+#include <stdint.h>
+#include <interrupt.h>
+
+#define CRASH_MAGIC 0x48535243 /* "CRSH" */
+#define CRASH_VERSION 1
+
+/* return addresses kept, innermost first */
+#define CRASH_FRAMES 16
+
+/* dwords copied from the top of the stack that faulted */
+#define CRASH_STACK 32
+
+/*
+  What crash() writes to the serial port, as is, right after its text
+  report: little-endian, packed, and found again in a capture of the
+  port by its magic and checksum. util/crashdump decodes it; change
+  CRASH_VERSION along with the layout.
+ */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size; /* sizeof(crash_dump_t) */
+  uint64_t timestamp; /* TSC */
+  uint32_t cr0, cr2, cr3, cr4;
+  trap_frame_t frame;
+  uint32_t esp; /* where the stack was when the trap happened */
+  uint32_t depth; /* of the backtrace */
+  uint32_t backtrace[CRASH_FRAMES];
+  uint32_t stack_count; /* of the stack dwords that could be read */
+  uint32_t stack[CRASH_STACK];
+  uint32_t checksum; /* the sum of all dwords before it */
+} __attribute__((packed, aligned(4))) crash_dump_t;
+
+/* moves double faults to a task with its own stack; paging must be set up */
+void init_crash();
+
+/*
+  Reports a fatal trap and halts: the registers, control registers and a
+  symbolized backtrace on the screen and the serial port, followed by a
+  crash_dump_t on the serial port.
+ */
+void crash(trap_frame_t* frame) __attribute__((noreturn));
+
+/* prints the registers in "frame" the way crash() does, with "esp" for the stack pointer */
+void crash_print_registers(trap_frame_t* frame, uint32_t esp);
+
+/* the double fault task, started by isr_double_fault in isr.s */
+void crash_double_fault(uint32_t error_code) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,142 @@
+#include <fat.h>
+#include <cpu.h>
+
+/*
+  Three bytes, read as one little endian number, are two entries side by
+  side: the low 12 bits and the high 12 bits. The compiler merges the
+  byte loads, so this is a load, a shift and two masks per pair.
+ */
+void fat12_unpack_scalar(const uint8_t* fat, uint16_t* entries, uint32_t count)
+{
+  uint32_t k, pair;
+
+  for (k = 0; k + 2 <= count; k += 2, fat += 3) {
+    pair = fat[0] | (fat[1] << 8) | (fat[2] << 16);
+    entries[k] = pair & 0xFFF;
+    entries[k + 1] = pair >> 12;
+  }
+
+  /* an odd count leaves an entry in the first byte and a half */
+  if (k < count) {
+    entries[k] = fat[0] | ((fat[1] & 0xF) << 8);
+  }
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+typedef char v16qi_t __attribute__((vector_size(16)));
+typedef uint16_t v8hu_t __attribute__((vector_size(16)));
+
+/* for unaligned loads and stores */
+typedef char v16qi_unaligned_t __attribute__((vector_size(16), aligned(1)));
+typedef uint16_t v8hu_unaligned_t __attribute__((vector_size(16), aligned(1)));
+
+/*
+  Eight entries from 12 bytes at a time: pshufb puts bytes 3i, 3i+1 into
+  16 bit lane 2i and bytes 3i+1, 3i+2 into lane 2i+1, then the even
+  lanes keep their low 12 bits and the odd lanes shift right by 4. The
+  load is 16 bytes wide, so the last few entries go through the scalar
+  code instead of reading past the end of the FAT.
+ */
+__attribute__((target("ssse3")))
+void fat12_unpack_ssse3(const uint8_t* fat, uint16_t* entries, uint32_t count)
+{
+  const v16qi_t shuffle = { 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 };
+  const v8hu_t low = { 0xFFF, 0, 0xFFF, 0, 0xFFF, 0, 0xFFF, 0 };
+  const v8hu_t high = { 0, 0xFFF, 0, 0xFFF, 0, 0xFFF, 0, 0xFFF };
+  uint32_t k, bytes = (count * 3 + 1) / 2;
+  v8hu_t lanes;
+
+  for (k = 0; k + 8 <= count && k / 2 * 3 + 16 <= bytes; k += 8, fat += 12) {
+    lanes = (v8hu_t)__builtin_ia32_pshufb128(*(const v16qi_unaligned_t*)fat, shuffle);
+    *(v8hu_unaligned_t*)(entries + k) = (lanes & low) | ((lanes >> 4) & high);
+  }
+
+  fat12_unpack_scalar(fat, entries + k, count - k);
+}
+
+#else
+
+void fat12_unpack_ssse3(const uint8_t* fat, uint16_t* entries, uint32_t count)
+{
+  fat12_unpack_scalar(fat, entries, count);
+}
+
+#endif
+
+static void (*fat12_unpack_best)(const uint8_t* fat, uint16_t* entries, uint32_t count) = fat12_unpack_scalar;
+
+CPU_DISPATCH(fat12_unpack, fat12_unpack_best,
+  CPU_VARIANT(fat12_unpack_ssse3, 0, CPU_FEATURE_ECX_SSSE3, 0),
+  CPU_VARIANT(fat12_unpack_scalar, 0, 0, 0));
+
+#if __STDC_HOSTED__
+void fat_use_ssse3(uint32_t enable)
+{
+  fat12_unpack_best = enable ? fat12_unpack_ssse3 : fat12_unpack_scalar;
+}
+#endif
+
+void fat12_unpack(const uint8_t* fat, uint16_t* entries, uint32_t count)
+{
+  fat12_unpack_best(fat, entries, count);
+}
+
+void fat16_unpack(const uint8_t* fat, uint16_t* entries, uint32_t count)
+{
+  uint32_t k;
+  for (k = 0; k < count; k++) {
+    entries[k] = fat[2 * k] | (fat[2 * k + 1] << 8);
+  }
+}
+
+uint32_t fat_extents(const fat_t* fat, uint32_t cluster, fat_extent_t* extents, uint32_t* count, uint32_t* clusters)
+{
+  uint32_t room = *count, used = 0, length = 0, status;
+  uint16_t next;
+
+  while (1) {
+    if (cluster < 2 || cluster >= fat->count) {
+      status = FAT_CHAIN_RANGE;
+      break;
+    }
+    /* a valid chain visits every cluster at most once */
+    if (length >= fat->count - 2) {
+      status = FAT_CHAIN_LOOP;
+      break;
+    }
+
+    if (used && cluster == extents[used - 1].start + extents[used - 1].length) {
+      extents[used - 1].length++;
+    } else if (used < room) {
+      extents[used].start = cluster;
+      extents[used].length = 1;
+      used++;
+    } else {
+      status = FAT_CHAIN_FULL;
+      break;
+    }
+    length++;
+
+    next = fat->entries[cluster];
+    if (next > fat->bad) {
+      status = FAT_CHAIN_END;
+      break;
+    }
+    if (next == fat->bad) {
+      status = FAT_CHAIN_BAD;
+      break;
+    }
+    if (next == FAT_FREE) {
+      status = FAT_CHAIN_FREE;
+      break;
+    }
+    cluster = next;
+  }
+
+  *count = used;
+  if (clusters) {
+    *clusters = length;
+  }
+  return status;
+}
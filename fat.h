@@ -0,0 +1,70 @@
+#ifndef FAT_H
+#define FAT_H
+
+#include <stdint.h>
+
+/*
+  Decoding of FAT12 and FAT16 allocation tables, shared by the kernel,
+  the host test build and util/read_floppy.
+
+  A FAT is unpacked once into one 16 bit entry per cluster, then chains
+  are read from that as extents: runs of consecutive clusters, which a
+  block reader can fetch with one request each.
+ */
+
+/* special entry values; FAT12 uses the low 12 bits of these */
+#define FAT_FREE 0x0000
+#define FAT12_BAD 0xFF7
+#define FAT16_BAD 0xFFF7 /* and anything above: end of chain */
+
+/* why fat_extents() stopped */
+#define FAT_CHAIN_END 0 /* reached the end of chain marker */
+#define FAT_CHAIN_FULL 1 /* more extents than there was room for */
+#define FAT_CHAIN_FREE 2 /* a cluster pointing at a free one */
+#define FAT_CHAIN_BAD 3 /* ... or at a bad one */
+#define FAT_CHAIN_RANGE 4 /* ... or past the last cluster */
+#define FAT_CHAIN_LOOP 5 /* longer than there are clusters */
+
+typedef struct {
+  uint16_t* entries; /* one per cluster, 0 and 1 included */
+  uint32_t count; /* of entries, the data clusters + 2 */
+  uint16_t bad; /* FAT12_BAD or FAT16_BAD */
+} fat_t;
+
+typedef struct {
+  uint16_t start; /* first cluster */
+  uint16_t length; /* in clusters */
+} fat_extent_t;
+
+/*
+  Unpacks "count" 12 bit entries, two from every three bytes of "fat":
+  bytes ab cd ef hold the entries dab and efc. fat12_unpack() uses
+  fat12_unpack_ssse3() where the CPU has SSSE3, as picked by init_cpu()
+  in the kernel and by fat_use_ssse3() on the host, and
+  fat12_unpack_scalar() otherwise.
+ */
+void fat12_unpack(const uint8_t* fat, uint16_t* entries, uint32_t count);
+void fat12_unpack_scalar(const uint8_t* fat, uint16_t* entries, uint32_t count);
+void fat12_unpack_ssse3(const uint8_t* fat, uint16_t* entries, uint32_t count);
+
+/* the little endian 16 bit entries of a FAT16 */
+void fat16_unpack(const uint8_t* fat, uint16_t* entries, uint32_t count);
+
+/*
+  Lets fat12_unpack() use SSSE3, for programs on the host, which have no
+  init_cpu() to pick it; only call it knowing the CPU has it.
+ */
+#if __STDC_HOSTED__
+void fat_use_ssse3(uint32_t enable);
+#endif
+
+/*
+  Follows the chain from "cluster", merging consecutive clusters into
+  extents. "count" is the room in "extents" on entry and the number of
+  extents written on return, "clusters" (if not null) the total length.
+  Returns one of FAT_CHAIN_*; the extents up to the problem are filled
+  in either way.
+ */
+uint32_t fat_extents(const fat_t* fat, uint32_t cluster, fat_extent_t* extents, uint32_t* count, uint32_t* clusters);
+
+#endif
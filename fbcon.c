@@ -0,0 +1,269 @@
+#include <fbcon.h>
+#include <vbe.h>
+#include <boot.h>
+#include <paging.h>
+#include <memory.h>
+#include <io.h>
+
+/*
+  Bochs and QEMU expose the VBE registers through these ports as well,
+  which lets us pan the display in protected mode.
+ */
+#define DISPI_INDEX 0x01CE
+#define DISPI_DATA 0x01CF
+#define DISPI_INDEX_ID 0x0
+#define DISPI_INDEX_VIRT_HEIGHT 0x7
+#define DISPI_INDEX_Y_OFFSET 0x9
+#define DISPI_ID2 0xB0C2 /* first version with virtual height and offsets */
+#define DISPI_ID_MAX 0xB0CF
+
+/* more virtual lines means fewer wraps, but more to map */
+#define FBCON_MAX_PAGES 4
+
+/* 8 pixels at 32 bpp */
+#define GLYPH_LINE_WORDS_MAX 8
+
+static uint8_t* fb;
+static uint32_t pitch;
+static uint32_t width;
+static uint32_t height;
+static uint32_t bytes_per_pixel;
+static uint32_t cols;
+static uint32_t rows;
+
+/* one glyph line (8 pixels) is this many 32-bit words */
+static uint32_t glyph_line_words;
+
+/* pixel masks: every pixel of a set font bit is all ones */
+static uint32_t glyphs[256 * VBE_FONT_HEIGHT * GLYPH_LINE_WORDS_MAX];
+
+/* 8 pixels of each of the 16 text colors, in the format of the mode */
+static uint32_t palette[16][GLYPH_LINE_WORDS_MAX];
+
+/* hardware panning; y_offset is the first visible line */
+static uint32_t panning;
+static uint32_t virtual_height;
+static uint32_t y_offset;
+
+/* the rows to draw on the next flush, first > last when clean */
+static uint32_t dirty_first;
+static uint32_t dirty_last;
+
+/* the 16 text mode colors, 0xRRGGBB */
+static uint32_t text_colors[16] = {
+  0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+  0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF
+};
+
+static void dispi_write(uint16_t index, uint16_t value)
+{
+  outportw(DISPI_INDEX, index);
+  outportw(DISPI_DATA, value);
+}
+
+static uint16_t dispi_read(uint16_t index)
+{
+  outportw(DISPI_INDEX, index);
+  return inportw(DISPI_DATA);
+}
+
+static uint32_t fbcon_pixel(vbe_mode_info_t* info, uint8_t index)
+{
+  uint32_t rgb = text_colors[index];
+  uint32_t r = (rgb >> 16) & 0xFF;
+  uint32_t g = (rgb >> 8) & 0xFF;
+  uint32_t b = rgb & 0xFF;
+
+  /* the default 256 color palette starts with the 16 text colors */
+  if (info->memory_model != VBE_MODEL_DIRECT) {
+    return index;
+  }
+
+  return ((r >> (8 - info->red_mask_size)) << info->red_position)
+    | ((g >> (8 - info->green_mask_size)) << info->green_position)
+    | ((b >> (8 - info->blue_mask_size)) << info->blue_position);
+}
+
+/* stores 8 pixels into "words"; pixel x is set to "on" if bit (7 - x) of "bits" is set */
+static void fbcon_expand(uint32_t* words, uint8_t bits, uint32_t on)
+{
+  uint8_t* bytes = (uint8_t*)words;
+  uint32_t x, k;
+
+  for (x = 0; x < 8; x++) {
+    uint32_t value = (bits & (0x80 >> x)) ? on : 0;
+    for (k = 0; k < bytes_per_pixel; k++) {
+      *bytes++ = (value >> (8 * k)) & 0xFF;
+    }
+  }
+}
+
+static uint32_t fbcon_probe_panning()
+{
+  uint16_t id = dispi_read(DISPI_INDEX_ID);
+  if (id < DISPI_ID2 || id > DISPI_ID_MAX) {
+    return 0;
+  }
+
+  virtual_height = dispi_read(DISPI_INDEX_VIRT_HEIGHT);
+  if (virtual_height > FBCON_MAX_PAGES * height) {
+    virtual_height = FBCON_MAX_PAGES * height;
+  }
+
+  return virtual_height >= height + VBE_FONT_HEIGHT;
+}
+
+uint32_t init_fbcon()
+{
+  vbe_handoff_t* handoff = boot_info.vbe;
+  vbe_mode_info_t* info = &handoff->info;
+  uint8_t* font = (uint8_t*)VBE_FONT_ADDR;
+  uint32_t i, offset;
+
+  /* only stage2 sets a mode, Multiboot leaves us in text mode */
+  if (!handoff) {
+    return 0;
+  }
+
+  if (info->bpp != 8 && info->bpp != 15 && info->bpp != 16 && info->bpp != 24 && info->bpp != 32) {
+    return 0;
+  }
+
+  pitch = info->pitch;
+  width = info->width;
+  height = info->height;
+  bytes_per_pixel = (info->bpp + 7) / 8;
+  glyph_line_words = 2 * bytes_per_pixel;
+
+  cols = width / VBE_FONT_WIDTH;
+  rows = height / VBE_FONT_HEIGHT;
+  if (cols > FBCON_MAX_COLS) {
+    cols = FBCON_MAX_COLS;
+  }
+  if (rows > FBCON_MAX_ROWS) {
+    rows = FBCON_MAX_ROWS;
+  }
+
+  virtual_height = height;
+  panning = fbcon_probe_panning();
+  y_offset = 0;
+  if (panning) {
+    dispi_write(DISPI_INDEX_Y_OFFSET, 0);
+  }
+
+  for (offset = 0; offset < pitch * virtual_height; offset += PAGE_SIZE) {
+    if (!paging_map(paging_kernel_directory(), FBCON_BASE + offset, info->framebuffer + offset, PTE_WRITE)) {
+      return 0;
+    }
+  }
+  fb = (uint8_t*)FBCON_BASE;
+
+  for (i = 0; i < 16; i++) {
+    fbcon_expand(palette[i], 0xFF, fbcon_pixel(info, i));
+  }
+
+  for (i = 0; i < 256 * VBE_FONT_HEIGHT; i++) {
+    fbcon_expand(&glyphs[i * glyph_line_words], font[i], 0xFFFFFFFF);
+  }
+
+  memset(fb, 0, pitch * height);
+  dirty_first = 1;
+  dirty_last = 0;
+
+  return 1;
+}
+
+uint32_t fbcon_cols()
+{
+  return cols;
+}
+
+uint32_t fbcon_rows()
+{
+  return rows;
+}
+
+void fbcon_touch(uint32_t row)
+{
+  if (dirty_first > dirty_last) {
+    dirty_first = dirty_last = row;
+  } else if (row < dirty_first) {
+    dirty_first = row;
+  } else if (row > dirty_last) {
+    dirty_last = row;
+  }
+}
+
+void fbcon_touch_all()
+{
+  dirty_first = 0;
+  dirty_last = rows - 1;
+}
+
+void fbcon_scroll()
+{
+  if (!panning) {
+    /* every row has new contents */
+    fbcon_touch_all();
+    return;
+  }
+
+  if (y_offset + height + VBE_FONT_HEIGHT <= virtual_height) {
+    /* what is on screen moves up along with the cells, so only the rows
+      not drawn yet and the new last row need drawing */
+    y_offset += VBE_FONT_HEIGHT;
+    if (dirty_first <= dirty_last) {
+      dirty_first = dirty_first ? dirty_first - 1 : 0;
+      dirty_last = dirty_last ? dirty_last - 1 : 0;
+    }
+    fbcon_touch(rows - 1);
+  } else {
+    /* out of virtual lines, start over at the top */
+    y_offset = 0;
+    fbcon_touch_all();
+  }
+
+  /* lines below the last row, if the height is not a multiple of the font */
+  memset(fb + (y_offset + rows * VBE_FONT_HEIGHT) * pitch, 0, (height - rows * VBE_FONT_HEIGHT) * pitch);
+
+  dispi_write(DISPI_INDEX_Y_OFFSET, y_offset);
+}
+
+/* draws one row of cells, one scanline at a time across the whole row */
+static void fbcon_draw_row(uint16_t* cells, uint32_t row)
+{
+  uint8_t* first_line = fb + (y_offset + row * VBE_FONT_HEIGHT) * pitch;
+  uint16_t* row_cells = cells + row * cols;
+  uint32_t line, c, w;
+
+  for (line = 0; line < VBE_FONT_HEIGHT; line++) {
+    uint32_t* dest = (uint32_t*)(first_line + line * pitch);
+
+    for (c = 0; c < cols; c++) {
+      uint16_t cell = row_cells[c];
+      uint32_t* glyph = &glyphs[((cell & 0xFF) * VBE_FONT_HEIGHT + line) * glyph_line_words];
+      uint32_t* fg = palette[(cell >> 8) & 0x0F];
+      uint32_t* bg = palette[(cell >> 12) & 0x0F];
+
+      for (w = 0; w < glyph_line_words; w++) {
+        *dest++ = (glyph[w] & fg[w]) | (~glyph[w] & bg[w]);
+      }
+    }
+  }
+}
+
+void fbcon_flush(uint16_t* cells)
+{
+  uint32_t row;
+
+  if (dirty_first > dirty_last) {
+    return;
+  }
+
+  for (row = dirty_first; row <= dirty_last; row++) {
+    fbcon_draw_row(cells, row);
+  }
+
+  dirty_first = 1;
+  dirty_last = 0;
+}
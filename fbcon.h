@@ -0,0 +1,41 @@
+#ifndef FBCON_H
+#define FBCON_H
+
+#include <stdint.h>
+
+/*
+  A text console on the VBE linear framebuffer that stage2 sets up.
+
+  screen.c keeps the text in a buffer of VGA style cells (character +
+  attribute), and tells us which rows changed; fbcon_flush() draws the
+  changed rows, a whole row of cells per scanline. Glyphs come from a
+  cache expanded to the pixel format of the mode, so drawing a glyph
+  line is a couple of and/or word operations per 8 pixels.
+ */
+
+/* where the framebuffer is mapped in kernel space */
+#define FBCON_BASE 0xD0000000
+
+/* enough for 1920x1200 with an 8x16 font */
+#define FBCON_MAX_COLS 240
+#define FBCON_MAX_ROWS 75
+
+/* returns non-zero if stage2 set a VBE mode we can draw on */
+uint32_t init_fbcon();
+
+uint32_t fbcon_cols();
+uint32_t fbcon_rows();
+
+/* marks a row of cells as changed */
+void fbcon_touch(uint32_t row);
+
+/* marks every row as changed */
+void fbcon_touch_all();
+
+/* the cells have moved one row up */
+void fbcon_scroll();
+
+/* draws the changed rows of "cells" (fbcon_cols() x fbcon_rows()) */
+void fbcon_flush(uint16_t* cells);
+
+#endif
@@ -0,0 +1,119 @@
+#include <frame.h>
+#include <memory.h>
+#include <magazine.h>
+#include <spinlock.h>
+
+/* defined by kernel.ld */
+extern uint8_t _kernel_end[];
+
+/* 32 bits wide, as every process's reads of untouched memory share the
+  zero page, which must never be freed through an overflow */
+static uint32_t refcounts[FRAMES];
+
+/* frames that have been freed are linked through their first word;
+  we can do that as all managed memory is identity mapped */
+static uint32_t free_list = 0;
+static uint32_t free_count = 0;
+
+/* frames above "next_unused" have never been handed out, so there is
+  no need to touch all of memory up front to build the free list */
+static uint32_t next_unused;
+static uint32_t memory_top;
+
+/* of the above; frame_alloc() and the last frame_unref() mostly only
+  touch the magazines of their own CPU */
+static spinlock_t lock;
+static magazine_cache_t magazines;
+
+/* a magazine's worth from the free list, then from the never used frames */
+static uint32_t frame_fill(void* context, void** frames, uint32_t count)
+{
+  uint32_t n, frame;
+
+  spin_lock(&lock);
+  for (n = 0; n < count; n++) {
+    if (free_list) {
+      frame = free_list;
+      free_list = *(uint32_t*)frame;
+    } else if (next_unused < memory_top) {
+      frame = next_unused;
+      next_unused += PAGE_SIZE;
+    } else {
+      break;
+    }
+    frames[n] = (void*)frame;
+  }
+  free_count -= n;
+  spin_unlock(&lock);
+
+  return n;
+}
+
+static void frame_drain(void* context, void** frames, uint32_t count)
+{
+  uint32_t k, frame;
+
+  spin_lock(&lock);
+  for (k = 0; k < count; k++) {
+    frame = (uint32_t)frames[k];
+    *(uint32_t*)frame = free_list;
+    free_list = frame;
+  }
+  free_count += count;
+  spin_unlock(&lock);
+}
+
+void init_frames(uint32_t top)
+{
+  if (top > FRAME_MEMORY_MAX) {
+    top = FRAME_MEMORY_MAX;
+  }
+
+  memory_top = top & PAGE_MASK;
+  next_unused = ((uint32_t)_kernel_end + PAGE_SIZE - 1) & PAGE_MASK;
+  free_list = 0;
+  free_count = (memory_top - next_unused) >> PAGE_SHIFT;
+
+  magazine_init(&magazines, frame_fill, frame_drain, 0);
+}
+
+uint32_t frame_alloc()
+{
+  uint32_t frame = (uint32_t)magazine_alloc(&magazines);
+
+  if (frame) {
+    refcounts[frame >> PAGE_SHIFT] = 1;
+  }
+  return frame;
+}
+
+uint32_t frame_alloc_zeroed()
+{
+  uint32_t frame = frame_alloc();
+  if (frame) {
+    memset((uint8_t*)frame, 0, PAGE_SIZE);
+  }
+  return frame;
+}
+
+void frame_ref(uint32_t frame)
+{
+  refcounts[frame >> PAGE_SHIFT]++;
+}
+
+void frame_unref(uint32_t frame)
+{
+  if (--refcounts[frame >> PAGE_SHIFT] == 0) {
+    magazine_free(&magazines, (void*)frame);
+  }
+}
+
+uint32_t frame_refcount(uint32_t frame)
+{
+  return refcounts[frame >> PAGE_SHIFT];
+}
+
+uint32_t frames_free()
+{
+  return free_count + magazine_cached(&magazines);
+}
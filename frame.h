@@ -0,0 +1,46 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_SHIFT 12
+#define PAGE_MASK (~(PAGE_SIZE - 1))
+
+/* physical memory we are able to manage, and that is identity mapped */
+#define FRAME_MEMORY_MAX 0x4000000 /* 64 MB */
+#define FRAMES (FRAME_MEMORY_MAX >> PAGE_SHIFT)
+
+/* used until we can ask the firmware */
+#define FRAME_MEMORY_DEFAULT 0x2000000 /* 32 MB */
+
+/*
+  Physical page frame allocator. Every frame has a reference count so
+  frames can be shared between address spaces (copy-on-write): a frame
+  is freed when its last reference is dropped. Free frames are cached
+  per CPU in magazines (magazine.h), so the lock on the free list is
+  only taken to move a magazine's worth at a time.
+ */
+
+/* hands out frames from the end of the kernel up to "memory_top" */
+void init_frames(uint32_t memory_top);
+
+/* returns the physical address of a frame with a reference count of 1,
+  or 0 if we are out of memory. The contents are undefined. */
+uint32_t frame_alloc();
+
+/* like frame_alloc(), but the frame is filled with zeroes */
+uint32_t frame_alloc_zeroed();
+
+/* adds a reference to an allocated frame */
+void frame_ref(uint32_t frame);
+
+/* drops a reference, freeing the frame when it was the last one */
+void frame_unref(uint32_t frame);
+
+uint32_t frame_refcount(uint32_t frame);
+
+/* number of frames not handed out */
+uint32_t frames_free();
+
+#endif
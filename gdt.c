@@ -1,11 +1,10 @@
 #include <gdt.h>
 
-/*static uint16_t current_entry = 0;
-static gdt_t entries[MAX_ENTRIES];
+static gdt_t entries[GDT_ENTRIES];
 static gdtr_t gdtr = {
-  .size = MAX_ENTRIES * sizeof(gdt_t) - 1,
-  .first = &entries[0]
-}*/
+  .size = GDT_ENTRIES * sizeof(gdt_t) - 1,
+  .entries = &entries[0]
+};
 
 void gdt_create_entry(gdt_t* entry, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags)
 {
@@ -16,3 +15,27 @@ void gdt_create_entry(gdt_t* entry, uint32_t base, uint32_t limit, uint8_t acces
   entry->flags = (flags << 4) | ((limit >> 16) & 0xF);
   entry->base3 = (base >> 24) & 0xFF;
 }
+
+void gdt_set_entry(uint16_t index, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags)
+{
+  gdt_create_entry(&entries[index], base, limit, access, flags);
+}
+
+void init_gdt()
+{
+  /* entry 0 is the null descriptor */
+  gdt_create_entry(&entries[GDT_NULL_INDEX], 0, 0, 0, 0);
+
+  /* all segments map the whole 4 GB; protection between kernel and user
+    space is done by privilege level (and later on, by paging) */
+  gdt_create_entry(&entries[GDT_KERNEL_CODE_INDEX], 0x00000000, 0x000fffff, GDT_KERNEL_CODE, GDT_FLAGS_32BIT);
+  gdt_create_entry(&entries[GDT_KERNEL_DATA_INDEX], 0x00000000, 0x000fffff, GDT_KERNEL_DATA, GDT_FLAGS_32BIT);
+  gdt_create_entry(&entries[GDT_USER_CODE_INDEX], 0x00000000, 0x000fffff, GDT_USER_CODE, GDT_FLAGS_32BIT);
+  gdt_create_entry(&entries[GDT_USER_DATA_INDEX], 0x00000000, 0x000fffff, GDT_USER_DATA, GDT_FLAGS_32BIT);
+
+  /* the TSS descriptors are filled in by init_tss() and tss_set_double_fault() */
+  gdt_create_entry(&entries[GDT_TSS_INDEX], 0, 0, 0, 0);
+  gdt_create_entry(&entries[GDT_DOUBLE_FAULT_TSS_INDEX], 0, 0, 0, 0);
+
+  set_gdt(&gdtr, KERNEL_CODE_SELECTOR, KERNEL_DATA_SELECTOR);
+}
@@ -76,9 +76,48 @@ typedef struct {
 
 #define MAX_ENTRIES 8192 /* sizeof(uint16_t) / sizeof(gdt_t) */
 
+/*
+  The layout of the kernel GDT. The order of the first four descriptors
+  is dictated by SYSENTER/SYSEXIT: given the kernel code selector in
+  IA32_SYSENTER_CS, the CPU uses CS + 8 for the kernel stack, CS + 16
+  for user code and CS + 24 for the user stack.
+ */
+#define GDT_NULL_INDEX 0
+#define GDT_KERNEL_CODE_INDEX 1
+#define GDT_KERNEL_DATA_INDEX 2
+#define GDT_USER_CODE_INDEX 3
+#define GDT_USER_DATA_INDEX 4
+#define GDT_TSS_INDEX 5
+#define GDT_DOUBLE_FAULT_TSS_INDEX 6
+#define GDT_ENTRIES 7
+
+/* segment selectors, ((index) << 3) | ((ti) << 2) | (rpl) */
+#define KERNEL_CODE_SELECTOR (GDT_KERNEL_CODE_INDEX << 3)
+#define KERNEL_DATA_SELECTOR (GDT_KERNEL_DATA_INDEX << 3)
+#define USER_CODE_SELECTOR ((GDT_USER_CODE_INDEX << 3) | 3)
+#define USER_DATA_SELECTOR ((GDT_USER_DATA_INDEX << 3) | 3)
+#define TSS_SELECTOR (GDT_TSS_INDEX << 3)
+#define DOUBLE_FAULT_TSS_SELECTOR (GDT_DOUBLE_FAULT_TSS_INDEX << 3)
+
+/* access bytes */
+#define GDT_KERNEL_CODE 0x9a /* present, ring 0, executable, readable */
+#define GDT_KERNEL_DATA 0x92 /* present, ring 0, writable */
+#define GDT_USER_CODE 0xfa /* present, ring 3, executable, readable */
+#define GDT_USER_DATA 0xf2 /* present, ring 3, writable */
+#define GDT_TSS 0x89 /* present, ring 0, 32-bit available TSS */
+
+/* flags: 4 kB granularity, 32-bit */
+#define GDT_FLAGS_32BIT 0xc
+
 extern void get_gdt(gdtr_t*);
 extern void set_gdt(gdtr_t*, uint16_t, uint16_t);
 
 void gdt_create_entry(gdt_t*, uint32_t, uint32_t, uint8_t, uint8_t);
 
+/* sets up a flat kernel and user space in the kernel GDT, and loads it */
+void init_gdt();
+
+/* (re)writes a descriptor in the kernel GDT */
+void gdt_set_entry(uint16_t index, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags);
+
 #endif
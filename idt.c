@@ -0,0 +1,39 @@
+#include <idt.h>
+#include <gdt.h>
+#include <memory.h>
+
+static idt_t entries[IDT_ENTRIES];
+static idtr_t idtr = {
+  .size = IDT_ENTRIES * sizeof(idt_t) - 1,
+  .entries = &entries[0]
+};
+
+void idt_set_gate(uint8_t vector, void (*handler)(void), uint8_t type_attr)
+{
+  uint32_t offset = (uint32_t)handler;
+  idt_t* entry = &entries[vector];
+
+  entry->offset1 = offset & 0xFFFF;
+  entry->selector = KERNEL_CODE_SELECTOR;
+  entry->zero = 0;
+  entry->type_attr = type_attr;
+  entry->offset2 = (offset >> 16) & 0xFFFF;
+}
+
+void idt_set_task_gate(uint8_t vector, uint16_t selector)
+{
+  idt_t* entry = &entries[vector];
+
+  entry->offset1 = 0;
+  entry->selector = selector;
+  entry->zero = 0;
+  entry->type_attr = IDT_TASK_GATE;
+  entry->offset2 = 0;
+}
+
+void init_idt()
+{
+  /* all gates start out as not present */
+  memset((uint8_t*)entries, 0, sizeof(entries));
+  set_idt(&idtr);
+}
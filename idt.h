@@ -0,0 +1,65 @@
+#ifndef IDT_H
+#define IDT_H
+
+#include <stdint.h>
+
+/*
+
+15                                   0
++------------------------------------+
+|           Offset 31:16             |  offset2
++----+-------+---+----+--------------+
+| P  |  DPL  | S |    Gate type      |  type_attr
++----+-------+---+-------------------+
+|              zero                  |
++------------------------------------+
+|         Segment selector           |  selector
++------------------------------------+
+|           Offset 15:00             |  offset1
++------------------------------------+
+        Interrupt gate descriptor
+
+  P
+    Present - set to "0" for unused interrupts
+  DPL
+    Descriptor privilege level - the lowest privilege level
+      the calling code may have for "int n" to be allowed
+  S
+    Storage segment - "0" for interrupt and trap gates
+  Gate type
+    0x5 - task gate (switches to the TSS in the selector; no offset)
+    0xE - 32-bit interrupt gate (clears IF on entry)
+    0xF - 32-bit trap gate (leaves IF alone)
+ */
+typedef struct {
+  uint16_t offset1; // offset 15:00
+  uint16_t selector; // code segment selector
+  uint8_t zero;
+  uint8_t type_attr;
+  uint16_t offset2; // offset 31:16
+} __attribute__((packed)) idt_t;
+
+typedef struct {
+  uint16_t size; /* size (in bytes) of the IDT, minus 1 */
+  idt_t* entries;
+} __attribute__((packed)) idtr_t;
+
+#define IDT_ENTRIES 256
+
+#define IDT_INTERRUPT_GATE 0x8e /* present, ring 0, 32-bit interrupt gate */
+#define IDT_TRAP_GATE 0x8f /* present, ring 0, 32-bit trap gate */
+#define IDT_TASK_GATE 0x85 /* present, ring 0, task gate */
+#define IDT_USER 0x60 /* DPL 3, may be combined with the above */
+
+extern void set_idt(idtr_t*);
+
+/* installs an empty IDT */
+void init_idt();
+
+/* points "vector" at "handler", running in the kernel code segment */
+void idt_set_gate(uint8_t vector, void (*handler)(void), uint8_t type_attr);
+
+/* makes "vector" switch to the task whose TSS descriptor is "selector" */
+void idt_set_task_gate(uint8_t vector, uint16_t selector);
+
+#endif
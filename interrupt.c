@@ -0,0 +1,48 @@
+#include <interrupt.h>
+#include <idt.h>
+#include <pic.h>
+#include <crash.h>
+#include <compiler.h>
+
+/* defined in isr.s */
+extern uint32_t isr_table[];
+
+static interrupt_handler_t handlers[IDT_ENTRIES];
+
+void interrupt_unhandled(trap_frame_t* frame)
+{
+  crash(frame);
+}
+
+void init_interrupts()
+{
+  uint32_t i;
+  for (i = 0; i < INTERRUPT_STUBS; i++) {
+    idt_set_gate(i, (void (*)(void))isr_table[i], IDT_INTERRUPT_GATE);
+  }
+}
+
+void interrupt_register(uint8_t vector, interrupt_handler_t handler)
+{
+  handlers[vector] = handler;
+}
+
+HOT void interrupt_dispatch(trap_frame_t* frame)
+{
+  interrupt_handler_t handler = handlers[frame->vector];
+
+  if (frame->vector >= IRQ_VECTOR(0) && frame->vector < INTERRUPT_STUBS) {
+    /* interrupts stay disabled until we return, so it is safe to
+      acknowledge before handling */
+    if (pic_acknowledge(frame->vector - IRQ_VECTOR(0)) && handler) {
+      handler(frame);
+    }
+    return;
+  }
+
+  if (handler) {
+    handler(frame);
+  } else {
+    interrupt_unhandled(frame);
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include <stdint.h>
+
+#define EXCEPTION_DIVIDE_ERROR 0
+#define EXCEPTION_DEBUG 1
+#define EXCEPTION_NMI 2
+#define EXCEPTION_BREAKPOINT 3
+#define EXCEPTION_OVERFLOW 4
+#define EXCEPTION_BOUND_RANGE 5
+#define EXCEPTION_INVALID_OPCODE 6
+#define EXCEPTION_DEVICE_NOT_AVAILABLE 7
+#define EXCEPTION_DOUBLE_FAULT 8
+#define EXCEPTION_INVALID_TSS 10
+#define EXCEPTION_SEGMENT_NOT_PRESENT 11
+#define EXCEPTION_STACK_FAULT 12
+#define EXCEPTION_GENERAL_PROTECTION 13
+#define EXCEPTION_PAGE_FAULT 14
+#define EXCEPTION_FPU_ERROR 16
+#define EXCEPTION_ALIGNMENT_CHECK 17
+#define EXCEPTION_MACHINE_CHECK 18
+#define EXCEPTION_SIMD_ERROR 19
+#define EXCEPTIONS 32
+
+/* hardware interrupts follow the exceptions, see init_pic() */
+#define IRQ_VECTOR(irq) (EXCEPTIONS + (irq))
+#define INTERRUPT_STUBS (EXCEPTIONS + 16)
+
+/*
+  The stack layout built by isr_common in isr.s, lowest address first.
+  user_esp and user_ss are only pushed by the CPU when the interrupt
+  came from ring 3.
+ */
+typedef struct {
+  uint32_t gs, fs, es, ds;
+  uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; /* pusha */
+  uint32_t vector;
+  uint32_t error_code;
+  uint32_t eip, cs, eflags; /* pushed by the CPU */
+  uint32_t user_esp, user_ss;
+} trap_frame_t;
+
+typedef void (*interrupt_handler_t)(trap_frame_t*);
+
+/* points the exception and IRQ vectors at the stubs in isr.s */
+void init_interrupts();
+
+void interrupt_register(uint8_t vector, interrupt_handler_t handler);
+
+/* reports the interrupt with crash() and halts; the default for unregistered vectors */
+void interrupt_unhandled(trap_frame_t* frame);
+
+/* called by isr_common */
+void interrupt_dispatch(trap_frame_t* frame);
+
+static inline void interrupts_enable()
+{
+  __asm__ __volatile__ ("sti" : : : "memory");
+}
+
+static inline void interrupts_disable()
+{
+  __asm__ __volatile__ ("cli" : : : "memory");
+}
+
+/*
+  Sleeps until the next interrupt. "sti" only takes effect after the
+  next instruction, so an interrupt arriving between a check done with
+  interrupts disabled and the "hlt" still wakes us up.
+ */
+static inline void interrupts_wait()
+{
+  __asm__ __volatile__ ("sti; hlt" : : : "memory");
+}
+
+/* non-zero if the frame was pushed on entry from ring 3 */
+static inline uint32_t trap_from_user(trap_frame_t* frame)
+{
+  return (frame->cs & 3) == 3;
+}
+
+/*
+  The stack pointer when the trap happened. Without a change of
+  privilege level the CPU does not push it, the stack simply continues
+  where user_esp would have been.
+ */
+static inline uint32_t trap_esp(trap_frame_t* frame)
+{
+  return trap_from_user(frame) ? frame->user_esp : (uint32_t)&frame->user_esp;
+}
+
+#endif
@@ -13,3 +13,31 @@ void outportb (uint16_t port, uint8_t data)
 {
     __asm__ __volatile__ ("outb %1, %0" : : "dN" (port), "a" (data));
 }
+
+/* read a word from the I/O port */
+uint16_t inportw (uint16_t port)
+{
+    uint16_t rv;
+    __asm__ __volatile__ ("inw %1, %0" : "=a" (rv) : "dN" (port));
+    return rv;
+}
+
+/* write a word to I/O port */
+void outportw (uint16_t port, uint16_t data)
+{
+    __asm__ __volatile__ ("outw %1, %0" : : "dN" (port), "a" (data));
+}
+
+/* read a dword from the I/O port */
+uint32_t inportl (uint16_t port)
+{
+    uint32_t rv;
+    __asm__ __volatile__ ("inl %1, %0" : "=a" (rv) : "dN" (port));
+    return rv;
+}
+
+/* write a dword to I/O port */
+void outportl (uint16_t port, uint32_t data)
+{
+    __asm__ __volatile__ ("outl %1, %0" : : "dN" (port), "a" (data));
+}
@@ -9,4 +9,16 @@ uint8_t inportb (uint16_t port);
 /* write to I/O port */
 void outportb (uint16_t port, uint8_t data);
 
+/* read a word from the I/O port */
+uint16_t inportw (uint16_t port);
+
+/* write a word to I/O port */
+void outportw (uint16_t port, uint16_t data);
+
+/* read a dword from the I/O port */
+uint32_t inportl (uint16_t port);
+
+/* write a dword to I/O port */
+void outportl (uint16_t port, uint32_t data);
+
 #endif
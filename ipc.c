@@ -0,0 +1,350 @@
+#include <ipc.h>
+#include <process.h>
+#include <syscall.h>
+#include <vm.h>
+#include <frame.h>
+#include <memory.h>
+#include <screen.h>
+#include <cpu.h>
+
+#define BENCH_ROUND_TRIPS 10000
+#define BENCH_GRANTS 1000
+#define BENCH_ROUNDS 8
+
+/* the argument of ipc_bench_main(): the channels, and what to measure */
+#define BENCH_ARG(request, reply, flags) ((request) | (reply) << 8 | (flags))
+#define BENCH_SYSENTER 0x10000
+#define BENCH_BULK 0x20000
+
+/* the second word that ends the benchmark server */
+#define BENCH_STOP 1
+
+typedef struct {
+  uint32_t used;
+  uint32_t head; /* the oldest message */
+  uint32_t count;
+  ipc_message_t messages[IPC_DEPTH];
+  process_queue_t receivers; /* waiting for a message, while there are none */
+  process_queue_t senders; /* waiting for room, while the channel is full */
+} channel_t;
+
+static channel_t channels[IPC_CHANNELS];
+
+static channel_t* channel_get(uint32_t channel)
+{
+  return channel < IPC_CHANNELS && channels[channel].used ? &channels[channel] : 0;
+}
+
+/* only as much of the message as is used, usually the two words */
+static void message_copy(ipc_message_t* to, const ipc_message_t* from)
+{
+  uint32_t k;
+
+  to->data = from->data;
+  to->pages = from->pages;
+  for (k = 0; k < from->pages; k++) {
+    to->entries[k] = from->entries[k];
+  }
+}
+
+/* maps the pages of "message" for its receiver; returns what its SYS_RECEIVE does */
+static uint64_t message_deliver(const ipc_message_t* message, vm_space_t* space, uint32_t address)
+{
+  if (message->pages && !vm_give_pages(space, address, message->pages, message->entries)) {
+    return IPC_ERROR;
+  }
+  return message->data;
+}
+
+uint32_t ipc_channel_create()
+{
+  uint32_t k;
+
+  for (k = 0; k < IPC_CHANNELS; k++) {
+    if (!channels[k].used) {
+      memset((uint8_t*)&channels[k], 0, sizeof(channel_t));
+      channels[k].used = 1;
+      return k;
+    }
+  }
+  return IPC_NONE;
+}
+
+void ipc_channel_destroy(uint32_t id)
+{
+  channel_t* channel = channel_get(id);
+  ipc_message_t* message;
+
+  if (!channel) {
+    return;
+  }
+
+  while (channel->count) {
+    message = &channel->messages[channel->head];
+    vm_drop_pages(message->pages, message->entries);
+    channel->head = (channel->head + 1) % IPC_DEPTH;
+    channel->count--;
+  }
+  channel->used = 0;
+}
+
+static uint32_t channel_send(channel_t* channel, const ipc_message_t* message)
+{
+  process_t* self = process_current();
+  process_t* receiver = process_dequeue(&channel->receivers);
+  uint64_t result;
+
+  if (receiver) {
+    result = message_deliver(message, receiver->space, receiver->receive_address);
+    if (!self) {
+      process_wake(receiver, result);
+      return 0;
+    }
+    /* the receiver is what we are waiting on, most likely */
+    process_switch(receiver, result, 0);
+  }
+
+  if (channel->count < IPC_DEPTH) {
+    message_copy(&channel->messages[(channel->head + channel->count) % IPC_DEPTH], message);
+    channel->count++;
+    return 0;
+  }
+
+  if (!self) {
+    vm_drop_pages(message->pages, message->entries);
+    return (uint32_t)-1;
+  }
+
+  /* until a receiver makes room, and takes the message from us */
+  message_copy(&self->message, message);
+  process_enqueue(&channel->senders, self);
+  process_block();
+}
+
+uint32_t ipc_send(uint32_t id, uint32_t first, uint32_t second)
+{
+  channel_t* channel = channel_get(id);
+  ipc_message_t message;
+
+  if (!channel) {
+    return (uint32_t)-1;
+  }
+
+  message.data = first | (uint64_t)second << 32;
+  message.pages = 0;
+  return channel_send(channel, &message);
+}
+
+uint32_t ipc_grant(uint32_t id, uint32_t address, uint32_t pages)
+{
+  channel_t* channel = channel_get(id);
+  process_t* self = process_current();
+  ipc_message_t message;
+
+  if (!channel || !self || !pages || pages > IPC_GRANT_PAGES) {
+    return (uint32_t)-1;
+  }
+
+  if (!vm_take_pages(self->space, address, pages, message.entries)) {
+    return (uint32_t)-1;
+  }
+  message.data = pages | (uint64_t)IPC_GRANT << 32;
+  message.pages = pages;
+  return channel_send(channel, &message);
+}
+
+uint64_t ipc_receive(uint32_t id, uint32_t address)
+{
+  channel_t* channel = channel_get(id);
+  process_t* self = process_current();
+  process_t* sender;
+  uint64_t result;
+
+  if (!channel || !self) {
+    return IPC_ERROR;
+  }
+
+  /* the sender delivers it, see channel_send() */
+  if (!channel->count) {
+    self->receive_address = address;
+    process_enqueue(&channel->receivers, self);
+    process_block();
+  }
+
+  result = message_deliver(&channel->messages[channel->head], self->space, address);
+  channel->head = (channel->head + 1) % IPC_DEPTH;
+  channel->count--;
+
+  sender = process_dequeue(&channel->senders);
+  if (sender) {
+    message_copy(&channel->messages[(channel->head + channel->count) % IPC_DEPTH], &sender->message);
+    channel->count++;
+    process_wake(sender, 0);
+  }
+
+  return result;
+}
+
+void ipc_abandon()
+{
+  process_t* sender;
+  uint32_t k;
+
+  for (k = 0; k < IPC_CHANNELS; k++) {
+    while ((sender = process_dequeue(&channels[k].senders))) {
+      vm_drop_pages(sender->message.pages, sender->message.entries);
+    }
+    channels[k].receivers.head = 0;
+    channels[k].receivers.tail = 0;
+  }
+}
+
+/*
+  Runs in ring 3: forks a server that answers every message on the
+  request channel with the next number, and sends granted pages back.
+  Returns the best average cycles for a round trip of a message, or
+  of IPC_GRANT_PAGES pages with BENCH_BULK, or 0 if the server got it
+  wrong.
+ */
+static USER_TEXT uint32_t ipc_bench_main(uint32_t arg)
+{
+  syscall_entry_t entry = (arg & BENCH_SYSENTER) ? syscall_sysenter : syscall_int80;
+  uint32_t request = arg & 0xFF, reply = (arg >> 8) & 0xFF;
+  uint32_t bulk = arg & BENCH_BULK, iterations = bulk ? BENCH_GRANTS : BENCH_ROUND_TRIPS;
+  volatile uint8_t* buffer = (uint8_t*)USER_HEAP_BASE;
+  uint32_t i, round, cycles, best = 0xFFFFFFFF;
+  uint64_t message, start;
+
+  if (entry(SYS_FORK, 0, 0, 0) == 0) {
+    while (1) {
+      message = entry(SYS_RECEIVE, request, (uint32_t)buffer, 0);
+      if ((uint32_t)(message >> 32) == BENCH_STOP) {
+        return 0;
+      }
+      if ((uint32_t)(message >> 32) == IPC_GRANT) {
+        entry(SYS_GRANT, reply, (uint32_t)buffer, (uint32_t)message);
+      } else {
+        entry(SYS_SEND, reply, (uint32_t)message + 1, 0);
+      }
+    }
+  }
+
+  /* pages of our own to move, rather than the zero page */
+  if (bulk) {
+    for (i = 0; i < IPC_GRANT_PAGES; i++) {
+      buffer[i * PAGE_SIZE] = 1;
+    }
+  }
+
+  for (round = 0; round < BENCH_ROUNDS && best; round++) {
+    start = rdtsc();
+    for (i = 0; i < iterations; i++) {
+      if (bulk) {
+        entry(SYS_GRANT, request, (uint32_t)buffer, IPC_GRANT_PAGES);
+        message = entry(SYS_RECEIVE, reply, (uint32_t)buffer, 0);
+        if (message != (IPC_GRANT_PAGES | (uint64_t)IPC_GRANT << 32) || buffer[0] != 1) {
+          best = 0;
+          break;
+        }
+      } else {
+        entry(SYS_SEND, request, i, 0);
+        message = entry(SYS_RECEIVE, reply, 0, 0);
+        if (message != i + 1) {
+          best = 0;
+          break;
+        }
+      }
+    }
+    cycles = (uint32_t)(rdtsc() - start) / iterations;
+
+    if (cycles < best) {
+      best = cycles;
+    }
+  }
+
+  entry(SYS_SEND, request, 0, BENCH_STOP);
+  return best;
+}
+
+static uint32_t ipc_bench_run(uint32_t flags)
+{
+  uint32_t request = ipc_channel_create();
+  uint32_t reply = ipc_channel_create();
+  uint32_t result = 0;
+  process_t* process;
+
+  if (request != IPC_NONE && reply != IPC_NONE) {
+    process = process_create(ipc_bench_main, BENCH_ARG(request, reply, flags));
+    if (process) {
+      result = process_run(process);
+    }
+  }
+
+  ipc_channel_destroy(request);
+  ipc_channel_destroy(reply);
+  return result;
+}
+
+/* copying what a grant moves, there and back, for comparison */
+static uint32_t ipc_bench_copy()
+{
+  uint32_t pages[2 * IPC_GRANT_PAGES], k, round, cycles, best = 0xFFFFFFFF;
+  uint64_t start;
+
+  for (k = 0; k < 2 * IPC_GRANT_PAGES; k++) {
+    pages[k] = frame_alloc_zeroed();
+    if (!pages[k]) {
+      best = 0;
+    }
+  }
+
+  for (round = 0; round < BENCH_ROUNDS && best; round++) {
+    start = rdtsc();
+    for (k = 0; k < IPC_GRANT_PAGES; k++) {
+      memcpy((uint8_t*)pages[IPC_GRANT_PAGES + k], (uint8_t*)pages[k], PAGE_SIZE);
+    }
+    for (k = 0; k < IPC_GRANT_PAGES; k++) {
+      memcpy((uint8_t*)pages[k], (uint8_t*)pages[IPC_GRANT_PAGES + k], PAGE_SIZE);
+    }
+    cycles = (uint32_t)(rdtsc() - start);
+
+    if (cycles < best) {
+      best = cycles;
+    }
+  }
+
+  for (k = 0; k < 2 * IPC_GRANT_PAGES; k++) {
+    if (pages[k]) {
+      frame_unref(pages[k]);
+    }
+  }
+  return best;
+}
+
+static void ipc_bench_print(char* name, uint32_t cycles)
+{
+  printstr(name);
+  if (cycles) {
+    printk(cycles);
+    printstr(" cycles\n");
+  } else {
+    printstr("failed\n");
+  }
+}
+
+void ipc_benchmark()
+{
+  uint32_t fast = syscall == syscall_sysenter ? BENCH_SYSENTER : 0;
+
+  if (!cpu_has(CPU_FEATURE_TSC)) {
+    printstr("IPC benchmark: no TSC\n");
+    return;
+  }
+
+  ipc_bench_print("IPC round trip, int 0x80: ", ipc_bench_run(0));
+  if (fast) {
+    ipc_bench_print("IPC round trip, sysenter: ", ipc_bench_run(BENCH_SYSENTER));
+  }
+  ipc_bench_print("IPC grant of 64 KB and back: ", ipc_bench_run(BENCH_BULK | fast));
+  ipc_bench_print("Copying 64 KB and back: ", ipc_bench_copy());
+}
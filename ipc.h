@@ -0,0 +1,76 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+
+/*
+  Message passing between processes, and from the kernel to them, over
+  bounded channels. A message is two words, passed in registers from
+  SYS_SEND to SYS_RECEIVE, or a run of pages granted with SYS_GRANT:
+  they move from the address space of the sender to that of the
+  receiver, page table entries and all, without a byte being copied.
+
+  Sending to a channel with a process waiting in it hands the message
+  straight to that process, which runs next. Otherwise the message
+  queues, and a sender only waits once IPC_DEPTH messages do.
+ */
+#define IPC_CHANNELS 16
+
+/* messages a channel holds before senders block */
+#define IPC_DEPTH 8
+
+/* the most pages one SYS_GRANT moves */
+#define IPC_GRANT_PAGES 16
+
+/* channel id for none */
+#define IPC_NONE 0xFFFFFFFF
+
+/* the second word of a grant, after the number of pages; don't send it yourself */
+#define IPC_GRANT 0xFFFFFFFE
+
+/* what SYS_RECEIVE returns for a bad channel, or pages it had no room for */
+#define IPC_ERROR 0xFFFFFFFFFFFFFFFFull
+
+typedef struct {
+  uint64_t data; /* what SYS_RECEIVE returns: the first word low */
+  uint32_t pages;
+  uint32_t entries[IPC_GRANT_PAGES]; /* the page table entries of the pages */
+} ipc_message_t;
+
+/* a new, empty channel, or IPC_NONE if there are none left */
+uint32_t ipc_channel_create();
+
+/* frees a channel nobody is blocked in, along with the messages never received */
+void ipc_channel_destroy(uint32_t channel);
+
+/*
+  SYS_SEND: queues "first" and "second" in "channel". Blocks while the
+  channel is full, except in the kernel, which cannot block and gets a
+  failure instead. Returns 0, or 0xFFFFFFFF on failure.
+ */
+uint32_t ipc_send(uint32_t channel, uint32_t first, uint32_t second);
+
+/*
+  SYS_GRANT: sends the "pages" pages at "address" in the running
+  process, leaving it with untouched memory there; the receiver gets
+  { pages, IPC_GRANT }. Returns like ipc_send().
+ */
+uint32_t ipc_grant(uint32_t channel, uint32_t address, uint32_t pages);
+
+/*
+  SYS_RECEIVE: the next message in "channel", waiting for one if need
+  be. The pages of a grant are mapped at "address", over whatever was
+  there; pass 0 if none are expected, and they are dropped.
+ */
+uint64_t ipc_receive(uint32_t channel, uint32_t address);
+
+/*
+  Forgets the processes blocked in channels, which are never going to
+  run again, along with the pages they were granting.
+ */
+void ipc_abandon();
+
+/* measures a message round trip between two processes, and moving pages against copying them */
+void ipc_benchmark();
+
+#endif
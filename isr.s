@@ -0,0 +1,119 @@
+# Interrupt service routine stubs. Every stub pushes the same trap frame
+# (see trap_frame_t in interrupt.h) and hands it to interrupt_dispatch().
+.text
+
+.equ KERNEL_DATA_SELECTOR, 0x10
+
+# for exceptions where the CPU does not push an error code,
+# push a dummy one so all frames look the same
+.macro isr_no_error vector
+isr\vector:
+	push $0
+	push $\vector
+	jmp isr_common
+.endm
+
+.macro isr_error vector
+isr\vector:
+	push $\vector
+	jmp isr_common
+.endm
+
+isr_no_error 0
+isr_no_error 1
+isr_no_error 2
+isr_no_error 3
+isr_no_error 4
+isr_no_error 5
+isr_no_error 6
+isr_no_error 7
+isr_error    8
+isr_no_error 9
+isr_error    10
+isr_error    11
+isr_error    12
+isr_error    13
+isr_error    14
+isr_no_error 15
+isr_no_error 16
+isr_error    17
+isr_no_error 18
+isr_no_error 19
+isr_no_error 20
+isr_error    21
+isr_no_error 22
+isr_no_error 23
+isr_no_error 24
+isr_no_error 25
+isr_no_error 26
+isr_no_error 27
+isr_no_error 28
+isr_error    29
+isr_error    30
+isr_no_error 31
+
+# IRQ 0-15, remapped by init_pic()
+isr_no_error 32
+isr_no_error 33
+isr_no_error 34
+isr_no_error 35
+isr_no_error 36
+isr_no_error 37
+isr_no_error 38
+isr_no_error 39
+isr_no_error 40
+isr_no_error 41
+isr_no_error 42
+isr_no_error 43
+isr_no_error 44
+isr_no_error 45
+isr_no_error 46
+isr_no_error 47
+
+isr_common:
+	pusha
+	push %ds
+	push %es
+	push %fs
+	push %gs
+
+	# we may come from ring 3 with user data segments loaded
+	mov $KERNEL_DATA_SELECTOR, %ax
+	mov %ax, %ds
+	mov %ax, %es
+	mov %ax, %fs
+	mov %ax, %gs
+
+	# void interrupt_dispatch(trap_frame_t*)
+	push %esp
+	call interrupt_dispatch
+	add $4, %esp
+
+	pop %gs
+	pop %fs
+	pop %es
+	pop %ds
+	popa
+
+	# discard vector and error code
+	add $8, %esp
+	iret
+
+# The double fault task starts here, on a stack of its own with the
+# error code on top (see tss_set_double_fault()); the state of what
+# faulted is in the kernel TSS. The call makes the error code the
+# argument of crash_double_fault(), which does not return.
+.globl isr_double_fault
+isr_double_fault:
+	call crash_double_fault
+
+# the addresses of the stubs above, indexed by vector
+.data
+.globl isr_table
+isr_table:
+	.long isr0, isr1, isr2, isr3, isr4, isr5, isr6, isr7
+	.long isr8, isr9, isr10, isr11, isr12, isr13, isr14, isr15
+	.long isr16, isr17, isr18, isr19, isr20, isr21, isr22, isr23
+	.long isr24, isr25, isr26, isr27, isr28, isr29, isr30, isr31
+	.long isr32, isr33, isr34, isr35, isr36, isr37, isr38, isr39
+	.long isr40, isr41, isr42, isr43, isr44, isr45, isr46, isr47
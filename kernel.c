@@ -1,15 +1,32 @@
 #include <stdint.h>
 #include <gdt.h>
+#include <idt.h>
+#include <tss.h>
+#include <cpu.h>
+#include <interrupt.h>
+#include <pic.h>
+#include <keyboard.h>
+#include <serial.h>
+#include <log.h>
+#include <timer.h>
+#include <profile.h>
+#include <pmc.h>
+#include <bench.h>
+#include <frame.h>
+#include <paging.h>
+#include <vm.h>
+#include <syscall.h>
+#include <process.h>
+#include <ipc.h>
 #include <screen.h>
 #include <io.h>
+#include <boot.h>
+#include <pci.h>
+#include <virtio_blk.h>
+#include <crash.h>
 
 /* defined in kernel_helpers.s */
-extern uint32_t get_eax(void);
-extern uint32_t get_ebx(void);
-extern uint32_t get_ecx(void);
-extern uint32_t get_edx(void);
-extern uint32_t get_esi(void);
-extern uint32_t get_edi(void);
+extern void get_registers(trap_frame_t*);
 
 #define BOOT_ADDR 0x7c00
 
@@ -127,32 +144,9 @@ void read_bpb() {
 }
 
 void dump_registers() {
-  printstr("EAX: ");
-  uint32_t eax = get_eax();
-  printhl(eax);
-
-  printstr(" EBX: ");
-  uint32_t ebx = get_ebx();
-  printhl(ebx);
-
-  printstr(" ECX: ");
-  uint32_t ecx = get_ecx();
-  printhl(ecx);
-
-  printstr(" EDX: ");
-  uint32_t edx = get_edx();
-  printhl(edx);
-  printstr("\n");
-
-  printstr("ESI: ");
-  uint32_t esi = get_esi();
-  printhl(esi);
-
-  printstr(" EDI: ");
-  uint32_t edi = get_edi();
-  printhl(edi);
-
-  printstr("\n");
+  trap_frame_t frame;
+  get_registers(&frame);
+  crash_print_registers(&frame, frame.esp);
 }
 
 void read_gdt() {
@@ -191,36 +185,43 @@ void read_gdt() {
   }
 }
 
-void init_gdt() {
-  gdt_t entries[3];
-  entries[1].limit1 = 0xffff;
-  entries[1].base1 = 0x0000;
-  entries[1].base2 = 0x00;
-  entries[1].access_byte = 0x9a;
-  entries[1].flags = 0xcf;
-  entries[1].base3 = 0x00;
-
-  entries[2].limit1 = 0xffff;
-  entries[2].base1 = 0x0000;
-  entries[2].base2 = 0x00;
-  entries[2].access_byte = 0x92;
-  entries[2].flags = 0xcf;
-  entries[2].base3 = 0x00;
-
-  gdtr_t gdtr = {
-    .size = 23,
-    .entries = &entries[0]
-  };
-
-  gdt_create_entry(&entries[1], 0x00000000, 0x000fffff, 0x92, 0xcf);
-  gdt_create_entry(&entries[2], 0x00000000, 0x000fffff, 0x92, 0xcf);
-
-  set_gdt(&gdtr, 0x08, 0x10);
-}
-
-void kernel_main()
+void kernel_main(uint32_t boot_magic, uint32_t boot_information)
 {
-  clear_screen();
+  init_boot(boot_magic, boot_information);
+  init_cpu();
+  init_serial();
+  init_log();
+  cpu_report();
+  log_write(LOG_INFO, "boot: loaded by %s, memory up to %u KB, command line \"%s\"",
+    boot_info.name, boot_info.memory_top / 1024, boot_info.command_line);
+  init_pmc();
+
+  init_gdt();
+  init_idt();
+  init_interrupts();
+  init_pic();
+  init_tss((uint32_t)ring0_stack_top);
+  init_syscalls((uint32_t)ring0_stack_top);
+
+  init_frames(boot_info.memory_top);
+  init_paging(boot_info.memory_top);
+  init_vm();
+  init_crash();
+  log_write(LOG_INFO, "memory: %u KB free", frames_free() * (PAGE_SIZE / 1024));
+
+  init_pci();
+  init_virtio_blk();
+
+  /* before any address space is created, as it maps the framebuffer */
+  init_screen();
+
+  init_keyboard();
+  init_timer();
+  init_profile();
+  interrupts_enable();
+
+  /* its timestamp is how long booting took, see util/profiles.sh */
+  log_write(LOG_INFO, "boot: ready");
 
   /* magic breakpoint for bochs */
   __asm__ __volatile__("xchg %bx, %bx");
@@ -240,14 +241,25 @@ void kernel_main()
   /*static char* s2 = "Welcome to David OS!\n";
   printstr(s2);*/
 
+#ifdef BENCHMARKS
+  bench_run_all();
+  bench_exit(0);
+#endif
+
   read_bpb();
   dump_registers();
 
+  profile_start();
+  syscall_benchmark();
+  process_benchmark();
+  ipc_benchmark();
+
   uint32_t u, v, w;
   for (w = 0; w < 5; w++) {
     for (u = 0; u < 10; u++) {
       for (v = 0; v < 0xFFFFFF; v++) {
-        /* NOP */
+        /* a real instruction, so optimized builds keep the loop */
+        __asm__ __volatile__ ("nop");
       }
     }
     printstr("Delay ");
@@ -255,5 +267,39 @@ void kernel_main()
     printstr("\n");
   }
 
-  while(1);
+  profile_dump();
+  pmc_report();
+
+  /*
+    The idle loop: hand the log to its sinks, echo what is typed (Ctrl-D
+    shows the whole log again, Ctrl-P starts the profiler and dumps it
+    to serial when pressed again), and sleep until the next interrupt.
+   */
+  key_event_t event;
+  uint32_t profiling = 0;
+  printstr("> ");
+  while (1) {
+    log_drain();
+
+    interrupts_disable();
+    if (!keyboard_poll(&event)) {
+      interrupts_wait();
+      continue;
+    }
+    interrupts_enable();
+
+    if (event.ascii == 4) {
+      printstr("\n");
+      log_rewind(LOG_SINK_CONSOLE);
+    } else if (event.ascii == 16) {
+      if (profiling) {
+        profile_dump();
+      } else {
+        profile_start();
+      }
+      profiling = !profiling;
+    } else if (event.ascii) {
+      printc(event.ascii);
+    }
+  }
 }
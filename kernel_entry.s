@@ -1,12 +1,55 @@
 # This file is for the Kernel entry, as the stage2 bootloader will jump
 # to the first byte in the kernel location (because we dont link the kernel with stage2,
 # stage2 does not know about any symbols like "kernel_main")
-.text
+# .text.entry goes first in kernel.ld, however the rest is ordered
+.section .text.entry, "ax"
+
+.equ BOOT_STACK_SIZE, 16384
+
+.equ MULTIBOOT_MAGIC, 0x1BADB002
+# page aligned modules, and tell us about memory
+.equ MULTIBOOT_FLAGS, 0x00000003
+
 .globl _start
 _start:
+	jmp multiboot_entry
+
+# lets a Multiboot loader (GRUB, "qemu-system-i386 -kernel kernel.out")
+# start the kernel; it has to be 4 byte aligned in the first 8 KB
+.align 4
+multiboot_header:
+	.long MULTIBOOT_MAGIC
+	.long MULTIBOOT_FLAGS
+	.long -(MULTIBOOT_MAGIC + MULTIBOOT_FLAGS)
+
+# stage2 and Multiboot loaders both come here in protected mode with
+# interrupts disabled, %eax saying which one it was and %ebx pointing at
+# its boot information (see boot.h)
+multiboot_entry:
+	# stage2 leaves us with whatever stack pointer it had in real mode,
+	# so switch to a stack we know the whereabouts of
+	mov $boot_stack_top, %esp
+	mov %eax, %esi
+
+	# .bss is not part of kernel.bin, so clear it before any C code runs
+	cld
+	mov $_bss, %edi
+	mov $_bss_end, %ecx
+	sub %edi, %ecx
+	xor %eax, %eax
+	rep stosb
+
+	push %ebx
+	push %esi
 	call kernel_main
 	# We should *never* end up here,
 	# but if we do, we'll limbo forever in the void!
 1:
 	hlt
 	jmp 1b
+
+.bss
+.align 16
+boot_stack:
+	.skip BOOT_STACK_SIZE
+boot_stack_top:
@@ -46,44 +46,73 @@ set_gdt:
 	mov %eax, %gs
 	mov %eax, %ss
 
-	pop %eax
-
-	mov %ebp, %esp
-	pop %ebp
-
 	# reload %cs register by doing a far return
-	push 16(%ebp)
+	push 12(%ebp)
 	push $gdt_is_set
-	retf
+	lret
 
 gdt_is_set:
-	ret
-
-.globl get_eax
-get_eax:
-	ret
+	pop %eax
 
-.globl get_ebx
-get_ebx:
-	mov %ebx, %eax
-	ret
+	mov %ebp, %esp
+	pop %ebp
 
-.globl get_ecx
-get_ecx:
-	mov %ecx, %eax
 	ret
 
-.globl get_edx
-get_edx:
-	mov %edx, %eax
+# void set_idt(idtr_t*)
+.globl set_idt
+set_idt:
+	mov 4(%esp), %eax
+	lidt (%eax)
 	ret
 
-.globl get_esi
-get_esi:
-	mov %esi, %eax
+# void load_tss(uint16_t selector)
+# The descriptor must already be in the GDT; ltr marks it busy.
+.globl load_tss
+load_tss:
+	mov 4(%esp), %eax
+	ltr %ax
 	ret
 
-.globl get_edi
-get_edi:
-	mov %edi, %eax
+# void get_registers(trap_frame_t*)
+# Stores the registers as they were at the call, all at once, in the
+# layout of a trap frame (see interrupt.h). eip is the return address,
+# esp the stack pointer after returning.
+.globl get_registers
+get_registers:
+	push %eax
+	mov 8(%esp), %eax
+
+	mov %edi, 16(%eax)
+	mov %esi, 20(%eax)
+	mov %ebp, 24(%eax)
+	mov %ebx, 32(%eax)
+	mov %edx, 36(%eax)
+	mov %ecx, 40(%eax)
+	popl 44(%eax)
+
+	lea 4(%esp), %ecx
+	mov %ecx, 28(%eax)
+	mov (%esp), %ecx
+	mov %ecx, 56(%eax)
+	pushf
+	popl 64(%eax)
+
+	# no trap, so no vector, error code or user stack
+	movl $0, 48(%eax)
+	movl $0, 52(%eax)
+	movl $0, 68(%eax)
+	movl $0, 72(%eax)
+
+	# segment registers only store 16 bits to memory
+	movl $0, 0(%eax)
+	movl $0, 4(%eax)
+	movl $0, 8(%eax)
+	movl $0, 12(%eax)
+	movl $0, 60(%eax)
+	mov %gs, 0(%eax)
+	mov %fs, 4(%eax)
+	mov %es, 8(%eax)
+	mov %ds, 12(%eax)
+	mov %cs, 60(%eax)
 	ret
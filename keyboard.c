@@ -0,0 +1,207 @@
+#include <keyboard.h>
+#include <interrupt.h>
+#include <pic.h>
+#include <log.h>
+#include <io.h>
+
+#define SCANCODE_RELEASE 0x80
+#define SCANCODE_EXTENDED 0xE0
+#define SCANCODE_PAUSE 0xE1 /* followed by 5 more bytes, without a release */
+
+#define KEYMAP_SIZE 0x3A
+
+/* keeps the compiler from moving ring accesses across it; x86 does not
+  reorder stores with other stores, or loads with other loads */
+#define barrier() __asm__ __volatile__ ("" : : : "memory")
+
+/* US layout, scancode set 1 */
+static char keymap[KEYMAP_SIZE] = {
+  0, 27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
+  '\t', 'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n',
+  0, 'a', 's', 'd', 'f', 'g', 'h', 'j', 'k', 'l', ';', '\'', '`',
+  0, '\\', 'z', 'x', 'c', 'v', 'b', 'n', 'm', ',', '.', '/', 0,
+  '*', 0, ' '
+};
+
+static char keymap_shift[KEYMAP_SIZE] = {
+  0, 27, '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+', '\b',
+  '\t', 'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n',
+  0, 'A', 'S', 'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~',
+  0, '|', 'Z', 'X', 'C', 'V', 'B', 'N', 'M', '<', '>', '?', 0,
+  '*', 0, ' '
+};
+
+/*
+  Single producer (the IRQ handler) and single consumer ring. The
+  producer only writes head and the consumer only writes tail, so
+  neither side needs a lock: an event is filled in before head moves
+  past it, and read out before tail does. Both are free-running
+  counters, head - tail is the number of queued events.
+ */
+static key_event_t buffer[KEYBOARD_BUFFER];
+static volatile uint32_t head;
+static volatile uint32_t tail;
+static uint32_t dropped;
+
+/* decoder state, only touched by the IRQ handler */
+static uint8_t modifiers;
+static uint8_t extended;
+static uint8_t pause_bytes;
+
+static char keyboard_ascii(uint8_t scancode)
+{
+  char c;
+
+  if (extended) {
+    /* the keypad's "/" and Enter are the only extended keys with a character */
+    if (scancode == 0x35) {
+      return '/';
+    }
+    return scancode == 0x1C ? '\n' : 0;
+  }
+  if (scancode >= KEYMAP_SIZE) {
+    return 0;
+  }
+
+  c = (modifiers & KEY_SHIFT) ? keymap_shift[scancode] : keymap[scancode];
+  if (modifiers & KEY_CAPS_LOCK) {
+    if (c >= 'a' && c <= 'z') {
+      c = keymap_shift[scancode];
+    } else if (c >= 'A' && c <= 'Z') {
+      c = keymap[scancode];
+    }
+  }
+  if ((modifiers & KEY_CTRL) && c >= '@' && c <= '~') {
+    c &= 0x1F;
+  }
+  return c;
+}
+
+static void keyboard_push(key_event_t* event)
+{
+  uint32_t h = head;
+
+  if (h - tail == KEYBOARD_BUFFER) {
+    if (!dropped++) {
+      log_write(LOG_WARNING, "keyboard: buffer full, dropping keys");
+    }
+    return;
+  }
+
+  buffer[h & (KEYBOARD_BUFFER - 1)] = *event;
+  barrier();
+  head = h + 1;
+}
+
+static void keyboard_interrupt(trap_frame_t* frame)
+{
+  uint8_t scancode = inportb(KEYBOARD_DATA);
+  uint8_t released, modifier = 0;
+  key_event_t event;
+
+  if (pause_bytes) {
+    pause_bytes--;
+    return;
+  }
+  if (scancode == SCANCODE_PAUSE) {
+    pause_bytes = 5;
+    return;
+  }
+  if (scancode == SCANCODE_EXTENDED) {
+    extended = 1;
+    return;
+  }
+
+  released = scancode & SCANCODE_RELEASE;
+  scancode &= ~SCANCODE_RELEASE;
+
+  /* Print Screen and friends send fake shifts, E0 2A and E0 36 */
+  if (extended && (scancode == KEY_LEFT_SHIFT || scancode == KEY_RIGHT_SHIFT)) {
+    extended = 0;
+    return;
+  }
+
+  switch (scancode) {
+    case KEY_LEFT_SHIFT:
+    case KEY_RIGHT_SHIFT:
+      modifier = KEY_SHIFT;
+      break;
+    case KEY_LEFT_CTRL: /* E0 1D is the right one */
+      modifier = KEY_CTRL;
+      break;
+    case KEY_LEFT_ALT:
+      modifier = KEY_ALT;
+      break;
+  }
+  if (modifier) {
+    if (released) {
+      modifiers &= ~modifier;
+    } else {
+      modifiers |= modifier;
+    }
+  } else if (scancode == KEY_CAPS && !extended && !released) {
+    modifiers ^= KEY_CAPS_LOCK;
+  }
+
+  event.scancode = scancode;
+  event.flags = modifiers | (released ? KEY_RELEASED : 0) | (extended ? KEY_EXTENDED : 0);
+  event.ascii = released ? 0 : keyboard_ascii(scancode);
+  extended = 0;
+
+  keyboard_push(&event);
+}
+
+uint32_t keyboard_poll(key_event_t* event)
+{
+  uint32_t t = tail;
+
+  if (head == t) {
+    return 0;
+  }
+
+  barrier();
+  *event = buffer[t & (KEYBOARD_BUFFER - 1)];
+  barrier();
+  tail = t + 1;
+  return 1;
+}
+
+void keyboard_read(key_event_t* event)
+{
+  while (!keyboard_poll(event)) {
+    /* check again with interrupts off, so the IRQ can't slip in between
+      the check and the "hlt" and leave us asleep with a full buffer */
+    interrupts_disable();
+    if (head == tail) {
+      interrupts_wait();
+    }
+    interrupts_enable();
+  }
+}
+
+char keyboard_getchar()
+{
+  key_event_t event;
+
+  do {
+    keyboard_read(&event);
+  } while (!event.ascii);
+
+  return event.ascii;
+}
+
+uint32_t keyboard_dropped()
+{
+  return dropped;
+}
+
+void init_keyboard()
+{
+  /* throw away whatever the BIOS left in the controller */
+  while (inportb(KEYBOARD_STATUS) & KEYBOARD_STATUS_OUTPUT_FULL) {
+    inportb(KEYBOARD_DATA);
+  }
+
+  interrupt_register(IRQ_VECTOR(IRQ_KEYBOARD), keyboard_interrupt);
+  pic_unmask(IRQ_KEYBOARD);
+}
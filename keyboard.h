@@ -0,0 +1,58 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdint.h>
+
+#define KEYBOARD_DATA 0x60
+#define KEYBOARD_STATUS 0x64
+#define KEYBOARD_STATUS_OUTPUT_FULL 0x01
+
+/* power of two, so the ring indices can simply wrap around */
+#define KEYBOARD_BUFFER 64
+
+/* key_event_t.flags */
+#define KEY_RELEASED 0x01
+#define KEY_EXTENDED 0x02 /* the scancode was prefixed by 0xE0 */
+#define KEY_SHIFT 0x04
+#define KEY_CTRL 0x08
+#define KEY_ALT 0x10
+#define KEY_CAPS_LOCK 0x20
+
+/* scancode set 1 make codes of keys without a character */
+#define KEY_ESCAPE 0x01
+#define KEY_BACKSPACE 0x0E
+#define KEY_LEFT_CTRL 0x1D
+#define KEY_LEFT_SHIFT 0x2A
+#define KEY_RIGHT_SHIFT 0x36
+#define KEY_LEFT_ALT 0x38
+#define KEY_CAPS 0x3A
+#define KEY_UP 0x48 /* extended */
+#define KEY_LEFT 0x4B /* extended */
+#define KEY_RIGHT 0x4D /* extended */
+#define KEY_DOWN 0x50 /* extended */
+
+typedef struct {
+  uint8_t scancode; /* make code, without the release bit */
+  uint8_t flags; /* KEY_*, with the modifiers held when the key changed */
+  char ascii; /* 0 if the key has no character */
+} key_event_t;
+
+/* hooks IRQ 1 and unmasks it */
+void init_keyboard();
+
+/* takes the next event, if there is one; returns 0 if the buffer is empty */
+uint32_t keyboard_poll(key_event_t* event);
+
+/*
+  Takes the next event, halting the CPU until one arrives. Interrupts are
+  enabled on return, so this must not be called from an interrupt handler.
+ */
+void keyboard_read(key_event_t* event);
+
+/* blocks until a key with a character is pressed */
+char keyboard_getchar();
+
+/* events lost because nobody read the buffer in time */
+uint32_t keyboard_dropped();
+
+#endif
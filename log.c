@@ -0,0 +1,190 @@
+#include <stdarg.h>
+#include <log.h>
+#include <string.h>
+#include <cpu.h>
+#include <serial.h>
+#include <screen.h>
+#include <memory.h>
+#include <io.h>
+#include <compiler.h>
+
+#define DEBUGCON_PORT 0xE9
+
+/* longest line a sink gets: the timestamp, a level prefix and the text */
+#define LOG_LINE (LOG_TEXT + 32)
+
+#define barrier() __asm__ __volatile__ ("" : : : "memory")
+
+typedef struct {
+  uint8_t level;
+  uint32_t next; /* sequence number of the next record to write */
+  void (*write)(const char* s, uint32_t len);
+} log_sink_t;
+
+static void console_write(const char* s, uint32_t len)
+{
+  printstrl((char*)s, len);
+}
+
+static void debugcon_write(const char* s, uint32_t len)
+{
+  uint32_t k;
+  for (k = 0; k < len; k++) {
+    outportb(DEBUGCON_PORT, s[k]);
+  }
+}
+
+static log_sink_t sinks[LOG_SINKS] = {
+  [LOG_SINK_CONSOLE] = { LOG_INFO, 0, console_write },
+  [LOG_SINK_SERIAL] = { LOG_DEBUG, 0, serial_write },
+  [LOG_SINK_DEBUGCON] = { LOG_DEBUG, 0, debugcon_write }
+};
+
+static char* level_prefixes[] = {
+  [LOG_ERROR] = "error: ",
+  [LOG_WARNING] = "warning: ",
+  [LOG_INFO] = "",
+  [LOG_DEBUG] = ""
+};
+
+/*
+  Writers claim a sequence number with an atomic add and own its slot
+  until they set "committed", so any number of them (including
+  interrupt handlers cutting into another writer) can log at once
+  without a lock. Readers copy a record and check "committed" again to
+  notice that it has been overwritten meanwhile. A writer that stalls
+  for more than LOG_RECORDS newer messages may have its slot taken
+  over; the record it then finishes is lost.
+ */
+static log_record_t records[LOG_RECORDS];
+static volatile uint32_t head;
+
+static volatile uint32_t draining;
+static uint64_t boot_tsc;
+
+static inline uint32_t fetch_and_add(volatile uint32_t* p, uint32_t value)
+{
+  __asm__ __volatile__ ("lock; xaddl %0, %1" : "+r" (value), "+m" (*p) : : "memory");
+  return value;
+}
+
+static inline uint32_t exchange(volatile uint32_t* p, uint32_t value)
+{
+  __asm__ __volatile__ ("xchgl %0, %1" : "+r" (value), "+m" (*p) : : "memory");
+  return value;
+}
+
+void init_log()
+{
+  if (cpu_has(CPU_FEATURE_TSC)) {
+    boot_tsc = rdtsc();
+  }
+}
+
+HOT void log_write(uint8_t level, const char* fmt, ...)
+{
+  uint32_t sequence = fetch_and_add(&head, 1);
+  log_record_t* record = &records[sequence & (LOG_RECORDS - 1)];
+  va_list args;
+
+  record->committed = 0;
+  barrier();
+
+  record->timestamp = cpu_has(CPU_FEATURE_TSC) ? rdtsc() : 0;
+  record->level = level;
+
+  va_start(args, fmt);
+  record->length = vformat(record->text, LOG_TEXT, fmt, args);
+  va_end(args);
+
+  barrier();
+  record->committed = sequence + 1;
+}
+
+void log_set_level(uint8_t sink, uint8_t level)
+{
+  sinks[sink].level = level;
+}
+
+void log_rewind(uint8_t sink)
+{
+  uint32_t h = head;
+  sinks[sink].next = h > LOG_RECORDS ? h - LOG_RECORDS : 0;
+}
+
+/* the record's time since init_log() as "seconds.microseconds" */
+static uint32_t format_timestamp(char* buf, uint32_t size, uint64_t timestamp)
+{
+  uint32_t micros = 0;
+  uint64_t seconds = 0;
+
+  if (cpu_info.tsc_khz && timestamp > boot_tsc) {
+    seconds = div64(div64((timestamp - boot_tsc) * 1000, cpu_info.tsc_khz, 0), 1000000, &micros);
+  }
+  return format(buf, size, "[%5u.%06u] ", (uint32_t)seconds, micros);
+}
+
+static void log_drain_sink(log_sink_t* sink)
+{
+  char line[LOG_LINE];
+  log_record_t record;
+  log_record_t* slot;
+  uint32_t n, lost;
+
+  while (sink->next != head) {
+    slot = &records[sink->next & (LOG_RECORDS - 1)];
+
+    lost = 0;
+    if (head - sink->next > LOG_RECORDS) {
+      /* lapped by the writers */
+      lost = head - LOG_RECORDS - sink->next;
+    } else if (slot->committed != sink->next + 1) {
+      if (slot->committed == 0 || slot->committed < sink->next + 1) {
+        /* still being written, this is where we stop */
+        return;
+      }
+      lost = 1;
+    } else {
+      record = *slot;
+      barrier();
+      if (slot->committed != sink->next + 1) {
+        lost = 1;
+      }
+    }
+
+    if (lost) {
+      n = format(line, LOG_LINE, "[... %u messages lost ...]\n", lost);
+      sink->write(line, n);
+      sink->next += lost;
+      continue;
+    }
+    sink->next++;
+
+    if (record.level > sink->level) {
+      continue;
+    }
+
+    n = format_timestamp(line, LOG_LINE, record.timestamp);
+    n += format(line + n, LOG_LINE - n, "%s", level_prefixes[record.level]);
+    memcpy((uint8_t*)line + n, (uint8_t*)record.text, record.length);
+    n += record.length;
+    line[n++] = '\n';
+    sink->write(line, n);
+  }
+}
+
+void log_drain()
+{
+  uint32_t k;
+
+  /* one drainer at a time; whoever comes second leaves it to the first */
+  if (exchange(&draining, 1)) {
+    return;
+  }
+
+  for (k = 0; k < LOG_SINKS; k++) {
+    log_drain_sink(&sinks[k]);
+  }
+
+  draining = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#define LOG_ERROR 0
+#define LOG_WARNING 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+/* power of two, so sequence numbers map straight onto slots */
+#define LOG_RECORDS 256
+
+/* longer messages are cut off; keeps a record at 128 bytes */
+#define LOG_TEXT 114
+
+#define LOG_SINK_CONSOLE 0
+#define LOG_SINK_SERIAL 1
+#define LOG_SINK_DEBUGCON 2 /* port 0xE9 in bochs and qemu */
+#define LOG_SINKS 3
+
+typedef struct {
+  volatile uint32_t committed; /* sequence number + 1 once complete, 0 while written */
+  uint64_t timestamp; /* TSC */
+  uint8_t level;
+  uint8_t length;
+  char text[LOG_TEXT];
+} log_record_t;
+
+/* starts the clock; the serial port must be set up already */
+void init_log();
+
+/*
+  Formats a message into the ring, like format() in string.h. Never
+  blocks and takes no locks, so it may be called from interrupt
+  handlers; the sinks only see the message once log_drain() runs.
+ */
+void log_write(uint8_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/* sink only writes records up to "level" */
+void log_set_level(uint8_t sink, uint8_t level);
+
+/* hands every new record to the sinks that want it */
+void log_drain();
+
+/* makes the sink write the oldest record still in the ring again, like dmesg */
+void log_rewind(uint8_t sink);
+
+#endif
@@ -0,0 +1,130 @@
+#include <magazine.h>
+#include <compiler.h>
+
+void magazine_init(magazine_cache_t* cache, magazine_fill_t fill, magazine_drain_t drain, void* context)
+{
+  magazine_cpu_t* cpu;
+  uint32_t k;
+
+  for (k = 0; k < CPUS; k++) {
+    cpu = &cache->cpus[k];
+    cpu->magazines[0].rounds = 0;
+    cpu->magazines[1].rounds = 0;
+    cpu->loaded = &cpu->magazines[0];
+    cpu->previous = &cpu->magazines[1];
+  }
+
+  cache->lock.locked = 0;
+  cache->full_count = 0;
+  cache->empty_count = MAGAZINE_DEPOT;
+  for (k = 0; k < MAGAZINE_DEPOT; k++) {
+    cache->depot[k].rounds = 0;
+    cache->empty[k] = &cache->depot[k];
+  }
+
+  cache->fill = fill;
+  cache->drain = drain;
+  cache->context = context;
+}
+
+/* both magazines of "cpu" are empty: trade one for a full one, or fill it */
+static void magazine_reload(magazine_cache_t* cache, magazine_cpu_t* cpu)
+{
+  magazine_t* full = 0;
+
+  spin_lock(&cache->lock);
+  if (cache->full_count) {
+    full = cache->full[--cache->full_count];
+    cache->empty[cache->empty_count++] = cpu->previous;
+  }
+  spin_unlock(&cache->lock);
+
+  if (full) {
+    cpu->previous = cpu->loaded;
+    cpu->loaded = full;
+  } else {
+    cpu->loaded->rounds = cache->fill(cache->context, cpu->loaded->objects, MAGAZINE_ROUNDS);
+  }
+}
+
+/* both magazines of "cpu" are full: trade one for an empty one, or drain it */
+static void magazine_unload(magazine_cache_t* cache, magazine_cpu_t* cpu)
+{
+  magazine_t* empty = 0;
+
+  spin_lock(&cache->lock);
+  if (cache->empty_count) {
+    empty = cache->empty[--cache->empty_count];
+    cache->full[cache->full_count++] = cpu->previous;
+  }
+  spin_unlock(&cache->lock);
+
+  if (empty) {
+    cpu->previous = cpu->loaded;
+    cpu->loaded = empty;
+  } else {
+    cache->drain(cache->context, cpu->loaded->objects, MAGAZINE_ROUNDS);
+    cpu->loaded->rounds = 0;
+  }
+}
+
+/* interrupts stay off throughout, so no handler finds the magazines half updated */
+HOT void* magazine_alloc(magazine_cache_t* cache)
+{
+  uint32_t eflags = interrupts_save();
+  magazine_cpu_t* cpu = &cache->cpus[cpu_id()];
+  magazine_t* swap;
+  void* object = 0;
+
+  if (!cpu->loaded->rounds) {
+    if (cpu->previous->rounds) {
+      swap = cpu->loaded;
+      cpu->loaded = cpu->previous;
+      cpu->previous = swap;
+    } else {
+      magazine_reload(cache, cpu);
+    }
+  }
+
+  if (cpu->loaded->rounds) {
+    object = cpu->loaded->objects[--cpu->loaded->rounds];
+  }
+
+  interrupts_restore(eflags);
+  return object;
+}
+
+HOT void magazine_free(magazine_cache_t* cache, void* object)
+{
+  uint32_t eflags = interrupts_save();
+  magazine_cpu_t* cpu = &cache->cpus[cpu_id()];
+  magazine_t* swap;
+
+  if (cpu->loaded->rounds == MAGAZINE_ROUNDS) {
+    if (!cpu->previous->rounds) {
+      swap = cpu->loaded;
+      cpu->loaded = cpu->previous;
+      cpu->previous = swap;
+    } else {
+      magazine_unload(cache, cpu);
+    }
+  }
+
+  cpu->loaded->objects[cpu->loaded->rounds++] = object;
+  interrupts_restore(eflags);
+}
+
+uint32_t magazine_cached(magazine_cache_t* cache)
+{
+  uint32_t k, count = 0;
+
+  for (k = 0; k < CPUS; k++) {
+    count += cache->cpus[k].loaded->rounds + cache->cpus[k].previous->rounds;
+  }
+
+  spin_lock(&cache->lock);
+  count += cache->full_count * MAGAZINE_ROUNDS;
+  spin_unlock(&cache->lock);
+
+  return count;
+}
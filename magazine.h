@@ -0,0 +1,71 @@
+#ifndef MAGAZINE_H
+#define MAGAZINE_H
+
+#include <stdint.h>
+#include <cpu.h>
+#include <spinlock.h>
+
+/*
+  Per-CPU caches of free objects in front of an allocator that takes a
+  lock, after Bonwick and Adams' magazines.
+
+  Every CPU allocates from, and frees to, a magazine of its own: an
+  array of up to MAGAZINE_ROUNDS objects, which nothing else touches,
+  so there is no lock to take. A second magazine, full or empty, is
+  swapped in when the first runs out, so going back and forth across
+  the edge stays on the CPU as well. Only once both are used up does
+  the CPU go to the depot, under its lock, to trade a whole magazine:
+  an empty one for a full one, or the other way around. When the depot
+  has none to give, the layer behind fills or drains a whole magazine
+  at a time.
+ */
+#define MAGAZINE_ROUNDS 15
+
+/* magazines in the depot, full or empty */
+#define MAGAZINE_DEPOT 8
+
+/* a cache line, so no two CPUs write to the same one */
+#define MAGAZINE_ALIGN 64
+
+typedef struct {
+  uint32_t rounds;
+  void* objects[MAGAZINE_ROUNDS];
+} __attribute__((aligned(MAGAZINE_ALIGN))) magazine_t;
+
+typedef struct {
+  magazine_t* loaded; /* where objects come from and go to */
+  magazine_t* previous; /* full or empty */
+  magazine_t magazines[2];
+} magazine_cpu_t;
+
+/* the layer behind: takes up to "count" objects from it, returning how many it had */
+typedef uint32_t (*magazine_fill_t)(void* context, void** objects, uint32_t count);
+
+/* and gives "count" back */
+typedef void (*magazine_drain_t)(void* context, void** objects, uint32_t count);
+
+typedef struct {
+  magazine_cpu_t cpus[CPUS];
+  spinlock_t lock; /* of the depot */
+  uint32_t full_count;
+  uint32_t empty_count;
+  magazine_t* full[MAGAZINE_DEPOT];
+  magazine_t* empty[MAGAZINE_DEPOT];
+  magazine_t depot[MAGAZINE_DEPOT];
+  magazine_fill_t fill;
+  magazine_drain_t drain;
+  void* context;
+} magazine_cache_t;
+
+/* starts "cache" out empty, in front of "fill" and "drain", which get "context" */
+void magazine_init(magazine_cache_t* cache, magazine_fill_t fill, magazine_drain_t drain, void* context);
+
+/* an object, or 0 if neither this CPU, the depot nor the layer behind has any */
+void* magazine_alloc(magazine_cache_t* cache);
+
+void magazine_free(magazine_cache_t* cache, void* object);
+
+/* how many free objects the magazines hold, all CPUs together; only a snapshot */
+uint32_t magazine_cached(magazine_cache_t* cache);
+
+#endif
@@ -1,33 +1,85 @@
 #include <memory.h>
+#include <compiler.h>
+#include <cpu.h>
+#include <word.h>
 
-uint8_t* memcpy(uint8_t *dest, const uint8_t *src, uint32_t count)
+/*
+  memcpy() and memset() go through a pointer that init_cpu() binds to
+  the best of these (see CPU_DISPATCH() in cpu.h). "rep movs" and "rep
+  stos" beat a loop everywhere; on CPUs with ERMS the byte versions
+  move whole cache lines at a time, so they are faster still.
+ */
+
+uint8_t* memcpy_movsl(uint8_t *dest, const uint8_t *src, uint32_t count)
 {
-  uint32_t i;
-  for (i = 0; i < count; i++) {
-    dest[i] = src[i];
-  }
+  unsigned long dwords = count >> 2, bytes = count & 3;
+  uint8_t* d = dest;
+
+  __asm__ __volatile__ ("rep movsl" : "+D" (d), "+S" (src), "+c" (dwords) : : "memory");
+  __asm__ __volatile__ ("rep movsb" : "+D" (d), "+S" (src), "+c" (bytes) : : "memory");
   return dest;
 }
 
-uint16_t* memcpyw(uint16_t *dest, const uint16_t *src, uint32_t count)
+uint8_t* memcpy_erms(uint8_t *dest, const uint8_t *src, uint32_t count)
 {
-  uint32_t i;
-  for (i = 0; i < count; i++) {
-    dest[i] = src[i];
-  }
+  unsigned long bytes = count;
+  uint8_t* d = dest;
+
+  __asm__ __volatile__ ("rep movsb" : "+D" (d), "+S" (src), "+c" (bytes) : : "memory");
   return dest;
 }
 
-uint8_t* memset(uint8_t *dest, uint8_t val, uint32_t count)
+uint8_t* memset_stosl(uint8_t *dest, uint8_t val, uint32_t count)
+{
+  unsigned long dwords = count >> 2, bytes = count & 3;
+  uint32_t pattern = val * 0x01010101;
+  uint8_t* d = dest;
+
+  __asm__ __volatile__ ("rep stosl" : "+D" (d), "+c" (dwords) : "a" (pattern) : "memory");
+  __asm__ __volatile__ ("rep stosb" : "+D" (d), "+c" (bytes) : "a" (pattern) : "memory");
+  return dest;
+}
+
+uint8_t* memset_erms(uint8_t *dest, uint8_t val, uint32_t count)
+{
+  unsigned long bytes = count;
+  uint8_t* d = dest;
+
+  __asm__ __volatile__ ("rep stosb" : "+D" (d), "+c" (bytes) : "a" (val) : "memory");
+  return dest;
+}
+
+static uint8_t* (*memcpy_best)(uint8_t *dest, const uint8_t *src, uint32_t count) = memcpy_movsl;
+static uint8_t* (*memset_best)(uint8_t *dest, uint8_t val, uint32_t count) = memset_stosl;
+
+CPU_DISPATCH(memcpy, memcpy_best,
+  CPU_VARIANT(memcpy_erms, 0, 0, CPU_FEATURE_EBX7_ERMS),
+  CPU_VARIANT(memcpy_movsl, 0, 0, 0));
+
+CPU_DISPATCH(memset, memset_best,
+  CPU_VARIANT(memset_erms, 0, 0, CPU_FEATURE_EBX7_ERMS),
+  CPU_VARIANT(memset_stosl, 0, 0, 0));
+
+HOT uint8_t* memcpy(uint8_t *dest, const uint8_t *src, uint32_t count)
+{
+  return memcpy_best(dest, src, count);
+}
+
+HOT uint16_t* memcpyw(uint16_t *dest, const uint16_t *src, uint32_t count)
 {
   uint32_t i;
   for (i = 0; i < count; i++) {
-    dest[i] = val;
+    dest[i] = src[i];
   }
   return dest;
 }
 
-uint16_t* memsetw(uint16_t *dest, uint16_t val, uint32_t count)
+HOT uint8_t* memset(uint8_t *dest, uint8_t val, uint32_t count)
+{
+  return memset_best(dest, val, count);
+}
+
+HOT uint16_t* memsetw(uint16_t *dest, uint16_t val, uint32_t count)
 {
     uint32_t i;
     for (i = 0; i < count; i++) {
@@ -35,3 +87,47 @@ uint16_t* memsetw(uint16_t *dest, uint16_t val, uint32_t count)
     }
     return dest;
 }
+
+/* "count" bounds both buffers, so whole words can be loaded, aligned or not */
+int32_t memcmp(const uint8_t *a, const uint8_t *b, uint32_t count)
+{
+  uint32_t diff, k;
+
+  for (; count >= 4; a += 4, b += 4, count -= 4) {
+    diff = *(const unaligned_word_t*)a ^ *(const unaligned_word_t*)b;
+    if (diff) {
+      k = word_first_byte(diff);
+      return a[k] - b[k];
+    }
+  }
+  for (; count; a++, b++, count--) {
+    if (*a != *b) {
+      return *a - *b;
+    }
+  }
+  return 0;
+}
+
+uint8_t* memchr(const uint8_t *s, uint8_t val, uint32_t count)
+{
+  uint32_t pattern = val * WORD_ONES, mask;
+
+  for (; count && ((uintptr_t)s & 3); s++, count--) {
+    if (*s == val) {
+      return (uint8_t*)s;
+    }
+  }
+  /* the bytes equal to "val" are the zero bytes of word ^ pattern */
+  for (; count >= 4; s += 4, count -= 4) {
+    mask = word_zero_bytes(*(const word_t*)s ^ pattern);
+    if (mask) {
+      return (uint8_t*)s + word_first_byte(mask);
+    }
+  }
+  for (; count; s++, count--) {
+    if (*s == val) {
+      return (uint8_t*)s;
+    }
+  }
+  return 0;
+}
@@ -11,4 +11,16 @@ uint8_t* memset(uint8_t *dest, uint8_t val, uint32_t count);
 
 uint16_t* memsetw(uint16_t *dest, uint16_t val, uint32_t count);
 
+/* less than, equal to or greater than 0, as "a" sorts before, with or after "b" */
+int32_t memcmp(const uint8_t *a, const uint8_t *b, uint32_t count);
+
+/* the first byte equal to "val" within "count" bytes, or 0 */
+uint8_t* memchr(const uint8_t *s, uint8_t val, uint32_t count);
+
+/* the implementations memcpy() and memset() pick from, see memory.c */
+uint8_t* memcpy_movsl(uint8_t *dest, const uint8_t *src, uint32_t count);
+uint8_t* memcpy_erms(uint8_t *dest, const uint8_t *src, uint32_t count);
+uint8_t* memset_stosl(uint8_t *dest, uint8_t val, uint32_t count);
+uint8_t* memset_erms(uint8_t *dest, uint8_t val, uint32_t count);
+
 #endif
@@ -0,0 +1,82 @@
+#include <paging.h>
+#include <cpu.h>
+#include <memory.h>
+
+/* defined by kernel.ld; code and read-only data that ring 3 may run */
+extern uint8_t _user_start[];
+extern uint8_t _user_end[];
+
+#define KERNEL_TABLES (FRAME_MEMORY_MAX / (PT_ENTRIES * PAGE_SIZE))
+
+static uint32_t kernel_directory[PT_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t kernel_tables[KERNEL_TABLES][PT_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+
+void init_paging(uint32_t memory_top)
+{
+  uint32_t address, flags;
+  uint32_t user_start = (uint32_t)_user_start;
+  uint32_t user_end = (uint32_t)_user_end;
+
+  if (memory_top > FRAME_MEMORY_MAX) {
+    memory_top = FRAME_MEMORY_MAX;
+  }
+
+  memset((uint8_t*)kernel_directory, 0, sizeof(kernel_directory));
+  memset((uint8_t*)kernel_tables, 0, sizeof(kernel_tables));
+
+  /* the directory entries allow user access, so the page table entries
+    alone decide who may touch a page */
+  for (address = 0; address < memory_top; address += PT_ENTRIES * PAGE_SIZE) {
+    kernel_directory[PD_INDEX(address)] = (uint32_t)kernel_tables[PD_INDEX(address)]
+      | PTE_PRESENT | PTE_WRITE | PTE_USER;
+  }
+
+  /* leave the first page unmapped, so null pointers fault */
+  for (address = PAGE_SIZE; address < memory_top; address += PAGE_SIZE) {
+    if (address >= user_start && address < user_end) {
+      flags = PTE_PRESENT | PTE_USER;
+    } else {
+      flags = PTE_PRESENT | PTE_WRITE;
+    }
+    kernel_tables[PD_INDEX(address)][PT_INDEX(address)] = address | flags;
+  }
+
+  write_cr3((uint32_t)kernel_directory);
+  write_cr0(read_cr0() | CR0_PG | CR0_WP);
+}
+
+uint32_t* paging_kernel_directory()
+{
+  return kernel_directory;
+}
+
+uint32_t* paging_get_pte(uint32_t* directory, uint32_t address, uint32_t create)
+{
+  uint32_t* pde = &directory[PD_INDEX(address)];
+
+  if (!(*pde & PTE_PRESENT)) {
+    if (!create) {
+      return 0;
+    }
+
+    uint32_t table = frame_alloc_zeroed();
+    if (!table) {
+      return 0;
+    }
+    *pde = table | PTE_PRESENT | PTE_WRITE | PTE_USER;
+  }
+
+  return &((uint32_t*)PTE_FRAME(*pde))[PT_INDEX(address)];
+}
+
+uint32_t paging_map(uint32_t* directory, uint32_t address, uint32_t frame, uint32_t flags)
+{
+  uint32_t* pte = paging_get_pte(directory, address, 1);
+  if (!pte) {
+    return 0;
+  }
+
+  *pte = PTE_FRAME(frame) | flags | PTE_PRESENT;
+  invlpg(address);
+  return 1;
+}
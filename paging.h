@@ -0,0 +1,65 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+#include <frame.h>
+
+/*
+
+31                     12 11  9 8   7   6   5   4   3   2   1   0
++------------------------+-----+---+---+---+---+---+---+---+---+---+
+|   Frame address        | Avl | G |PAT| D | A |PCD|PWT|U/S|R/W| P |
++------------------------+-----+---+---+---+---+---+---+---+---+---+
+            Page table entry
+
+  P
+    Present - if "0", any access raises a page fault
+  R/W
+    Writable - if "0", writes raise a page fault (in ring 0 too, as we set CR0.WP)
+  U/S
+    User - if "1", ring 3 may access the page
+  Avl
+    Available for software; we use bit 9 to mark copy-on-write pages
+
+  The page directory has the same layout, with the frame address
+  pointing at a page table. The effective R/W and U/S bits are the
+  most restrictive combination of the two levels.
+ */
+#define PTE_PRESENT 0x001
+#define PTE_WRITE 0x002
+#define PTE_USER 0x004
+#define PTE_ACCESSED 0x020
+#define PTE_DIRTY 0x040
+#define PTE_COW 0x200
+
+#define PTE_FRAME(entry) ((entry) & PAGE_MASK)
+#define PD_INDEX(address) ((address) >> 22)
+#define PT_INDEX(address) (((address) >> PAGE_SHIFT) & 0x3FF)
+#define PT_ENTRIES 1024
+
+/*
+  The page fault error code
+
+  bit 0: "0" the page was not present, "1" protection violation
+  bit 1: "1" the access was a write
+  bit 2: "1" the access came from ring 3
+ */
+#define FAULT_PRESENT 0x1
+#define FAULT_WRITE 0x2
+#define FAULT_USER 0x4
+
+/* identity maps the managed physical memory and turns on paging */
+void init_paging(uint32_t memory_top);
+
+uint32_t* paging_kernel_directory();
+
+/*
+  Returns the page table entry for "address", or 0 if there is no page
+  table. If "create" is non-zero, a missing table is allocated.
+ */
+uint32_t* paging_get_pte(uint32_t* directory, uint32_t address, uint32_t create);
+
+/* maps one page, returns 0 if a page table could not be allocated */
+uint32_t paging_map(uint32_t* directory, uint32_t address, uint32_t frame, uint32_t flags);
+
+#endif
@@ -0,0 +1,162 @@
+#include <pci.h>
+#include <io.h>
+#include <log.h>
+
+#define PCI_CLASS_BRIDGE 0x06
+#define PCI_SUBCLASS_PCI_BRIDGE 0x04
+#define PCI_SECONDARY_BUS 0x19 /* of a PCI-to-PCI bridge */
+#define PCI_HEADER_TYPE_MASK 0x7F
+#define PCI_HEADER_DEVICE 0x00
+
+static pci_device_t devices[PCI_DEVICES];
+static uint32_t count;
+static uint32_t found;
+
+static uint32_t pci_address(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset)
+{
+  return 0x80000000 | (bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC);
+}
+
+uint32_t pci_read(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset)
+{
+  outportl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, function, offset));
+  return inportl(PCI_CONFIG_DATA);
+}
+
+void pci_write(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value)
+{
+  outportl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, function, offset));
+  outportl(PCI_CONFIG_DATA, value);
+}
+
+/* the byte or word at "offset", out of the dword around it */
+static uint32_t pci_read_field(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t mask)
+{
+  return (pci_read(bus, slot, function, offset) >> ((offset & 3) * 8)) & mask;
+}
+
+static void pci_scan_bus(uint8_t bus);
+
+static void pci_add(uint8_t bus, uint8_t slot, uint8_t function)
+{
+  uint32_t id = pci_read(bus, slot, function, PCI_VENDOR_ID);
+  uint32_t class = pci_read(bus, slot, function, PCI_CLASS);
+  uint8_t header = pci_read_field(bus, slot, function, PCI_HEADER_TYPE, 0xFF) & PCI_HEADER_TYPE_MASK;
+  pci_device_t* device;
+  uint32_t k;
+  uint8_t secondary;
+
+  found++;
+  log_write(LOG_DEBUG, "pci: %02x:%02x.%u %04x:%04x class %02x.%02x.%02x",
+    bus, slot, function, id & 0xFFFF, id >> 16, class >> 24, (class >> 16) & 0xFF, (class >> 8) & 0xFF);
+
+  /* a bridge leads to more buses, behind it, numbered after its own;
+    one the firmware did not configure says 0, and leads nowhere */
+  if ((class >> 24) == PCI_CLASS_BRIDGE && ((class >> 16) & 0xFF) == PCI_SUBCLASS_PCI_BRIDGE) {
+    secondary = pci_read_field(bus, slot, function, PCI_SECONDARY_BUS, 0xFF);
+    if (secondary > bus) {
+      pci_scan_bus(secondary);
+    } else {
+      log_write(LOG_WARNING, "pci: bridge %02x:%02x.%u leads to bus %02x, skipped", bus, slot, function, secondary);
+    }
+    return;
+  }
+  if (header != PCI_HEADER_DEVICE || count == PCI_DEVICES) {
+    return;
+  }
+
+  device = &devices[count++];
+  device->bus = bus;
+  device->slot = slot;
+  device->function = function;
+  device->vendor = id & 0xFFFF;
+  device->device = id >> 16;
+  device->class = class >> 24;
+  device->subclass = (class >> 16) & 0xFF;
+  device->interface = (class >> 8) & 0xFF;
+  device->subsystem = pci_read_field(bus, slot, function, PCI_SUBSYSTEM_ID, 0xFFFF);
+  device->irq = pci_read_field(bus, slot, function, PCI_INTERRUPT_LINE, 0xFF);
+  for (k = 0; k < PCI_BARS; k++) {
+    device->bars[k] = pci_read(bus, slot, function, PCI_BAR0 + k * 4);
+  }
+}
+
+static void pci_scan_slot(uint8_t bus, uint8_t slot)
+{
+  uint8_t function, functions;
+
+  if (pci_read_field(bus, slot, 0, PCI_VENDOR_ID, 0xFFFF) == PCI_VENDOR_NONE) {
+    return;
+  }
+
+  functions = pci_read_field(bus, slot, 0, PCI_HEADER_TYPE, 0xFF) & PCI_HEADER_MULTIFUNCTION ? PCI_FUNCTIONS : 1;
+  for (function = 0; function < functions; function++) {
+    if (pci_read_field(bus, slot, function, PCI_VENDOR_ID, 0xFFFF) != PCI_VENDOR_NONE) {
+      pci_add(bus, slot, function);
+    }
+  }
+}
+
+static void pci_scan_bus(uint8_t bus)
+{
+  uint8_t slot;
+  for (slot = 0; slot < PCI_SLOTS; slot++) {
+    pci_scan_slot(bus, slot);
+  }
+}
+
+/*
+  Rather than probing all 256 buses, this starts at bus 0 and follows
+  the bridges. A multi-function host bridge at 00:00 means there are
+  several host controllers, each with the bus number of its function.
+ */
+void init_pci()
+{
+  uint8_t function;
+
+  count = 0;
+  found = 0;
+
+  if (pci_read_field(0, 0, 0, PCI_HEADER_TYPE, 0xFF) & PCI_HEADER_MULTIFUNCTION) {
+    for (function = 0; function < PCI_FUNCTIONS; function++) {
+      if (pci_read_field(0, 0, function, PCI_VENDOR_ID, 0xFFFF) != PCI_VENDOR_NONE) {
+        pci_scan_bus(function);
+      }
+    }
+  } else {
+    pci_scan_bus(0);
+  }
+
+  log_write(LOG_INFO, "pci: %u devices", found);
+}
+
+uint32_t pci_devices()
+{
+  return count;
+}
+
+pci_device_t* pci_device(uint32_t index)
+{
+  return index < count ? &devices[index] : 0;
+}
+
+pci_device_t* pci_find(uint16_t vendor, uint16_t first, uint16_t last)
+{
+  uint32_t k;
+
+  for (k = 0; k < count; k++) {
+    if (devices[k].vendor == vendor && devices[k].device >= first && devices[k].device <= last) {
+      return &devices[k];
+    }
+  }
+  return 0;
+}
+
+void pci_enable(pci_device_t* device, uint16_t command)
+{
+  uint32_t value = pci_read(device->bus, device->slot, device->function, PCI_COMMAND);
+
+  /* the upper half is the status register, where writing 1s clears bits */
+  value = (value & 0xFFFF) | command;
+  pci_write(device->bus, device->slot, device->function, PCI_COMMAND, value);
+}
@@ -0,0 +1,65 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+/* configuration mechanism #1 */
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+
+/* configuration space registers of a type 0 header */
+#define PCI_VENDOR_ID 0x00
+#define PCI_DEVICE_ID 0x02
+#define PCI_COMMAND 0x04
+#define PCI_CLASS 0x08 /* revision, programming interface, subclass, class */
+#define PCI_HEADER_TYPE 0x0E
+#define PCI_BAR0 0x10
+#define PCI_SUBSYSTEM_ID 0x2E
+#define PCI_INTERRUPT_LINE 0x3C
+
+#define PCI_COMMAND_IO 0x1
+#define PCI_COMMAND_MEMORY 0x2
+#define PCI_COMMAND_BUS_MASTER 0x4
+
+#define PCI_HEADER_MULTIFUNCTION 0x80
+#define PCI_BAR_IO 0x1 /* bit 0 of a BAR: I/O space rather than memory */
+#define PCI_VENDOR_NONE 0xFFFF
+
+#define PCI_BUSES 256
+#define PCI_SLOTS 32
+#define PCI_FUNCTIONS 8
+#define PCI_BARS 6
+
+/* devices we keep track of; the rest are only logged */
+#define PCI_DEVICES 32
+
+typedef struct {
+  uint8_t bus;
+  uint8_t slot;
+  uint8_t function;
+  uint8_t class;
+  uint8_t subclass;
+  uint8_t interface;
+  uint8_t irq; /* the legacy PIC line the firmware routed it to */
+  uint16_t vendor;
+  uint16_t device;
+  uint16_t subsystem;
+  uint32_t bars[PCI_BARS];
+} pci_device_t;
+
+/* scans every bus for devices, and logs what it found */
+void init_pci();
+
+uint32_t pci_read(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+void pci_write(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value);
+
+uint32_t pci_devices();
+pci_device_t* pci_device(uint32_t index);
+
+/* the first device with "vendor" and a device id from "first" to "last", or 0 */
+pci_device_t* pci_find(uint16_t vendor, uint16_t first, uint16_t last);
+
+/* sets PCI_COMMAND_* bits, to let a device decode its BARs and do DMA */
+void pci_enable(pci_device_t* device, uint16_t command);
+
+#endif
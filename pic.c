@@ -0,0 +1,82 @@
+#include <pic.h>
+#include <io.h>
+#include <compiler.h>
+
+#define ICW1_ICW4 0x01 /* ICW4 follows */
+#define ICW1_INIT 0x10
+#define ICW4_8086 0x01
+#define OCW2_EOI 0x20
+#define OCW3_READ_ISR 0x0B
+
+/* a write to an unused port, gives the PICs time to settle on old hardware */
+static void io_wait()
+{
+  outportb(0x80, 0);
+}
+
+void init_pic()
+{
+  outportb(PIC1_COMMAND, ICW1_INIT | ICW1_ICW4);
+  io_wait();
+  outportb(PIC2_COMMAND, ICW1_INIT | ICW1_ICW4);
+  io_wait();
+
+  /* ICW2: vector offsets */
+  outportb(PIC1_DATA, PIC_VECTOR_BASE);
+  io_wait();
+  outportb(PIC2_DATA, PIC_VECTOR_BASE + 8);
+  io_wait();
+
+  /* ICW3: the slave is on IRQ 2 of the master */
+  outportb(PIC1_DATA, 1 << IRQ_CASCADE);
+  io_wait();
+  outportb(PIC2_DATA, 2);
+  io_wait();
+
+  outportb(PIC1_DATA, ICW4_8086);
+  io_wait();
+  outportb(PIC2_DATA, ICW4_8086);
+  io_wait();
+
+  /* everything masked, except the cascade so the slave can be unmasked */
+  outportb(PIC1_DATA, 0xFF & ~(1 << IRQ_CASCADE));
+  outportb(PIC2_DATA, 0xFF);
+}
+
+void pic_unmask(uint8_t irq)
+{
+  uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+  outportb(port, inportb(port) & ~(1 << (irq & 7)));
+}
+
+void pic_mask(uint8_t irq)
+{
+  uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+  outportb(port, inportb(port) | (1 << (irq & 7)));
+}
+
+static uint8_t pic_in_service(uint16_t command)
+{
+  outportb(command, OCW3_READ_ISR);
+  return inportb(command);
+}
+
+HOT uint32_t pic_acknowledge(uint8_t irq)
+{
+  /* IRQ 7 and 15 may be raised for an interrupt that went away;
+    then the in-service bit is clear and no EOI must be sent to that PIC */
+  if (irq == 7 && !(pic_in_service(PIC1_COMMAND) & 0x80)) {
+    return 0;
+  }
+  if (irq == 15 && !(pic_in_service(PIC2_COMMAND) & 0x80)) {
+    outportb(PIC1_COMMAND, OCW2_EOI);
+    return 0;
+  }
+
+  if (irq >= 8) {
+    outportb(PIC2_COMMAND, OCW2_EOI);
+  }
+  outportb(PIC1_COMMAND, OCW2_EOI);
+
+  return 1;
+}
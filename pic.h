@@ -0,0 +1,30 @@
+#ifndef PIC_H
+#define PIC_H
+
+#include <stdint.h>
+
+#define PIC1_COMMAND 0x20
+#define PIC1_DATA 0x21
+#define PIC2_COMMAND 0xA0
+#define PIC2_DATA 0xA1
+
+/* the BIOS maps IRQ 0-7 onto vectors 8-15, right on top of the CPU
+  exceptions, so we move them to 32-47 */
+#define PIC_VECTOR_BASE 0x20
+
+#define IRQ_TIMER 0
+#define IRQ_KEYBOARD 1
+#define IRQ_CASCADE 2
+#define IRQ_COM1 4
+#define IRQS 16
+
+/* remaps both 8259s and masks every IRQ */
+void init_pic();
+
+void pic_unmask(uint8_t irq);
+void pic_mask(uint8_t irq);
+
+/* acknowledges the IRQ; returns 0 if it was spurious (and needs no handling) */
+uint32_t pic_acknowledge(uint8_t irq);
+
+#endif
@@ -0,0 +1,37 @@
+#include <pit.h>
+#include <cpu.h>
+#include <io.h>
+
+#define PIT_GATE_CHANNEL2 0x01
+#define PIT_GATE_SPEAKER 0x02
+#define PIT_GATE_OUTPUT2 0x20
+
+/* channel 2, low byte then high byte, mode 0 (interrupt on terminal count) */
+#define PIT_COMMAND_CHANNEL2_ONESHOT 0xB0
+
+#define CALIBRATE_MS 10
+
+uint32_t pit_tsc_khz()
+{
+  uint16_t count = PIT_FREQUENCY / (1000 / CALIBRATE_MS);
+  uint8_t gate = inportb(PIT_GATE);
+  uint64_t start, end;
+
+  /* speaker off, so the measurement stays silent */
+  outportb(PIT_GATE, (gate & ~PIT_GATE_SPEAKER) | PIT_GATE_CHANNEL2);
+
+  /* the count starts with the write of the high byte */
+  outportb(PIT_COMMAND, PIT_COMMAND_CHANNEL2_ONESHOT);
+  outportb(PIT_CHANNEL2, count & 0xFF);
+  outportb(PIT_CHANNEL2, count >> 8);
+
+  start = rdtsc();
+  while (!(inportb(PIT_GATE) & PIT_GATE_OUTPUT2)) {
+    /* wait for the terminal count */
+  }
+  end = rdtsc();
+
+  outportb(PIT_GATE, gate);
+
+  return (uint32_t)(end - start) / CALIBRATE_MS;
+}
@@ -0,0 +1,19 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdint.h>
+
+/* the 8253/8254 input clock, in Hz */
+#define PIT_FREQUENCY 1193182
+
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+
+/* port B of the 8255; gates channel 2 and shows its output */
+#define PIT_GATE 0x61
+
+/* measures the TSC against channel 2 for 10ms; returns its rate in kHz */
+uint32_t pit_tsc_khz();
+
+#endif
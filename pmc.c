@@ -0,0 +1,180 @@
+#include <pmc.h>
+#include <cpu.h>
+#include <log.h>
+
+#define CPUID_LEAF_PERFMON 0xA
+
+#define MSR_IA32_PMC0 0xC1
+#define MSR_IA32_PERFEVTSEL0 0x186
+#define MSR_IA32_PERF_GLOBAL_CTRL 0x38F /* version 2 and later */
+
+#define PERFEVTSEL_USR (1 << 16)
+#define PERFEVTSEL_OS (1 << 17)
+#define PERFEVTSEL_EN (1 << 22)
+
+typedef struct {
+  uint8_t event;
+  uint8_t umask;
+  char* name;
+} pmc_event_t;
+
+static pmc_event_t events[PMC_EVENTS] = {
+  [PMC_EVENT_CYCLES] = { 0x3C, 0x00, "cycles" },
+  [PMC_EVENT_INSTRUCTIONS] = { 0xC0, 0x00, "instructions" },
+  [PMC_EVENT_REFERENCE_CYCLES] = { 0x3C, 0x01, "ref-cycles" },
+  [PMC_EVENT_LLC_REFERENCES] = { 0x2E, 0x4F, "llc-references" },
+  [PMC_EVENT_LLC_MISSES] = { 0x2E, 0x41, "llc-misses" },
+  [PMC_EVENT_BRANCHES] = { 0xC4, 0x00, "branches" },
+  [PMC_EVENT_BRANCH_MISSES] = { 0xC5, 0x00, "branch-misses" }
+};
+
+/* what to count if nobody asks for something else, most telling first */
+static uint8_t default_events[] = {
+  PMC_EVENT_INSTRUCTIONS,
+  PMC_EVENT_LLC_MISSES,
+  PMC_EVENT_BRANCH_MISSES,
+  PMC_EVENT_CYCLES
+};
+
+static uint32_t version;
+static uint32_t available; /* bit per PMC_EVENT_* */
+static uint32_t hardware_counters;
+static uint64_t counter_mask; /* counters are narrower than 64 bits */
+
+static uint32_t counters;
+static uint8_t counter_events[PMC_COUNTERS];
+
+static pmc_region_t* regions;
+
+void init_pmc()
+{
+  uint32_t a, b, c, d, length;
+
+  version = 0;
+  counters = 0;
+
+  if (cpu_info.max_leaf >= CPUID_LEAF_PERFMON && cpu_has(CPU_FEATURE_MSR)) {
+    cpuid(CPUID_LEAF_PERFMON, &a, &b, &c, &d);
+    version = a & 0xFF;
+    hardware_counters = (a >> 8) & 0xFF;
+    counter_mask = ((uint64_t)1 << ((a >> 16) & 0xFF)) - 1;
+
+    /* EBX has a bit set for every event that is NOT available */
+    length = (a >> 24) & 0xFF;
+    available = ~b & ((1 << (length < PMC_EVENTS ? length : PMC_EVENTS)) - 1);
+  }
+
+  /* emulators usually report version 0, or no counters */
+  if (!version || !hardware_counters) {
+    version = 0;
+    log_write(LOG_INFO, "pmc: no architectural performance monitoring, TSC only");
+    return;
+  }
+
+  pmc_select(default_events, sizeof(default_events));
+
+  log_write(LOG_INFO, "pmc: version %u, %u counters, %u in use", version, hardware_counters, counters);
+}
+
+uint32_t pmc_select(uint8_t* wanted, uint32_t count)
+{
+  uint32_t k, limit = hardware_counters < PMC_COUNTERS ? hardware_counters : PMC_COUNTERS;
+  uint64_t enable = 0;
+
+  if (!version) {
+    return 0;
+  }
+
+  /* stop everything before reprogramming */
+  for (k = 0; k < limit; k++) {
+    wrmsr(MSR_IA32_PERFEVTSEL0 + k, 0);
+  }
+
+  counters = 0;
+  for (k = 0; k < count && counters < limit; k++) {
+    if (wanted[k] >= PMC_EVENTS || !(available & (1 << wanted[k]))) {
+      continue;
+    }
+
+    counter_events[counters] = wanted[k];
+    wrmsr(MSR_IA32_PMC0 + counters, 0);
+    wrmsr(MSR_IA32_PERFEVTSEL0 + counters, PERFEVTSEL_EN | PERFEVTSEL_OS | PERFEVTSEL_USR |
+      (events[wanted[k]].umask << 8) | events[wanted[k]].event);
+    enable |= 1 << counters;
+    counters++;
+  }
+
+  if (version >= 2) {
+    wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, enable);
+  }
+
+  return counters;
+}
+
+uint32_t pmc_counters()
+{
+  return counters;
+}
+
+uint8_t pmc_event(uint32_t counter)
+{
+  return counter_events[counter];
+}
+
+char* pmc_event_name(uint8_t event)
+{
+  return events[event].name;
+}
+
+void pmc_read(uint64_t values[PMC_COUNTERS])
+{
+  uint32_t k;
+  for (k = 0; k < counters; k++) {
+    values[k] = rdpmc(k);
+  }
+}
+
+void pmc_region_start(pmc_region_t* region)
+{
+  pmc_read(region->start);
+  region->start_cycles = cpu_has(CPU_FEATURE_TSC) ? rdtsc() : 0;
+}
+
+void pmc_region_stop(pmc_region_t* region)
+{
+  uint64_t values[PMC_COUNTERS];
+  uint64_t cycles = cpu_has(CPU_FEATURE_TSC) ? rdtsc() : 0;
+  uint32_t k;
+
+  pmc_read(values);
+
+  region->cycles += cycles - region->start_cycles;
+  for (k = 0; k < counters; k++) {
+    region->counts[k] += (values[k] - region->start[k]) & counter_mask;
+  }
+
+  /* the first run puts it on the list */
+  if (!region->calls++) {
+    region->next = regions;
+    regions = region;
+  }
+}
+
+void pmc_report()
+{
+  pmc_region_t* region;
+  uint32_t k;
+
+  for (region = regions; region; region = region->next) {
+    if (!region->calls) {
+      continue;
+    }
+
+    log_write(LOG_INFO, "pmc: %s: %u calls, %u TSC cycles per call", region->name,
+      region->calls, (uint32_t)div64(region->cycles, region->calls, 0));
+    for (k = 0; k < counters; k++) {
+      log_write(LOG_INFO, "pmc: %s: %u %s per call", region->name,
+        (uint32_t)div64(region->counts[k], region->calls, 0), events[counter_events[k]].name);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef PMC_H
+#define PMC_H
+
+#include <stdint.h>
+
+/* the architectural events, in CPUID.0Ah:EBX order */
+#define PMC_EVENT_CYCLES 0
+#define PMC_EVENT_INSTRUCTIONS 1
+#define PMC_EVENT_REFERENCE_CYCLES 2
+#define PMC_EVENT_LLC_REFERENCES 3
+#define PMC_EVENT_LLC_MISSES 4
+#define PMC_EVENT_BRANCHES 5
+#define PMC_EVENT_BRANCH_MISSES 6
+#define PMC_EVENTS 7
+
+/* general purpose counters we use, even if the CPU has more */
+#define PMC_COUNTERS 4
+
+/*
+  A piece of code to measure, e.g. at file scope
+
+    static PMC_REGION(scroll_region, "scroll");
+
+  and then pmc_region_start(&scroll_region) ... pmc_region_stop(&scroll_region)
+  around it. Regions add up over all their runs and must not nest into
+  themselves.
+ */
+typedef struct pmc_region {
+  char* name;
+  struct pmc_region* next; /* all regions that ran, for pmc_report() */
+  uint32_t calls;
+  uint64_t cycles; /* TSC */
+  uint64_t counts[PMC_COUNTERS];
+  uint64_t start_cycles;
+  uint64_t start[PMC_COUNTERS];
+} pmc_region_t;
+
+#define PMC_REGION(variable, label) pmc_region_t variable = { label }
+
+/*
+  Looks for architectural performance monitoring (CPUID leaf 0Ah) and
+  programs the counters with the events from pmc_select(), or a default
+  set. Without it, regions only measure TSC cycles.
+ */
+void init_pmc();
+
+/* reprograms the counters to count "events" (PMC_EVENT_*); returns how many fit */
+uint32_t pmc_select(uint8_t* events, uint32_t count);
+
+/* how many counters are programmed, 0 if only the TSC is available */
+uint32_t pmc_counters();
+
+/* the PMC_EVENT_* counter "counter" counts */
+uint8_t pmc_event(uint32_t counter);
+
+char* pmc_event_name(uint8_t event);
+
+/* the current value of every programmed counter */
+void pmc_read(uint64_t values[PMC_COUNTERS]);
+
+void pmc_region_start(pmc_region_t* region);
+void pmc_region_stop(pmc_region_t* region);
+
+/* logs the per call averages of every region that ran */
+void pmc_report();
+
+#endif
@@ -0,0 +1,245 @@
+#include <process.h>
+#include <syscall.h>
+#include <frame.h>
+#include <screen.h>
+#include <cpu.h>
+#include <log.h>
+
+static process_t processes[PROCESSES];
+static uint32_t next_pid = 1;
+static process_t* current = 0;
+
+/* processes waiting to run */
+static process_queue_t ready;
+
+void process_enqueue(process_queue_t* queue, process_t* process)
+{
+  process->next = 0;
+
+  if (queue->tail) {
+    queue->tail->next = process;
+  } else {
+    queue->head = process;
+  }
+  queue->tail = process;
+}
+
+process_t* process_dequeue(process_queue_t* queue)
+{
+  process_t* process = queue->head;
+
+  if (process) {
+    queue->head = process->next;
+    if (!queue->head) {
+      queue->tail = 0;
+    }
+  }
+
+  return process;
+}
+
+static void process_ready(process_t* process)
+{
+  process->state = PROCESS_READY;
+  process_enqueue(&ready, process);
+}
+
+static process_t* process_alloc()
+{
+  uint32_t i;
+  for (i = 0; i < PROCESSES; i++) {
+    if (processes[i].state == PROCESS_FREE) {
+      processes[i].pid = next_pid++;
+      processes[i].exit_code = 0;
+      return &processes[i];
+    }
+  }
+  return 0;
+}
+
+process_t* process_create(process_entry_t entry, uint32_t arg)
+{
+  process_t* process = process_alloc();
+  if (!process) {
+    return 0;
+  }
+
+  vm_space_t* space = vm_space_create();
+  if (!space) {
+    return 0;
+  }
+
+  /* the heap and stack cost nothing until they are touched */
+  vm_map_anonymous(space, USER_HEAP_BASE, USER_HEAP_SIZE, VM_READ | VM_WRITE);
+  vm_map_anonymous(space, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_SIZE, VM_READ | VM_WRITE);
+
+  /* lay out a cdecl call frame for entry(arg), returning to user_return;
+    this faults in the top stack page */
+  vm_space_t* previous = vm_current();
+  vm_switch(space);
+
+  uint32_t* sp = (uint32_t*)USER_STACK_TOP;
+  *--sp = arg;
+  *--sp = (uint32_t)user_return;
+
+  vm_switch(previous);
+
+  process->space = space;
+  process->eip = (uint32_t)entry;
+  process->esp = (uint32_t)sp;
+  process->eax = 0;
+  process->edx = 0;
+  process->state = PROCESS_READY;
+
+  return process;
+}
+
+uint32_t process_run(process_t* process)
+{
+  process_t* next;
+  uint32_t code, k;
+
+  process_ready(process);
+
+  while ((next = process_dequeue(&ready))) {
+    current = next;
+    next->state = PROCESS_RUNNING;
+    vm_switch(next->space);
+
+    code = user_enter(next->eip, next->esp, next->eax, next->edx);
+    current = 0;
+
+    /* it blocked, or made way for another; the address space stays
+      until whoever runs next needs another */
+    if (next->state != PROCESS_RUNNING) {
+      continue;
+    }
+
+    vm_switch(vm_kernel_space());
+    vm_space_destroy(next->space);
+    next->exit_code = code;
+    next->state = PROCESS_FREE;
+  }
+
+  vm_switch(vm_kernel_space());
+
+  /* waiting for each other, or for someone who has exited */
+  ipc_abandon();
+  for (k = 0; k < PROCESSES; k++) {
+    if (processes[k].state == PROCESS_BLOCKED) {
+      log_write(LOG_WARNING, "process %u killed, blocked forever", processes[k].pid);
+      vm_space_destroy(processes[k].space);
+      processes[k].exit_code = PROCESS_KILLED;
+      processes[k].state = PROCESS_FREE;
+    }
+  }
+
+  return process->exit_code;
+}
+
+uint32_t process_fork(uint32_t eip, uint32_t esp)
+{
+  process_t* child = process_alloc();
+  if (!child) {
+    return (uint32_t)-1;
+  }
+
+  child->space = vm_space_clone(current->space);
+  if (!child->space) {
+    return (uint32_t)-1;
+  }
+
+  child->eip = eip;
+  child->esp = esp;
+  child->eax = 0;
+  child->edx = 0;
+  process_ready(child);
+
+  return child->pid;
+}
+
+void process_exit(uint32_t code)
+{
+  user_exit(code);
+}
+
+void process_block()
+{
+  current->state = PROCESS_BLOCKED;
+  /* back to process_run(), which leaves the process be */
+  user_exit(0);
+}
+
+void process_wake(process_t* process, uint64_t result)
+{
+  process->eax = (uint32_t)result;
+  process->edx = (uint32_t)(result >> 32);
+  process_ready(process);
+}
+
+void process_switch(process_t* process, uint64_t result, uint64_t own)
+{
+  process->eax = (uint32_t)result;
+  process->edx = (uint32_t)(result >> 32);
+  process->state = PROCESS_READY;
+
+  /* first in line */
+  process->next = ready.head;
+  ready.head = process;
+  if (!ready.tail) {
+    ready.tail = process;
+  }
+
+  current->eax = (uint32_t)own;
+  current->edx = (uint32_t)(own >> 32);
+  process_ready(current);
+  user_exit(0);
+}
+
+process_t* process_current()
+{
+  return current;
+}
+
+/* runs in ring 3: touches "pages" heap pages, then returns the cycles fork took */
+static USER_TEXT uint32_t fork_bench_main(uint32_t pages)
+{
+  volatile uint8_t* heap = (uint8_t*)USER_HEAP_BASE;
+  uint32_t i;
+
+  for (i = 0; i < pages; i++) {
+    heap[i * PAGE_SIZE] = 1;
+  }
+
+  uint64_t start = rdtsc();
+  if (syscall_int80(SYS_FORK, 0, 0, 0) == 0) {
+    /* the child */
+    return 0;
+  }
+  return (uint32_t)(rdtsc() - start);
+}
+
+void process_benchmark()
+{
+  static uint32_t pages[] = { 1, 64, 1024 };
+  uint32_t i;
+
+  if (!cpu_has(CPU_FEATURE_TSC)) {
+    printstr("Fork benchmark: no TSC\n");
+    return;
+  }
+
+  for (i = 0; i < sizeof(pages) / sizeof(pages[0]); i++) {
+    process_t* process = process_create(fork_bench_main, pages[i]);
+    if (!process) {
+      printstr("Fork benchmark: out of memory\n");
+      return;
+    }
+
+    printstr("Fork, ");
+    printk(pages[i]);
+    printstr(" pages touched: ");
+    printk(process_run(process));
+    printstr(" cycles\n");
+  }
+}
@@ -0,0 +1,113 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <stdint.h>
+#include <vm.h>
+#include <ipc.h>
+
+/* defined in usermode.s */
+extern uint32_t user_enter(uint32_t eip, uint32_t esp, uint32_t eax, uint32_t edx);
+extern void user_exit(uint32_t code) __attribute__((noreturn));
+extern void user_return(void);
+extern uint8_t ring0_stack_top[];
+
+/*
+  Code that runs in ring 3. The section is mapped read-only into
+  every address space; anything it touches must be on the user stack,
+  in the user heap or in USER_TEXT itself.
+ */
+#define USER_TEXT __attribute__((section(".user.text")))
+
+#define PROCESSES 16
+
+/* exit code of a process that was killed by the kernel */
+#define PROCESS_KILLED 0xFFFFFFFF
+
+/* the areas every process starts out with */
+#define USER_HEAP_BASE USER_BASE
+#define USER_HEAP_SIZE 0x1000000
+#define USER_STACK_SIZE 0x10000
+#define USER_STACK_TOP USER_END
+
+#define PROCESS_FREE 0
+#define PROCESS_READY 1
+#define PROCESS_RUNNING 2
+#define PROCESS_BLOCKED 3 /* in a system call, until process_wake() */
+
+typedef uint32_t (*process_entry_t)(uint32_t arg);
+
+typedef struct process {
+  uint32_t pid;
+  uint32_t state;
+  vm_space_t* space;
+  /* where the process (re)enters ring 3 */
+  uint32_t eip;
+  uint32_t esp;
+  uint32_t eax;
+  uint32_t edx;
+  uint32_t exit_code;
+  struct process* next; /* in the ready queue, or the queue it is blocked in */
+  /* while blocked in a channel: what it is sending, or where it receives pages */
+  ipc_message_t message;
+  uint32_t receive_address;
+} process_t;
+
+/* processes in line for something, first come first served */
+typedef struct {
+  process_t* head;
+  process_t* tail;
+} process_queue_t;
+
+void process_enqueue(process_queue_t* queue, process_t* process);
+
+/* the process first in line, or 0 */
+process_t* process_dequeue(process_queue_t* queue);
+
+/*
+  Creates a process that runs "entry(arg)" in ring 3, in a new address
+  space. When entry returns, its return value becomes the exit code.
+  Returns 0 if we are out of processes or memory.
+ */
+process_t* process_create(process_entry_t entry, uint32_t arg);
+
+/*
+  Runs the process, and every process it forks, to completion. Those
+  still blocked when nobody is left to wake them are killed. Returns
+  the exit code of "process".
+ */
+uint32_t process_run(process_t* process);
+
+/*
+  SYS_FORK: clones the running process, copy-on-write. The child
+  resumes at "eip" with "esp", returning 0. Returns the child pid,
+  or 0xFFFFFFFF on failure.
+ */
+uint32_t process_fork(uint32_t eip, uint32_t esp);
+
+/* terminates the running process, called from SYS_EXIT */
+void process_exit(uint32_t code);
+
+/*
+  Takes the running process off the processor, in the middle of its
+  system call, until someone passes it to process_wake() or
+  process_switch(). Does not return.
+ */
+void process_block() __attribute__((noreturn));
+
+/* lets a blocked process run again, returning "result" from its system call */
+void process_wake(process_t* process, uint64_t result);
+
+/*
+  Like process_wake(), but "process" runs right away, ahead of every
+  process in line; the running process gets back in line, and returns
+  "own" from its system call once it runs again. Does not return.
+ */
+void process_switch(process_t* process, uint64_t result, uint64_t own) __attribute__((noreturn));
+
+/* the running process, or 0 if we are in the kernel */
+process_t* process_current();
+
+/* measures the cost of fork against the number of pages touched */
+void process_benchmark();
+
+#endif
@@ -0,0 +1,251 @@
+#include <profile.h>
+#include <timer.h>
+#include <symbols.h>
+#include <serial.h>
+#include <string.h>
+#include <memory.h>
+#include <cpu.h>
+
+/* functions we keep flat profile counts for */
+#define PROFILE_SYMBOLS 1024
+
+/* long enough for a folded stack PROFILE_DEPTH deep */
+#define PROFILE_LINE 512
+
+typedef struct {
+  uint32_t count;
+  uint32_t dropped; /* samples that did not fit */
+  profile_sample_t samples[PROFILE_SAMPLES];
+} profile_buffer_t;
+
+/* each CPU only ever writes its own buffer, from its timer interrupt */
+static profile_buffer_t buffers[CPUS];
+static volatile uint32_t sampling;
+
+static uint32_t counts[PROFILE_SYMBOLS];
+
+static void profile_interrupt(trap_frame_t* frame)
+{
+  profile_buffer_t* buffer = &buffers[cpu_id()];
+  profile_sample_t* sample;
+
+  if (!sampling) {
+    return;
+  }
+  if (buffer->count == PROFILE_SAMPLES) {
+    buffer->dropped++;
+    return;
+  }
+
+  sample = &buffer->samples[buffer->count++];
+  sample->eip = frame->eip;
+  sample->flags = 0;
+  sample->depth = 0;
+
+  if (trap_from_user(frame)) {
+    sample->flags = PROFILE_USER;
+    return;
+  }
+
+  sample->depth = symbol_backtrace(frame->ebp, sample->stack, PROFILE_DEPTH);
+}
+
+void init_profile()
+{
+  timer_register(profile_interrupt);
+}
+
+void profile_start()
+{
+  uint32_t k;
+
+  sampling = 0;
+  for (k = 0; k < CPUS; k++) {
+    buffers[k].count = 0;
+    buffers[k].dropped = 0;
+  }
+  sampling = 1;
+}
+
+void profile_stop()
+{
+  sampling = 0;
+}
+
+/* the start of the function "address" is in, or "address" if it is not in one */
+static uint32_t function_start(uint32_t address)
+{
+  uint32_t offset;
+
+  if (symbol_index(address, &offset) < 0) {
+    return address;
+  }
+  return address - offset;
+}
+
+static uint32_t format_function(char* buf, uint32_t size, uint32_t address)
+{
+  int32_t index = symbol_index(address, 0);
+
+  if (index < 0) {
+    return format(buf, size, "0x%08x", address);
+  }
+  return format(buf, size, "%s", symbol_name(index));
+}
+
+static void profile_dump_flat(uint32_t total)
+{
+  profile_buffer_t* buffer;
+  uint32_t c, k, best, user = 0, unknown = 0;
+  int32_t index;
+
+  memset((uint8_t*)counts, 0, sizeof(counts));
+
+  for (c = 0; c < CPUS; c++) {
+    buffer = &buffers[c];
+    for (k = 0; k < buffer->count; k++) {
+      index = symbol_index(buffer->samples[k].eip, 0);
+      if (buffer->samples[k].flags & PROFILE_USER) {
+        user++;
+      } else if (index < 0 || index >= PROFILE_SYMBOLS) {
+        unknown++;
+      } else {
+        counts[index]++;
+      }
+    }
+  }
+
+  serial_print("# flat profile\n#  samples       %%  function\n");
+
+  /* highest count first; there are few enough functions to just search */
+  while (1) {
+    best = 0;
+    for (k = 1; k < PROFILE_SYMBOLS; k++) {
+      if (counts[k] > counts[best]) {
+        best = k;
+      }
+    }
+    if (!counts[best]) {
+      break;
+    }
+
+    c = counts[best] * 1000 / total;
+    serial_print("%10u  %3u.%u  %s\n", counts[best], c / 10, c % 10, symbol_name(best));
+    counts[best] = 0;
+  }
+
+  if (user) {
+    c = user * 1000 / total;
+    serial_print("%10u  %3u.%u  [user]\n", user, c / 10, c % 10);
+  }
+  if (unknown) {
+    c = unknown * 1000 / total;
+    serial_print("%10u  %3u.%u  [unknown]\n", unknown, c / 10, c % 10);
+  }
+}
+
+static int32_t sample_compare(profile_sample_t* a, profile_sample_t* b)
+{
+  uint32_t k;
+
+  if (a->flags != b->flags) {
+    return a->flags < b->flags ? -1 : 1;
+  }
+  if (a->depth != b->depth) {
+    return a->depth < b->depth ? -1 : 1;
+  }
+  for (k = 0; k < a->depth; k++) {
+    if (a->stack[k] != b->stack[k]) {
+      return a->stack[k] < b->stack[k] ? -1 : 1;
+    }
+  }
+  if (a->eip != b->eip) {
+    return a->eip < b->eip ? -1 : 1;
+  }
+  return 0;
+}
+
+/* shell sort, so equal call stacks end up next to each other */
+static void profile_sort(profile_sample_t* samples, uint32_t count)
+{
+  profile_sample_t sample;
+  uint32_t gap, i, j;
+
+  for (gap = count / 2; gap > 0; gap /= 2) {
+    for (i = gap; i < count; i++) {
+      sample = samples[i];
+      for (j = i; j >= gap && sample_compare(&samples[j - gap], &sample) > 0; j -= gap) {
+        samples[j] = samples[j - gap];
+      }
+      samples[j] = sample;
+    }
+  }
+}
+
+static void profile_dump_folded(profile_buffer_t* buffer)
+{
+  char line[PROFILE_LINE];
+  profile_sample_t* sample;
+  uint32_t k, d, n, same;
+
+  /* samples anywhere in the same functions fold into one stack; return
+    addresses point after the call, so look up the byte before */
+  for (k = 0; k < buffer->count; k++) {
+    sample = &buffer->samples[k];
+    if (!(sample->flags & PROFILE_USER)) {
+      sample->eip = function_start(sample->eip);
+    }
+    for (d = 0; d < sample->depth; d++) {
+      sample->stack[d] = function_start(sample->stack[d] - 1);
+    }
+  }
+
+  profile_sort(buffer->samples, buffer->count);
+
+  for (k = 0; k < buffer->count; k += same) {
+    sample = &buffer->samples[k];
+    for (same = 1; k + same < buffer->count; same++) {
+      if (sample_compare(sample, &buffer->samples[k + same])) {
+        break;
+      }
+    }
+
+    n = 0;
+    for (d = sample->depth; d > 0; d--) {
+      n += format_function(line + n, PROFILE_LINE - n, sample->stack[d - 1]);
+      n += format(line + n, PROFILE_LINE - n, ";");
+    }
+    if (sample->flags & PROFILE_USER) {
+      n += format(line + n, PROFILE_LINE - n, "[user]");
+    } else {
+      n += format_function(line + n, PROFILE_LINE - n, sample->eip);
+    }
+    n += format(line + n, PROFILE_LINE - n, " %u\n", same);
+    serial_write(line, n);
+  }
+}
+
+void profile_dump()
+{
+  uint32_t k, total = 0, dropped = 0;
+
+  profile_stop();
+
+  for (k = 0; k < CPUS; k++) {
+    total += buffers[k].count;
+    dropped += buffers[k].dropped;
+  }
+
+  serial_print("# profile: %u samples at %u Hz, %u dropped\n", total, TIMER_HZ, dropped);
+  if (!total) {
+    return;
+  }
+
+  profile_dump_flat(total);
+
+  serial_print("# folded stacks\n");
+  for (k = 0; k < CPUS; k++) {
+    profile_dump_folded(&buffers[k]);
+  }
+  serial_print("# end of profile\n");
+}
@@ -0,0 +1,38 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/* samples kept per CPU; at TIMER_HZ this is a few seconds of run time */
+#define PROFILE_SAMPLES 4096
+
+/* return addresses kept per sample, besides the interrupted EIP */
+#define PROFILE_DEPTH 14
+
+/* sample.flags */
+#define PROFILE_USER 0x01 /* taken in ring 3, there is no call stack */
+
+typedef struct {
+  uint32_t eip;
+  uint16_t flags;
+  uint16_t depth;
+  uint32_t stack[PROFILE_DEPTH]; /* innermost caller first */
+} profile_sample_t;
+
+/* hooks the timer; sampling starts with profile_start() */
+void init_profile();
+
+/* throws away earlier samples and starts taking new ones */
+void profile_start();
+
+void profile_stop();
+
+/*
+  Writes the samples to the serial port, as a flat profile of the
+  functions they landed in, then as folded stacks, one
+  "outer;...;inner count" line per distinct call stack, to be fed to
+  flamegraph.pl. Stops the profiler first.
+ */
+void profile_dump();
+
+#endif
@@ -1,31 +1,127 @@
 #include <screen.h>
+#include <fbcon.h>
 #include <memory.h>
+#include <pmc.h>
+#include <io.h>
 
 /* how many spaces a full tab should equal */
 #define TAB_WIDTH 4
 
+/* the CRT controller registers for the text mode cursor */
+#define CRTC_INDEX 0x3D4
+#define CRTC_DATA 0x3D5
+#define CRTC_CURSOR_START 0x0A
+#define CRTC_CURSOR_END 0x0B
+#define CRTC_CURSOR_HIGH 0x0E
+#define CRTC_CURSOR_LOW 0x0F
+#define CRTC_CURSOR_DISABLE 0x20 /* in CRTC_CURSOR_START */
+
+/* the scanlines of a character cell the cursor covers: an underline */
+#define CURSOR_FIRST_LINE 14
+#define CURSOR_LAST_LINE 15
+
 static uint16_t *screen = (uint16_t*)(SCREEN_ADDR << 4);
+static uint8_t screen_cols = SCREEN_COLS;
+static uint8_t screen_rows = SCREEN_ROWS;
+
+/* on a framebuffer, the cells live here and fbcon draws them */
+static uint8_t framebuffer = 0;
+static uint16_t framebuffer_cells[FBCON_MAX_COLS * FBCON_MAX_ROWS];
 
 /* current row */
 static uint8_t row = 0;
 /* current col */
 static uint8_t col = 0;
 
-static inline uint8_t get_color_attribute(uint8_t fg, uint8_t bg)
+/* of what printc() and friends print */
+static uint8_t color = SCREEN_DEFAULT_COLOR;
+
+/* the cell the hardware cursor was last moved to */
+static uint16_t cursor = 0xFFFF;
+
+static PMC_REGION(scroll_region, "scroll");
+
+static inline uint16_t get_text_attribute(char c, uint8_t color)
 {
-  return (bg << 4) | (fg & 0x0F);
+  return (color << 8) | (uint8_t)c;
 }
 
-static inline uint16_t get_text_attribute(char c, uint8_t fg, uint8_t bg)
+/*
+  Moves the blinking cursor to the current position. That takes four
+  port writes, each of which is slow, so it is done once per flush,
+  and only if the cursor has actually moved since.
+ */
+static void update_cursor()
 {
-  return (get_color_attribute(fg, bg) << 8) | c;
+  uint16_t position = row * screen_cols + col;
+
+  if (framebuffer || position == cursor) {
+    return;
+  }
+  cursor = position;
+
+  outportb(CRTC_INDEX, CRTC_CURSOR_HIGH);
+  outportb(CRTC_DATA, position >> 8);
+  outportb(CRTC_INDEX, CRTC_CURSOR_LOW);
+  outportb(CRTC_DATA, position & 0xFF);
+}
+
+/* picks the framebuffer console if stage2 set a VBE mode, and clears the screen */
+void init_screen()
+{
+  if (init_fbcon()) {
+    framebuffer = 1;
+    screen = framebuffer_cells;
+    screen_cols = fbcon_cols();
+    screen_rows = fbcon_rows();
+  }
+
+  clear_screen();
+  /* stage2 hid it */
+  screen_show_cursor(1);
+}
+
+void screen_show_cursor(uint8_t visible)
+{
+  if (framebuffer) {
+    return;
+  }
+
+  outportb(CRTC_INDEX, CRTC_CURSOR_START);
+  outportb(CRTC_DATA, visible ? CURSOR_FIRST_LINE : CRTC_CURSOR_DISABLE);
+  outportb(CRTC_INDEX, CRTC_CURSOR_END);
+  outportb(CRTC_DATA, CURSOR_LAST_LINE);
+}
+
+void screen_set_color(uint8_t attribute)
+{
+  color = attribute;
+}
+
+uint8_t screen_color()
+{
+  return color;
+}
+
+/* makes what has been printed visible */
+void screen_flush()
+{
+  if (framebuffer) {
+    fbcon_flush(screen);
+  }
+  update_cursor();
 }
 
 /* clears whole screen */
 void clear_screen()
 {
-  uint16_t blank = get_text_attribute(' ', WHITE, BLACK);
-  memsetw(screen, blank, SCREEN_ROWS * SCREEN_COLS);
+  uint16_t blank = get_text_attribute(' ', SCREEN_DEFAULT_COLOR);
+  memsetw(screen, blank, screen_rows * screen_cols);
+
+  if (framebuffer) {
+    fbcon_touch_all();
+    screen_flush();
+  }
 
   /*int i;
   for (i = 0; i < SCREEN_ROWS * SCREEN_COLS; ++i) {
@@ -35,11 +131,19 @@ void clear_screen()
 
 /* moves all rows one up */
 void scroll() {
+  pmc_region_start(&scroll_region);
+
   /* move everything one row back */
-  memcpyw(screen, screen + SCREEN_COLS, SCREEN_ROWS * SCREEN_COLS - SCREEN_COLS);
+  memcpyw(screen, screen + screen_cols, screen_rows * screen_cols - screen_cols);
   /* set last row to empty character */
-  uint16_t blank = get_text_attribute(' ', WHITE, BLACK);
-  memsetw(screen + SCREEN_ROWS * SCREEN_COLS - SCREEN_COLS, blank, SCREEN_COLS);
+  uint16_t blank = get_text_attribute(' ', SCREEN_DEFAULT_COLOR);
+  memsetw(screen + screen_rows * screen_cols - screen_cols, blank, screen_cols);
+
+  if (framebuffer) {
+    fbcon_scroll();
+  }
+
+  pmc_region_stop(&scroll_region);
 
   // uint8_t i;
   // uint16_t prev = 0;
@@ -49,24 +153,23 @@ void scroll() {
   //   prev += SCREEN_COLS;
   // }
   // /* zero out last row */
-  // uint16_t c = get_text_attribute(' ', WHITE, BLACK);
+  // uint16_t c = get_text_attribute(' ', SCREEN_DEFAULT_COLOR);
   // memsetw(screen + prev, c, SCREEN_COLS);
 }
 
 /* prints a character at the given position */
-void screen_print(char c, uint8_t row, uint8_t col)
+void screen_print(char c, uint8_t row, uint8_t col, uint8_t color)
 {
-  uint16_t data = get_text_attribute(c, WHITE, BLACK);
-  screen[row * SCREEN_COLS + col] = data;
-}
+  uint16_t data = get_text_attribute(c, color);
+  screen[row * screen_cols + col] = data;
 
-/* print a character at the current position */
-void printc(char s) {
-  if (row == SCREEN_ROWS) {
-    scroll();
-    row = row - 1;
+  if (framebuffer) {
+    fbcon_touch(row);
   }
+}
 
+/* puts a character at the current position, without flushing */
+static void putc(char s) {
   if (s == '\n') {
     col = 0;
     row++;
@@ -75,39 +178,70 @@ void printc(char s) {
   	uint8_t end = col + spaces;
 
   	/* make sure we don't cross any rows */
-  	if (end > SCREEN_COLS) {
-  		end = SCREEN_COLS;
+  	if (end > screen_cols) {
+  		end = screen_cols;
   	}
 
   	uint8_t i;
   	for (i = col; i < end; i++) {
-  		screen_print(' ', row, col++);
+  		screen_print(' ', row, col++, color);
   	}
+  } else if (s == '\b') {
+    if (col > 0) {
+      screen_print(' ', row, --col, color);
+    }
   } else if (s >= 0x20 && s <= 0x7E ) {
   	/* print everything that you can type on a keyboard ... */
-    screen_print(s, row, col++);
+    screen_print(s, row, col++, color);
   }
 
-  if (col == SCREEN_COLS) {
+  if (col == screen_cols) {
     col = 0;
     row++;
   }
+
+  /* right away, so the cursor always has a cell to be in */
+  if (row == screen_rows) {
+    scroll();
+    row = row - 1;
+  }
+}
+
+/* print a character at the current position */
+void printc(char s) {
+  putc(s);
+  screen_flush();
 }
 
 /* print a null-byte terminated string at the current position */
 void printstr(char* s)
 {
   while (*s) {
-    printc(*s++);
+    putc(*s++);
   }
+  screen_flush();
 }
 
 /* print a "len" characters at the current position */
 void printstrl(char* s, uint8_t len) {
   uint8_t k;
   for (k = 0; k < len; k++) {
-    printc(s[k]);
+    putc(s[k]);
   }
+  screen_flush();
+}
+
+/* print a null-byte terminated string at the current position, in "attribute" */
+void printstr_color(char* s, uint8_t attribute)
+{
+  uint8_t previous = color;
+
+  color = attribute;
+  while (*s) {
+    putc(*s++);
+  }
+  color = previous;
+  screen_flush();
 }
 
 void printint(uint8_t k) {
@@ -116,10 +250,10 @@ void printint(uint8_t k) {
 }
 
 uint32_t number_of_digits(uint32_t k) {
-  uint32_t p = 10, q = 1;
-  while (k > p) {
+  uint32_t q = 1;
+  while (k >= 10) {
     q++;
-    p = p * 10;
+    k = k / 10;
   }
   return q;
 }
@@ -143,8 +277,9 @@ void printk(uint32_t k) {
     if (buf[p] == 0) {
       continue;
     }
-    printc(buf[p]);
+    putc(buf[p]);
   }
+  screen_flush();
 }
 
 void printhl(uint32_t dword) {
@@ -161,8 +296,9 @@ void printhl(uint32_t dword) {
   } while (q < 8);
 
   for (p = 0; p < q; p++) {
-    printc(buf[p]);
+    putc(buf[p]);
   }
+  screen_flush();
 }
 
 void printhw(uint16_t word) {
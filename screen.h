@@ -24,13 +24,30 @@
 #define LIGHT_BROWN 0x0E
 #define WHITE 0x0F
 
+/* the attribute byte of a cell: foreground color in the low nibble */
+#define SCREEN_COLOR(fg, bg) (((bg) << 4) | ((fg) & 0x0F))
+#define SCREEN_DEFAULT_COLOR SCREEN_COLOR(WHITE, BLACK)
+
+/* picks the framebuffer console if stage2 set a VBE mode, and clears the screen */
+void init_screen();
+
+/* makes what has been printed visible, and moves the cursor after it */
+void screen_flush();
+
+/* shows or hides the cursor; there is none on the framebuffer console */
+void screen_show_cursor(uint8_t visible);
+
+/* sets the SCREEN_COLOR() everything is printed in from now on */
+void screen_set_color(uint8_t attribute);
+uint8_t screen_color();
+
 /* clears whole screen */
 void clear_screen();
 
 void scroll();
 
-/* prints a character at the given position */
-void screen_print(char c, uint8_t row, uint8_t col);
+/* prints a character at the given position, in "color" (a SCREEN_COLOR()) */
+void screen_print(char c, uint8_t row, uint8_t col, uint8_t color);
 
 /* print a character at the current position */
 void printc(char s);
@@ -41,6 +58,9 @@ void printstr(char* s);
 /* print a "len" characters at the current position */
 void printstrl(char* s, uint8_t len);
 
+/* printstr() in "attribute", a SCREEN_COLOR(), for this call only */
+void printstr_color(char* s, uint8_t attribute);
+
 void printint(uint8_t k);
 
 uint32_t number_of_digits(uint32_t k);
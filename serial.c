@@ -0,0 +1,66 @@
+#include <serial.h>
+#include <string.h>
+#include <io.h>
+
+/* register offsets from the base port */
+#define SERIAL_DATA 0
+#define SERIAL_INTERRUPT_ENABLE 1
+#define SERIAL_DIVISOR_LOW 0 /* with DLAB set */
+#define SERIAL_DIVISOR_HIGH 1 /* with DLAB set */
+#define SERIAL_FIFO_CONTROL 2
+#define SERIAL_LINE_CONTROL 3
+#define SERIAL_MODEM_CONTROL 4
+#define SERIAL_LINE_STATUS 5
+
+#define SERIAL_LINE_8N1 0x03
+#define SERIAL_LINE_DLAB 0x80
+#define SERIAL_FIFO_ENABLE_CLEAR 0xC7 /* enable, clear both, 14 byte threshold */
+#define SERIAL_MODEM_DTR_RTS 0x03
+#define SERIAL_STATUS_THR_EMPTY 0x20
+
+void init_serial()
+{
+  uint16_t divisor = 115200 / SERIAL_BAUD;
+
+  outportb(COM1 + SERIAL_INTERRUPT_ENABLE, 0);
+
+  outportb(COM1 + SERIAL_LINE_CONTROL, SERIAL_LINE_DLAB);
+  outportb(COM1 + SERIAL_DIVISOR_LOW, divisor & 0xFF);
+  outportb(COM1 + SERIAL_DIVISOR_HIGH, divisor >> 8);
+  outportb(COM1 + SERIAL_LINE_CONTROL, SERIAL_LINE_8N1);
+
+  outportb(COM1 + SERIAL_FIFO_CONTROL, SERIAL_FIFO_ENABLE_CLEAR);
+  outportb(COM1 + SERIAL_MODEM_CONTROL, SERIAL_MODEM_DTR_RTS);
+}
+
+void serial_putc(char c)
+{
+  while (!(inportb(COM1 + SERIAL_LINE_STATUS) & SERIAL_STATUS_THR_EMPTY)) {
+    /* wait for the transmitter */
+  }
+  outportb(COM1 + SERIAL_DATA, c);
+}
+
+void serial_write(const char* s, uint32_t len)
+{
+  uint32_t k;
+  for (k = 0; k < len; k++) {
+    if (s[k] == '\n') {
+      serial_putc('\r');
+    }
+    serial_putc(s[k]);
+  }
+}
+
+void serial_print(const char* fmt, ...)
+{
+  char line[SERIAL_LINE];
+  va_list args;
+  uint32_t n;
+
+  va_start(args, fmt);
+  n = vformat(line, SERIAL_LINE, fmt, args);
+  va_end(args);
+
+  serial_write(line, n);
+}
@@ -0,0 +1,24 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+
+#define COM1 0x3F8
+
+#define SERIAL_BAUD 115200
+
+#define SERIAL_LINE 256
+
+/* 8N1 at SERIAL_BAUD on COM1, with the FIFOs on and interrupts off */
+void init_serial();
+
+/* writes one byte, waiting for room in the transmitter */
+void serial_putc(char c);
+
+/* writes "len" bytes; '\n' goes out as "\r\n" */
+void serial_write(const char* s, uint32_t len);
+
+/* formats like format() in string.h, up to SERIAL_LINE characters */
+void serial_print(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif
@@ -0,0 +1,135 @@
+#include <slab.h>
+
+/* at the start of every page of a cache, followed by its objects */
+struct slab {
+  slab_t* next; /* in the partial list */
+  slab_t* previous;
+  void* free; /* free objects, linked through their first word */
+  uint32_t used; /* objects handed out, magazines included */
+};
+
+#define SLAB_FIRST ((sizeof(slab_t) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1))
+
+static void slab_link(slab_cache_t* cache, slab_t* slab)
+{
+  slab->previous = 0;
+  slab->next = cache->partial;
+  if (cache->partial) {
+    cache->partial->previous = slab;
+  }
+  cache->partial = slab;
+}
+
+static void slab_unlink(slab_cache_t* cache, slab_t* slab)
+{
+  if (slab->previous) {
+    slab->previous->next = slab->next;
+  } else {
+    cache->partial = slab->next;
+  }
+  if (slab->next) {
+    slab->next->previous = slab->previous;
+  }
+}
+
+static slab_t* slab_create(slab_cache_t* cache)
+{
+  slab_t* slab = (slab_t*)(uintptr_t)frame_alloc();
+  uint8_t* object;
+
+  if (!slab) {
+    return 0;
+  }
+
+  /* the first object ends up first in the list */
+  slab->free = 0;
+  slab->used = 0;
+  for (object = (uint8_t*)slab + PAGE_SIZE - cache->size; object >= (uint8_t*)slab + SLAB_FIRST;
+      object -= cache->size) {
+    *(void**)object = slab->free;
+    slab->free = object;
+  }
+
+  slab_link(cache, slab);
+  cache->slabs++;
+  return slab;
+}
+
+/* refills a magazine, out of as few slabs as possible */
+static uint32_t slab_fill(void* context, void** objects, uint32_t count)
+{
+  slab_cache_t* cache = context;
+  slab_t* slab;
+  uint32_t n = 0;
+
+  /* slab_cache_init() refused the size */
+  if (!cache->size) {
+    return 0;
+  }
+
+  spin_lock(&cache->lock);
+  while (n < count) {
+    slab = cache->partial ? cache->partial : slab_create(cache);
+    if (!slab) {
+      break;
+    }
+
+    while (n < count && slab->free) {
+      objects[n++] = slab->free;
+      slab->free = *(void**)slab->free;
+      slab->used++;
+    }
+    if (!slab->free) {
+      slab_unlink(cache, slab);
+    }
+  }
+  spin_unlock(&cache->lock);
+
+  return n;
+}
+
+static void slab_drain(void* context, void** objects, uint32_t count)
+{
+  slab_cache_t* cache = context;
+  slab_t* slab;
+  uint32_t k;
+
+  spin_lock(&cache->lock);
+  for (k = 0; k < count; k++) {
+    slab = (slab_t*)((uintptr_t)objects[k] & PAGE_MASK);
+    if (!slab->free) {
+      slab_link(cache, slab);
+    }
+    *(void**)objects[k] = slab->free;
+    slab->free = objects[k];
+
+    if (!--slab->used) {
+      slab_unlink(cache, slab);
+      frame_unref((uint32_t)(uintptr_t)slab);
+      cache->slabs--;
+    }
+  }
+  spin_unlock(&cache->lock);
+}
+
+uint32_t slab_cache_init(slab_cache_t* cache, uint32_t size)
+{
+  uint32_t ok = size && size <= SLAB_MAX;
+
+  cache->size = ok ? (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1) : 0;
+  cache->lock.locked = 0;
+  cache->partial = 0;
+  cache->slabs = 0;
+  magazine_init(&cache->magazines, slab_fill, slab_drain, cache);
+  return ok;
+}
+
+void* slab_alloc(slab_cache_t* cache)
+{
+  return magazine_alloc(&cache->magazines);
+}
+
+void slab_free(slab_cache_t* cache, void* object)
+{
+  magazine_free(&cache->magazines, object);
+}
@@ -0,0 +1,44 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+#include <frame.h>
+#include <magazine.h>
+#include <spinlock.h>
+
+/*
+  Caches of kernel objects of one size, carved out of pages from the
+  frame allocator and handed out through per-CPU magazines (see
+  magazine.h), so most allocations take no lock. A page goes back to
+  the frame allocator once every object on it is free and out of the
+  magazines.
+ */
+
+/* the largest object; a page holds at least eight */
+#define SLAB_MAX (PAGE_SIZE / 8)
+
+/* objects are aligned to this, at least */
+#define SLAB_ALIGN 8
+
+typedef struct slab slab_t;
+
+typedef struct {
+  uint32_t size; /* of an object, rounded up to SLAB_ALIGN */
+  spinlock_t lock; /* of what follows */
+  slab_t* partial; /* the slabs with free objects */
+  uint32_t slabs; /* pages held */
+  magazine_cache_t magazines;
+} slab_cache_t;
+
+/*
+  Sets up a cache of "size" byte objects, from 1 to SLAB_MAX. Returns 0
+  for any other size, leaving a cache that allocates nothing.
+ */
+uint32_t slab_cache_init(slab_cache_t* cache, uint32_t size);
+
+/* an object, or 0 if we are out of memory. The contents are undefined. */
+void* slab_alloc(slab_cache_t* cache);
+
+void slab_free(slab_cache_t* cache, void* object);
+
+#endif
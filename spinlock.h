@@ -0,0 +1,30 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+
+/*
+  Mutual exclusion between CPUs, by spinning. Take one with interrupts
+  disabled if an interrupt handler may take it too, or the handler
+  spins forever on the CPU that holds it.
+ */
+typedef struct {
+  volatile uint32_t locked;
+} spinlock_t;
+
+static inline void spin_lock(spinlock_t* lock)
+{
+  while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+    /* read only while it is taken, so the cache line stays shared */
+    while (lock->locked) {
+      __asm__ __volatile__ ("pause");
+    }
+  }
+}
+
+static inline void spin_unlock(spinlock_t* lock)
+{
+  __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#endif
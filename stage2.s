@@ -13,9 +13,38 @@
 .equ KERNEL_SEGMENT,          0x10000 # safely put right after the first megabyte
 .equ KERNEL_TEMPORARY_SEGMENT,0xA00   # 7 sectors after STAGE2_SEGMENT
 									  # this should reserve more than enough space for the stage2
+# KERNEL.BIN made by util/lz4pack starts with this, "KLZ4"
+.equ KERNEL_LZ4_MAGIC,        0x345a4c4b
+.equ KERNEL_LZ4_HEADER,       12      # magic, compressed size, size
 .equ STACK_SEGMENT,           0x7000
+.equ A20_RETRIES,             0x4000  # checks after the 8042 was asked
 .equ STACK_POINTER,           0xfffe
 
+# Information handed over to the kernel lives in low memory at 0x1000,
+# which nothing overwrites before the kernel is done with it
+# (see vbe.h for the kernel side)
+.equ BOOT_HANDOFF_SEGMENT,    0x100
+.equ VBE_MAGIC_OFFSET,        0x0     # VBE_MAGIC if a VBE mode was set
+.equ VBE_MODE_OFFSET,         0x4     # the mode number
+.equ VBE_MODE_INFO_OFFSET,    0x8     # the 256 byte mode info block
+.equ VBE_CONTROLLER_OFFSET,   0x200   # 512 bytes of scratch for 0x4f00
+.equ FONT_OFFSET,             0x1000  # the 8x16 BIOS font, 4096 bytes
+
+.equ VBE_MAGIC,               0x4d454256 # "VBEM"
+.equ BOOT_STAGE2_MAGIC,       0x32475453 # "STG2", in %eax for the kernel
+
+# The framebuffer mode to look for. Assemble with
+# --defsym VBE_WIDTH=0 to stay in text mode.
+.ifndef VBE_WIDTH
+.equ VBE_WIDTH,               1024
+.endif
+.ifndef VBE_HEIGHT
+.equ VBE_HEIGHT,              768
+.endif
+.ifndef VBE_BPP
+.equ VBE_BPP,                 32
+.endif
+
 .equ GDT, 0
 .equ LDT, 1
 
@@ -100,8 +129,10 @@ real_start:
 	# preserve it
 	push %bx
 
-	call make_cursor_invisible
+	# before the mode switch, so its error message can still be read
 	call set_a20
+	call make_cursor_invisible
+	call set_vbe_mode
 
 	# Setup GDT
 	cli
@@ -151,6 +182,9 @@ segments_reloaded:
 	# move kernel to KERNEL_SEGMENT, as we have access to > 1 MB now
 	# xor %ebx, %ebx
 	# movw kernel_size, %bx
+	cld
+	cmpl $KERNEL_LZ4_MAGIC, (KERNEL_TEMPORARY_SEGMENT << 4)
+	je decompress_kernel
 
 	# copy %ds:%si to %es:%di
 	xor %esi, %esi
@@ -161,6 +195,80 @@ segments_reloaded:
 	xor %ecx, %ecx
 	mov kernel_size, %cx
 	rep movsb
+	jmp kernel_in_place
+
+#
+# The kernel was compressed by util/lz4pack, into a header and one LZ4
+# block (see there for the format). Fewer sectors to read from floppy
+# more than pays for decoding it here, straight into KERNEL_SEGMENT.
+# There is no usable stack yet, so this stays in registers:
+#
+# %esi: the compressed block, %edx: its end
+# %edi: where the output goes
+# %ebx: the current token, then the match offset
+# %ecx: the length of what is copied next
+# %eax: scratch
+#
+decompress_kernel:
+	mov $(KERNEL_TEMPORARY_SEGMENT << 4) + KERNEL_LZ4_HEADER, %esi
+	mov %esi, %edx
+	add (KERNEL_TEMPORARY_SEGMENT << 4) + 4, %edx
+	mov $(KERNEL_SEGMENT << 4), %edi
+
+# adds the extra length bytes to %ecx if its nibble said 15
+.macro m_lz4_length
+	cmp $15, %ecx
+	jne 2f
+1:
+	movzbl (%esi), %eax
+	inc %esi
+	add %eax, %ecx
+	cmp $255, %eax
+	je 1b
+2:
+.endm
+
+decompress_sequence:
+	movzbl (%esi), %ebx
+	inc %esi
+
+	# the literals
+	mov %ebx, %ecx
+	shr $4, %ecx
+	m_lz4_length
+	rep movsb
+
+	# the last sequence ends after its literals
+	cmp %edx, %esi
+	jae decompress_done
+
+	# the match: a 16 bit offset back into the output, and a length of
+	# at least 4; copied a byte at a time, as it may overlap itself
+	mov %ebx, %ecx
+	and $15, %ecx
+	movzwl (%esi), %ebx
+	add $2, %esi
+	m_lz4_length
+	add $4, %ecx
+
+	mov %esi, %eax
+	mov %edi, %esi
+	sub %ebx, %esi
+	rep movsb
+	mov %eax, %esi
+	jmp decompress_sequence
+
+decompress_done:
+	# a corrupt kernel would not get far; say so instead of jumping into it
+	sub $(KERNEL_SEGMENT << 4), %edi
+	cmp (KERNEL_TEMPORARY_SEGMENT << 4) + 8, %edi
+	je kernel_in_place
+	movl $0x4f5a4f4c, 0xb8000 # "LZ" in white on red
+1:
+	hlt
+	jmp 1b
+
+kernel_in_place:
 
 	# do a long jump to reload code segment to the GDT selector,
 	# as we are now switching from real mode to protected mode
@@ -168,6 +276,10 @@ segments_reloaded:
 	# memory location 0x00000000.
 
 	xchgw %bx, %bx
+
+	# tell the kernel it was us, and where the handoff is (see boot.h)
+	mov $BOOT_STAGE2_MAGIC, %eax
+	mov $(BOOT_HANDOFF_SEGMENT << 4), %ebx
 	ljmp $CODE_SEGMENT, $(KERNEL_SEGMENT << 4)
 
 .code16
@@ -204,36 +316,219 @@ make_cursor_invisible:
 	int     $0x10       # BIOS call
 	ret
 
+#
+# Looks for a VBE_WIDTH x VBE_HEIGHT x VBE_BPP mode with a linear
+# framebuffer and switches to it, leaving the mode info block and the
+# BIOS font for the kernel at BOOT_HANDOFF_SEGMENT. Without VBE 2.0,
+# or a matching mode, we stay in text mode.
+#
+set_vbe_mode:
+	push %es
+	push %fs
+	pusha
+
+	mov $BOOT_HANDOFF_SEGMENT, %ax
+	mov %ax, %es
+	movl $0, %es:VBE_MAGIC_OFFSET
+
+.if VBE_WIDTH
+	# get a pointer to the 8x16 font (bh = 6) into es:bp
+	push %es
+	mov $0x1130, %ax
+	mov $0x0600, %bx
+	int $0x10
+
+	# copy 256 glyphs of 16 bytes to BOOT_HANDOFF_SEGMENT:FONT_OFFSET
+	push %ds
+	mov %es, %ax
+	mov %ax, %ds
+	mov %bp, %si
+	mov $BOOT_HANDOFF_SEGMENT, %ax
+	mov %ax, %es
+	mov $FONT_OFFSET, %di
+	mov $4096, %cx
+	cld
+	rep movsb
+	pop %ds
+	pop %es
+
+	# VBE controller information; asking for "VBE2" gets us the 2.0 fields
+	mov $VBE_CONTROLLER_OFFSET, %di
+	movl $0x32454256, %es:(%di)
+	mov $0x4f00, %ax
+	int $0x10
+	cmp $0x004f, %ax
+	jne set_vbe_mode_done
+	cmpw $0x0200, %es:VBE_CONTROLLER_OFFSET+4
+	jb set_vbe_mode_done
+
+	# fs:si = the mode list, terminated by 0xffff
+	mov %es:VBE_CONTROLLER_OFFSET+14, %si
+	mov %es:VBE_CONTROLLER_OFFSET+16, %ax
+	mov %ax, %fs
+
+set_vbe_mode_next:
+	mov %fs:(%si), %cx
+	add $2, %si
+	cmp $0xffff, %cx
+	je set_vbe_mode_done
+
+	# mode info for mode %cx into es:di
+	push %si
+	push %cx
+	mov $VBE_MODE_INFO_OFFSET, %di
+	mov $0x4f01, %ax
+	int $0x10
+	pop %cx
+	pop %si
+	cmp $0x004f, %ax
+	jne set_vbe_mode_next
+
+	# attributes: supported (0), graphics (4), linear framebuffer (7)
+	mov %es:VBE_MODE_INFO_OFFSET, %ax
+	and $0x91, %ax
+	cmp $0x91, %ax
+	jne set_vbe_mode_next
+	cmpw $VBE_WIDTH, %es:VBE_MODE_INFO_OFFSET+18
+	jne set_vbe_mode_next
+	cmpw $VBE_HEIGHT, %es:VBE_MODE_INFO_OFFSET+20
+	jne set_vbe_mode_next
+	cmpb $VBE_BPP, %es:VBE_MODE_INFO_OFFSET+25
+	jne set_vbe_mode_next
+
+	# set the mode, bit 14 asks for the linear framebuffer
+	push %cx
+	mov %cx, %bx
+	or $0x4000, %bx
+	mov $0x4f02, %ax
+	int $0x10
+	pop %cx
+	cmp $0x004f, %ax
+	jne set_vbe_mode_done
+
+	mov %cx, %es:VBE_MODE_OFFSET
+	movl $VBE_MAGIC, %es:VBE_MAGIC_OFFSET
+
+set_vbe_mode_done:
+.endif
+	popa
+	pop %fs
+	pop %es
+	ret
+
+#
+# Turns on the A20 line, so addresses above 1 MB do not wrap around to
+# 0; the kernel goes to KERNEL_SEGMENT << 4. Cheapest first, checking
+# after every step: it may be on already (QEMU, most newer BIOSes), then
+# the BIOS call, then "fast A20" through port 0x92, and only then the
+# slow 8042 keyboard controller. Halts with a message if nothing works,
+# rather than booting a kernel that is then silently corrupted.
+#
 set_a20:
-  pushw  %bp
-  movw  %sp,%bp
-  pushw  %ax
-
-  # write output port
-set_a20_loop1:
-  in  $0x64,%al
-  test  $2,%al
-  loopnz  set_a20_loop1
-  movb  $0xd1,%al
-  out  %al,$0x64
-
-  # enable A20 address line
-set_a20_loop2:
-  in  $0x64,%al
-  test  $2,%al
-  loopnz  set_a20_loop2
-  movb  $0xdf,%al
-  out  %al,$0x60
-
-set_a20_loop3:
-  in  $0x64,%al
-  test  $2,%al
-  loopnz  set_a20_loop3
-
-  popw  %ax
-  movw  %bp,%sp
-  popw  %bp
-  retw
+	pusha
+
+	call a20_enabled
+	jnz set_a20_done
+
+	# BIOS: int 15h, ax = 2401h; the check below tells whether it worked
+	mov $0x2401, %ax
+	int $0x15
+	call a20_enabled
+	jnz set_a20_done
+
+	# fast A20: bit 1 of the system control port; bit 0 would reset
+	in $0x92, %al
+	test $2, %al
+	jnz set_a20_keyboard_controller
+	or $2, %al
+	and $0xfe, %al
+	out %al, $0x92
+	call a20_enabled
+	jnz set_a20_done
+
+set_a20_keyboard_controller:
+	call a20_keyboard_controller
+
+	# the controller may take a while to actually switch it
+	mov $A20_RETRIES, %cx
+set_a20_wait:
+	call a20_enabled
+	jnz set_a20_done
+	loop set_a20_wait
+
+	mov $str_a20_error, %si
+	call print
+set_a20_halt:
+	cli
+	hlt
+	jmp set_a20_halt
+
+set_a20_done:
+	popa
+	ret
+
+#
+# Clears ZF if A20 is on: with it off, 0xffff:0x0510 is the same byte as
+# 0x0000:0x0500. Both bytes are restored afterwards.
+#
+a20_enabled:
+	push %ds
+	push %es
+	push %ax
+	push %bx
+
+	xor %ax, %ax
+	mov %ax, %es
+	not %ax
+	mov %ax, %ds
+
+	movb %es:0x0500, %bl
+	movb %ds:0x0510, %bh
+
+	movb $0x00, %es:0x0500
+	movb $0xff, %ds:0x0510
+	cmpb $0xff, %es:0x0500
+
+	# mov and pop leave the flags alone
+	movb %bh, %ds:0x0510
+	movb %bl, %es:0x0500
+
+	pop %bx
+	pop %ax
+	pop %es
+	pop %ds
+	ret
+
+#
+# The original way: tell the 8042 to write its output port (0xd1), with
+# the A20 bit set (0xdf), waiting for its input buffer to empty first.
+#
+a20_keyboard_controller:
+	push %ax
+	push %cx
+
+	call a20_keyboard_controller_wait
+	movb $0xd1, %al
+	out %al, $0x64
+
+	call a20_keyboard_controller_wait
+	movb $0xdf, %al
+	out %al, $0x60
+
+	call a20_keyboard_controller_wait
+
+	pop %cx
+	pop %ax
+	ret
+
+# waits for bit 1 of the status register (input buffer full) to clear
+a20_keyboard_controller_wait:
+	mov $0xffff, %cx
+a20_keyboard_controller_wait_loop:
+	in $0x64, %al
+	test $2, %al
+	loopnz a20_keyboard_controller_wait_loop
+	ret
 
 clear_screen:
 	#
@@ -467,6 +762,7 @@ str_reboot: .string "Press key to reboot\r\n"
 str_copy_bpb: .string "Copying BPB\r\n"
 str_locating_kernel: .string "Locating KERNEL.BIN on floppy\r\n"
 str_loading_kernel: .string "Loading kernel\r\n"
+str_a20_error: .string "Could not enable A20\r\n"
 
 # just to fill up some sectors
 .=2048
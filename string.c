@@ -1,10 +1,199 @@
 #include <string.h>
+#include <compiler.h>
+#include <cpu.h>
+#include <frame.h>
+#include <word.h>
+
+uint32_t strlen_words(const char* s)
+{
+  const char* p = s;
+  uint32_t mask;
+
+  while ((uintptr_t)p & 3) {
+    if (!*p) {
+      return p - s;
+    }
+    p++;
+  }
+  while (!(mask = word_zero_bytes(*(const word_t*)p))) {
+    p += 4;
+  }
+  return p - s + word_first_byte(mask);
+}
+
+typedef char v16qi __attribute__((vector_size(16), may_alias));
+
+/* a bit per byte of the 16 at "p" that is zero */
+__attribute__((target("sse2"))) static inline uint32_t zero_bytes(const char* p)
+{
+  v16qi zero = { 0 };
+  return __builtin_ia32_pmovmskb128(__builtin_ia32_pcmpeqb128(*(const v16qi*)p, zero));
+}
+
+/*
+  Compares 16 bytes at a time. The loads are aligned, so they never
+  cross into a page past the end of the string; the bytes before "s" in
+  the first one are shifted out of the mask.
+ */
+__attribute__((target("sse2"))) uint32_t strlen_sse2(const char* s)
+{
+  uint32_t offset = (uintptr_t)s & 15, mask;
+  const char* p = s - offset;
+
+  mask = zero_bytes(p) >> offset;
+  if (mask) {
+    return __builtin_ctz(mask);
+  }
+  do {
+    p += 16;
+    mask = zero_bytes(p);
+  } while (!mask);
+  return p - s + __builtin_ctz(mask);
+}
+
+static uint32_t (*strlen_best)(const char* s) = strlen_words;
+
+CPU_DISPATCH(strlen, strlen_best,
+  CPU_VARIANT(strlen_sse2, CPU_FEATURE_SSE2, 0, 0),
+  CPU_VARIANT(strlen_words, 0, 0, 0));
 
 uint32_t strlen(const char* s)
 {
-  uint32_t i = 0;
-  while (*s++) {
-    i++;
+  return strlen_best(s);
+}
+
+/*
+  "a" is brought to a word boundary, "b" is loaded unaligned, except
+  for the words that would run into the next page: that page may not
+  be mapped if the string ends before it.
+ */
+int32_t strcmp(const char* a, const char* b)
+{
+  const uint8_t* x = (const uint8_t*)a;
+  const uint8_t* y = (const uint8_t*)b;
+  uint32_t mask, k;
+
+  while ((uintptr_t)x & 3) {
+    if (*x != *y || !*x) {
+      return *x - *y;
+    }
+    x++;
+    y++;
   }
-  return i;
+
+  for (;;) {
+    if (((uintptr_t)y & (PAGE_SIZE - 1)) > PAGE_SIZE - 4) {
+      for (k = 0; k < 4; k++, x++, y++) {
+        if (*x != *y || !*x) {
+          return *x - *y;
+        }
+      }
+      continue;
+    }
+
+    /* the first byte that differs or ends "a" */
+    mask = (*(const word_t*)x ^ *(const unaligned_word_t*)y) | word_zero_bytes(*(const word_t*)x);
+    if (mask) {
+      k = word_first_byte(mask);
+      return x[k] - y[k];
+    }
+    x += 4;
+    y += 4;
+  }
+}
+
+HOT static uint32_t format_number(char* buf, uint32_t size, uint32_t value, uint32_t base, uint32_t width, char pad)
+{
+  char* alphabet = "0123456789abcdef";
+  char digits[32];
+  uint32_t q = 0, n = 0;
+
+  do {
+    digits[q++] = alphabet[value % base];
+    value /= base;
+  } while (value);
+
+  while (width > q && n < size) {
+    buf[n++] = pad;
+    width--;
+  }
+  while (q && n < size) {
+    buf[n++] = digits[--q];
+  }
+  return n;
+}
+
+HOT uint32_t vformat(char* buf, uint32_t size, const char* fmt, va_list args)
+{
+  uint32_t n = 0, width, magnitude;
+  int32_t value;
+  char pad, *s;
+
+  while (*fmt && n < size) {
+    if (*fmt != '%') {
+      buf[n++] = *fmt++;
+      continue;
+    }
+    fmt++;
+
+    pad = ' ';
+    if (*fmt == '0') {
+      pad = '0';
+      fmt++;
+    }
+    width = 0;
+    while (*fmt >= '0' && *fmt <= '9') {
+      width = width * 10 + *fmt++ - '0';
+    }
+
+    switch (*fmt) {
+      case 's':
+        s = va_arg(args, char*);
+        if (!s) {
+          s = "(null)";
+        }
+        while (*s && n < size) {
+          buf[n++] = *s++;
+        }
+        break;
+      case 'c':
+        buf[n++] = (char)va_arg(args, int);
+        break;
+      case 'd':
+        value = va_arg(args, int32_t);
+        /* unsigned, as -INT32_MIN overflows */
+        magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+        if (value < 0) {
+          buf[n++] = '-';
+        }
+        n += format_number(buf + n, size - n, magnitude, 10, width, pad);
+        break;
+      case 'u':
+        n += format_number(buf + n, size - n, va_arg(args, uint32_t), 10, width, pad);
+        break;
+      case 'x':
+        n += format_number(buf + n, size - n, va_arg(args, uint32_t), 16, width, pad);
+        break;
+      case '%':
+        buf[n++] = '%';
+        break;
+      case 0:
+        /* a '%' at the very end */
+        return n;
+    }
+    fmt++;
+  }
+
+  return n;
+}
+
+uint32_t format(char* buf, uint32_t size, const char* fmt, ...)
+{
+  va_list args;
+  uint32_t n;
+
+  va_start(args, fmt);
+  n = vformat(buf, size, fmt, args);
+  va_end(args);
+  return n;
 }
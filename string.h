@@ -2,7 +2,23 @@
 #define STRING_H
 
 #include <stdint.h>
+#include <stdarg.h>
 
 uint32_t strlen(const char* s);
 
+/* the implementations strlen() picks from, see string.c */
+uint32_t strlen_words(const char* s);
+uint32_t strlen_sse2(const char* s);
+
+/* less than, equal to or greater than 0, as "a" sorts before, with or after "b" */
+int32_t strcmp(const char* a, const char* b);
+
+/*
+  printf-like formatting into "buf", supporting %s %c %d %u %x and zero
+  padded widths like %08x. Writes at most "size" characters, without a
+  terminating null byte, and returns how many it wrote.
+ */
+uint32_t vformat(char* buf, uint32_t size, const char* fmt, va_list args);
+uint32_t format(char* buf, uint32_t size, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
 #endif
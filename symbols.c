@@ -0,0 +1,71 @@
+#include <symbols.h>
+
+/*
+  Generated into kernel_symbols.s by util/symbols.sh. The first link of
+  the kernel has no table, so these are weak and resolve to 0 there.
+ */
+extern uint32_t symbol_count __attribute__((weak));
+extern uint32_t symbol_addresses[] __attribute__((weak));
+extern char* symbol_names[] __attribute__((weak));
+
+/* defined by kernel.ld; the kernel stacks are in .bss */
+extern uint8_t _text[];
+extern uint8_t _text_end[];
+extern uint8_t _bss[];
+extern uint8_t _bss_end[];
+
+uint32_t symbols()
+{
+  return &symbol_count ? symbol_count : 0;
+}
+
+int32_t symbol_index(uint32_t address, uint32_t* offset)
+{
+  uint32_t low = 0, high = symbols(), middle;
+
+  if (!high || address < symbol_addresses[0] || address >= (uint32_t)_text_end) {
+    return -1;
+  }
+
+  /* the last symbol at or below "address" */
+  while (high - low > 1) {
+    middle = low + (high - low) / 2;
+    if (symbol_addresses[middle] <= address) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (offset) {
+    *offset = address - symbol_addresses[low];
+  }
+  return low;
+}
+
+char* symbol_name(int32_t index)
+{
+  return symbol_names[index];
+}
+
+uint32_t symbol_backtrace(uint32_t ebp, uint32_t* addresses, uint32_t max)
+{
+  uint32_t depth = 0, next, address;
+
+  /* follow the saved frame pointers, as long as they stay on a kernel stack */
+  while (depth < max && !(ebp & 3) && ebp >= (uint32_t)_bss && ebp + 8 <= (uint32_t)_bss_end) {
+    /* an ebp used for something else, rather than a frame */
+    address = ((uint32_t*)ebp)[1];
+    if (address < (uint32_t)_text || address >= (uint32_t)_text_end) {
+      break;
+    }
+    addresses[depth++] = address;
+
+    next = ((uint32_t*)ebp)[0];
+    if (next <= ebp) {
+      break;
+    }
+    ebp = next;
+  }
+  return depth;
+}
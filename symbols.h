@@ -0,0 +1,26 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdint.h>
+
+/*
+  Finds the function "address" is in, from the table util/symbols.sh
+  builds out of kernel.out. Returns its index and stores the offset
+  into it, or returns -1 if the address is not in kernel code.
+ */
+int32_t symbol_index(uint32_t address, uint32_t* offset);
+
+/* the name of the symbol at "index", from symbol_index() */
+char* symbol_name(int32_t index);
+
+uint32_t symbols();
+
+/*
+  Stores up to "max" return addresses, innermost first, by following
+  the frame pointers from "ebp". Stops at the first one that is not on
+  a kernel stack, or whose return address is not in the kernel's code,
+  so a corrupt chain is safe to walk and adds no made up frames.
+ */
+uint32_t symbol_backtrace(uint32_t ebp, uint32_t* addresses, uint32_t max);
+
+#endif
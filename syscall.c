@@ -0,0 +1,148 @@
+#include <syscall.h>
+#include <process.h>
+#include <ipc.h>
+#include <idt.h>
+#include <gdt.h>
+#include <cpu.h>
+#include <vm.h>
+#include <screen.h>
+#include <compiler.h>
+
+/* defined in usermode.s */
+extern void sysenter_entry(void);
+extern void int80_entry(void);
+
+#define BENCH_ITERATIONS 10000
+#define BENCH_ROUNDS 8
+
+syscall_entry_t syscall = syscall_int80;
+
+static uint32_t sys_exit(uint32_t code, uint32_t a2, uint32_t a3)
+{
+  process_exit(code);
+  /* never reached */
+  return 0;
+}
+
+static uint32_t sys_write(uint32_t buf, uint32_t len, uint32_t a3)
+{
+  char* s = (char*)buf;
+  uint32_t k, chunk;
+
+  if (!vm_user_range_ok(buf, len)) {
+    return (uint32_t)-1;
+  }
+
+  /* printstrl() takes at most 255 characters at a time */
+  for (k = 0; k < len; k += chunk) {
+    chunk = len - k > 255 ? 255 : len - k;
+    printstrl(s + k, chunk);
+  }
+  return len;
+}
+
+static uint32_t sys_getpid(uint32_t a1, uint32_t a2, uint32_t a3)
+{
+  process_t* process = process_current();
+  return process ? process->pid : 0;
+}
+
+static uint32_t sys_nop(uint32_t a1, uint32_t a2, uint32_t a3)
+{
+  return 0;
+}
+
+static syscall_handler_t handlers[SYSCALLS] = {
+  [SYS_EXIT] = sys_exit,
+  [SYS_WRITE] = sys_write,
+  [SYS_GETPID] = sys_getpid,
+  [SYS_NOP] = sys_nop,
+  [SYS_SEND] = ipc_send,
+  [SYS_GRANT] = ipc_grant
+};
+
+HOT uint64_t syscall_dispatch(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t eip, uint32_t esp)
+{
+  process_t* process = process_current();
+
+  /* where the process picks up again if the call blocks */
+  process->eip = eip;
+  process->esp = esp;
+
+  /* fork takes no arguments, but needs to know where the child resumes */
+  if (number == SYS_FORK) {
+    return process_fork(eip, esp);
+  }
+
+  if (number == SYS_RECEIVE) {
+    return ipc_receive(a1, a2);
+  }
+
+  if (number >= SYSCALLS || !handlers[number]) {
+    return (uint32_t)-1;
+  }
+  return handlers[number](a1, a2, a3);
+}
+
+void init_syscalls(uint32_t kernel_stack)
+{
+  /* DPL 3, so ring 3 may use "int $0x80" */
+  idt_set_gate(SYSCALL_INT, int80_entry, IDT_INTERRUPT_GATE | IDT_USER);
+
+  if (cpu_has(CPU_FEATURE_SEP | CPU_FEATURE_MSR)) {
+    wrmsr(MSR_IA32_SYSENTER_CS, KERNEL_CODE_SELECTOR);
+    wrmsr(MSR_IA32_SYSENTER_ESP, kernel_stack);
+    wrmsr(MSR_IA32_SYSENTER_EIP, (uint32_t)sysenter_entry);
+    syscall = syscall_sysenter;
+  }
+}
+
+/* runs in ring 3: returns the best average cost of SYS_NOP through "arg" */
+static USER_TEXT uint32_t syscall_bench_main(uint32_t arg)
+{
+  syscall_entry_t entry = (syscall_entry_t)arg;
+  uint32_t i, round, cycles, best = 0xFFFFFFFF;
+
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    uint64_t start = rdtsc();
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+      entry(SYS_NOP, 0, 0, 0);
+    }
+    cycles = (uint32_t)(rdtsc() - start) / BENCH_ITERATIONS;
+
+    if (cycles < best) {
+      best = cycles;
+    }
+  }
+
+  return best;
+}
+
+static uint32_t syscall_bench_run(syscall_entry_t entry)
+{
+  process_t* process = process_create(syscall_bench_main, (uint32_t)entry);
+  if (!process) {
+    return 0;
+  }
+  return process_run(process);
+}
+
+void syscall_benchmark()
+{
+  if (!cpu_has(CPU_FEATURE_TSC)) {
+    printstr("Syscall benchmark: no TSC\n");
+    return;
+  }
+
+  printstr("Syscall int 0x80: ");
+  printk(syscall_bench_run(syscall_int80));
+  printstr(" cycles\n");
+
+  if (syscall == syscall_sysenter) {
+    printstr("Syscall sysenter: ");
+    printk(syscall_bench_run(syscall_sysenter));
+    printstr(" cycles\n");
+  } else {
+    printstr("Syscall sysenter: not supported\n");
+  }
+}
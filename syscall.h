@@ -0,0 +1,51 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+
+/*
+  System call convention, for both "sysenter" and "int $0x80":
+
+  %eax: system call number
+  %ebx, %esi, %edi: arguments
+  %edx:%eax: return value, in the stubs below; only SYS_RECEIVE uses
+  the high half
+
+  %ecx and %edx are clobbered (sysenter uses them for the return
+  %esp and %eip), everything else is preserved.
+
+  Calls that block (see ipc.h) resume where they were made, once the
+  process is woken, with the result it was woken with.
+ */
+#define SYS_EXIT 0
+#define SYS_WRITE 1
+#define SYS_GETPID 2
+#define SYS_NOP 3
+#define SYS_FORK 4
+#define SYS_SEND 5
+#define SYS_GRANT 6
+#define SYS_RECEIVE 7
+#define SYSCALLS 8
+
+#define SYSCALL_INT 0x80
+
+typedef uint32_t (*syscall_handler_t)(uint32_t, uint32_t, uint32_t);
+typedef uint64_t (*syscall_entry_t)(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* defined in usermode.s; ring 3 stubs that enter the kernel */
+extern uint64_t syscall_sysenter(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3);
+extern uint64_t syscall_int80(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* the fastest entry stub the CPU supports, chosen by init_syscalls() */
+extern syscall_entry_t syscall;
+
+/* installs the "int $0x80" gate and, if supported, the SYSENTER MSRs */
+void init_syscalls(uint32_t kernel_stack);
+
+/* called by the entry stubs in usermode.s, with the state to return to ring 3 with */
+uint64_t syscall_dispatch(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t eip, uint32_t esp);
+
+/* measures the round trip of SYS_NOP from ring 3, for each entry path */
+void syscall_benchmark();
+
+#endif
@@ -0,0 +1,159 @@
+#include "test.h"
+#include <fat.h>
+
+/* a FAT16 worth of entries, as big as a FAT12 on a floppy gets */
+#define ENTRIES 4086
+
+static uint8_t packed[ENTRIES * 3 / 2 + 1];
+static uint16_t scalar[ENTRIES + 8];
+static uint16_t ssse3[ENTRIES + 8];
+static uint16_t entries[ENTRIES];
+
+/* packs "values" the way a FAT12 stores them */
+static void pack12(const uint16_t* values, uint32_t count)
+{
+  uint32_t k;
+  for (k = 0; k < count; k++) {
+    uint8_t* p = packed + k * 3 / 2;
+    if (k & 1) {
+      p[0] = (p[0] & 0x0F) | (values[k] << 4);
+      p[1] = values[k] >> 4;
+    } else {
+      p[0] = values[k];
+      p[1] = (p[1] & 0xF0) | ((values[k] >> 8) & 0x0F);
+    }
+  }
+}
+
+TEST(fat12_unpack_matches_the_packed_entries)
+{
+  static uint32_t counts[] = { 0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 100, ENTRIES };
+  uint32_t i, k;
+
+  for (k = 0; k < ENTRIES; k++) {
+    entries[k] = (k * 2654435761u) >> 20;
+  }
+  pack12(entries, ENTRIES);
+
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    for (k = 0; k < ENTRIES + 8; k++) {
+      scalar[k] = ssse3[k] = 0xAAAA;
+    }
+
+    fat12_unpack_scalar(packed, scalar, counts[i]);
+    fat12_unpack_ssse3(packed, ssse3, counts[i]);
+
+    for (k = 0; k < counts[i]; k++) {
+      EXPECT_EQ(scalar[k], entries[k]);
+      EXPECT_EQ(ssse3[k], entries[k]);
+    }
+    /* and nothing past them */
+    EXPECT_EQ(scalar[counts[i]], 0xAAAA);
+    EXPECT_EQ(ssse3[counts[i]], 0xAAAA);
+  }
+}
+
+TEST(fat16_unpack_is_little_endian)
+{
+  static const uint8_t fat[] = { 0xF8, 0xFF, 0xFF, 0xFF, 0x03, 0x00, 0x34, 0x12 };
+  uint16_t out[4];
+
+  fat16_unpack(fat, out, 4);
+  EXPECT_EQ(out[0], 0xFFF8);
+  EXPECT_EQ(out[1], 0xFFFF);
+  EXPECT_EQ(out[2], 0x0003);
+  EXPECT_EQ(out[3], 0x1234);
+}
+
+static fat_t fat12 = { entries, 32, FAT12_BAD };
+
+static void chain(const uint16_t* clusters, uint32_t count)
+{
+  uint32_t k;
+  for (k = 0; k + 1 < count; k++) {
+    entries[clusters[k]] = clusters[k + 1];
+  }
+  entries[clusters[count - 1]] = 0xFFF;
+}
+
+static void clear()
+{
+  uint32_t k;
+  for (k = 0; k < 32; k++) {
+    entries[k] = FAT_FREE;
+  }
+}
+
+TEST(fat_extents_merges_consecutive_clusters)
+{
+  static const uint16_t clusters[] = { 2, 3, 4, 10, 11, 7, 8, 9 };
+  fat_extent_t extents[4];
+  uint32_t count = 4, length;
+
+  clear();
+  chain(clusters, 8);
+
+  EXPECT_EQ(fat_extents(&fat12, 2, extents, &count, &length), FAT_CHAIN_END);
+  EXPECT_EQ(count, 3);
+  EXPECT_EQ(length, 8);
+  EXPECT_EQ(extents[0].start, 2);
+  EXPECT_EQ(extents[0].length, 3);
+  EXPECT_EQ(extents[1].start, 10);
+  EXPECT_EQ(extents[1].length, 2);
+  EXPECT_EQ(extents[2].start, 7);
+  EXPECT_EQ(extents[2].length, 3);
+
+  /* no room for the third extent */
+  count = 2;
+  EXPECT_EQ(fat_extents(&fat12, 2, extents, &count, &length), FAT_CHAIN_FULL);
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(length, 5);
+}
+
+TEST(fat_extents_stops_at_broken_chains)
+{
+  static const uint16_t clusters[] = { 5, 6, 20 };
+  fat_extent_t extents[32];
+  uint32_t count;
+
+  clear();
+  chain(clusters, 3);
+
+  entries[20] = FAT_FREE;
+  count = 32;
+  EXPECT_EQ(fat_extents(&fat12, 5, extents, &count, 0), FAT_CHAIN_FREE);
+  EXPECT_EQ(count, 2);
+
+  entries[20] = FAT12_BAD;
+  count = 32;
+  EXPECT_EQ(fat_extents(&fat12, 5, extents, &count, 0), FAT_CHAIN_BAD);
+
+  entries[20] = 40;
+  count = 32;
+  EXPECT_EQ(fat_extents(&fat12, 5, extents, &count, 0), FAT_CHAIN_RANGE);
+  EXPECT_EQ(count, 2);
+
+  entries[20] = 5;
+  count = 32;
+  EXPECT_EQ(fat_extents(&fat12, 5, extents, &count, 0), FAT_CHAIN_LOOP);
+
+  count = 32;
+  EXPECT_EQ(fat_extents(&fat12, 0, extents, &count, 0), FAT_CHAIN_RANGE);
+  EXPECT_EQ(count, 0);
+}
+
+HOST_BENCH(fat12_unpack_scalar, 256)
+{
+  while (iterations--) {
+    fat12_unpack_scalar(packed, scalar, ENTRIES);
+    BENCH_USE(scalar);
+  }
+}
+
+HOST_BENCH(fat12_unpack_ssse3, 256)
+{
+  while (iterations--) {
+    fat12_unpack_ssse3(packed, ssse3, ENTRIES);
+    BENCH_USE(ssse3);
+  }
+}
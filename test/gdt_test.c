@@ -0,0 +1,71 @@
+#include "test.h"
+#include <gdt.h>
+
+static uint32_t entry_base(gdt_t* entry)
+{
+  return (entry->base3 << 24) | (entry->base2 << 16) | entry->base1;
+}
+
+static uint32_t entry_limit(gdt_t* entry)
+{
+  return ((entry->flags & 0xF) << 16) | entry->limit1;
+}
+
+TEST(gdt_entry_layout)
+{
+  EXPECT_EQ(sizeof(gdt_t), 8);
+}
+
+TEST(gdt_create_entry_splits_base_and_limit)
+{
+  gdt_t entry;
+
+  gdt_create_entry(&entry, 0x12345678, 0xABCDE, GDT_KERNEL_DATA, GDT_FLAGS_32BIT);
+
+  EXPECT_EQ(entry_base(&entry), 0x12345678);
+  EXPECT_EQ(entry_limit(&entry), 0xABCDE);
+  EXPECT_EQ(entry.access_byte, GDT_KERNEL_DATA);
+  EXPECT_EQ(entry.flags >> 4, GDT_FLAGS_32BIT);
+}
+
+TEST(init_gdt_builds_flat_segments)
+{
+  gdtr_t* gdtr;
+  gdt_t* entries;
+  uint32_t k;
+  static uint8_t access[] = { 0, GDT_KERNEL_CODE, GDT_KERNEL_DATA, GDT_USER_CODE, GDT_USER_DATA };
+
+  init_gdt();
+
+  gdtr = mock_gdtr;
+  EXPECT(gdtr != 0);
+  EXPECT_EQ(gdtr->size, GDT_ENTRIES * sizeof(gdt_t) - 1);
+  EXPECT_EQ(mock_code_selector, KERNEL_CODE_SELECTOR);
+  EXPECT_EQ(mock_data_selector, KERNEL_DATA_SELECTOR);
+
+  entries = gdtr->entries;
+  for (k = GDT_KERNEL_CODE_INDEX; k <= GDT_USER_DATA_INDEX; k++) {
+    EXPECT_EQ(entry_base(&entries[k]), 0);
+    EXPECT_EQ(entry_limit(&entries[k]), 0xFFFFF);
+    EXPECT_EQ(entries[k].access_byte, access[k]);
+  }
+
+  /* SYSENTER/SYSEXIT derive the other selectors from the kernel code one */
+  EXPECT_EQ(KERNEL_DATA_SELECTOR, KERNEL_CODE_SELECTOR + 8);
+  EXPECT_EQ(USER_CODE_SELECTOR, (KERNEL_CODE_SELECTOR + 16) | 3);
+  EXPECT_EQ(USER_DATA_SELECTOR, (KERNEL_CODE_SELECTOR + 24) | 3);
+}
+
+TEST(gdt_set_entry_rewrites_one_descriptor)
+{
+  gdtr_t* gdtr;
+
+  init_gdt();
+  gdt_set_entry(GDT_TSS_INDEX, 0x00107000, 103, GDT_TSS, 0);
+
+  gdtr = mock_gdtr;
+  EXPECT_EQ(entry_base(&gdtr->entries[GDT_TSS_INDEX]), 0x00107000);
+  EXPECT_EQ(entry_limit(&gdtr->entries[GDT_TSS_INDEX]), 103);
+  EXPECT_EQ(gdtr->entries[GDT_TSS_INDEX].access_byte, GDT_TSS);
+  EXPECT_EQ(entry_base(&gdtr->entries[GDT_KERNEL_CODE_INDEX]), 0);
+}
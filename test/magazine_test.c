@@ -0,0 +1,315 @@
+#include <pthread.h>
+#include "test.h"
+#include <magazine.h>
+#include <spinlock.h>
+
+/* enough for every magazine to be full, and then some for each CPU */
+#define POOL (((CPUS * 2 + MAGAZINE_DEPOT) * MAGAZINE_ROUNDS) + CPUS * 64)
+
+/* objects handed out at once by each thread of the benchmarks */
+#define BENCH_BATCH 16
+
+/* the simplest layer behind: a stack of objects under one lock */
+typedef struct {
+  spinlock_t lock;
+  uint32_t count;
+  void* free[POOL];
+  uint32_t fills;
+  uint32_t drains;
+} pool_t;
+
+static uint64_t objects[POOL][8];
+static pool_t pool;
+static magazine_cache_t cache;
+
+static void pool_init()
+{
+  uint32_t k;
+
+  pool.lock.locked = 0;
+  pool.count = POOL;
+  pool.fills = 0;
+  pool.drains = 0;
+  for (k = 0; k < POOL; k++) {
+    pool.free[k] = objects[k];
+  }
+}
+
+static uint32_t pool_fill(void* context, void** out, uint32_t count)
+{
+  pool_t* pool = context;
+  uint32_t n;
+
+  spin_lock(&pool->lock);
+  for (n = 0; n < count && pool->count; n++) {
+    out[n] = pool->free[--pool->count];
+  }
+  pool->fills++;
+  spin_unlock(&pool->lock);
+  return n;
+}
+
+static void pool_drain(void* context, void** in, uint32_t count)
+{
+  pool_t* pool = context;
+  uint32_t k;
+
+  spin_lock(&pool->lock);
+  for (k = 0; k < count; k++) {
+    pool->free[pool->count++] = in[k];
+  }
+  pool->drains++;
+  spin_unlock(&pool->lock);
+}
+
+static void* pool_alloc()
+{
+  void* object = 0;
+
+  spin_lock(&pool.lock);
+  if (pool.count) {
+    object = pool.free[--pool.count];
+  }
+  spin_unlock(&pool.lock);
+  return object;
+}
+
+static void pool_free(void* object)
+{
+  spin_lock(&pool.lock);
+  pool.free[pool.count++] = object;
+  spin_unlock(&pool.lock);
+}
+
+static void reset()
+{
+  mock_cpu = 0;
+  pool_init();
+  magazine_init(&cache, pool_fill, pool_drain, &pool);
+}
+
+TEST(magazine_fills_a_magazine_at_a_time)
+{
+  uint32_t k;
+
+  reset();
+  EXPECT(magazine_alloc(&cache));
+  EXPECT_EQ(pool.fills, 1);
+  EXPECT_EQ(pool.count, POOL - MAGAZINE_ROUNDS);
+  EXPECT_EQ(magazine_cached(&cache), MAGAZINE_ROUNDS - 1);
+
+  for (k = 1; k < MAGAZINE_ROUNDS; k++) {
+    EXPECT(magazine_alloc(&cache));
+  }
+  EXPECT_EQ(pool.fills, 1);
+
+  EXPECT(magazine_alloc(&cache));
+  EXPECT_EQ(pool.fills, 2);
+}
+
+TEST(magazine_hands_out_every_object_once)
+{
+  static uint8_t seen[POOL];
+  uint32_t k, index, duplicates = 0;
+  uint64_t* object;
+
+  reset();
+  for (k = 0; k < POOL; k++) {
+    seen[k] = 0;
+  }
+
+  for (k = 0; k < POOL; k++) {
+    object = magazine_alloc(&cache);
+    if (!object) {
+      break;
+    }
+    index = (object - objects[0]) / 8;
+    duplicates += seen[index]++;
+  }
+  EXPECT_EQ(k, POOL);
+  EXPECT_EQ(duplicates, 0);
+
+  /* and says so once there are no more */
+  EXPECT(!magazine_alloc(&cache));
+}
+
+TEST(magazine_keeps_frees_until_the_depot_is_full)
+{
+  static void* out[POOL];
+  uint32_t k, count = (2 + MAGAZINE_DEPOT) * MAGAZINE_ROUNDS;
+
+  reset();
+  for (k = 0; k < count + MAGAZINE_ROUNDS; k++) {
+    out[k] = magazine_alloc(&cache);
+  }
+
+  /* two magazines on the CPU, and the depot's, before anything goes back */
+  for (k = 0; k < count; k++) {
+    magazine_free(&cache, out[k]);
+  }
+  EXPECT_EQ(pool.drains, 0);
+  EXPECT_EQ(magazine_cached(&cache), count);
+
+  /* then a whole magazine at a time */
+  magazine_free(&cache, out[count]);
+  EXPECT_EQ(pool.drains, 1);
+  EXPECT_EQ(pool.count, POOL - count);
+  EXPECT_EQ(magazine_cached(&cache), count - MAGAZINE_ROUNDS + 1);
+}
+
+TEST(magazine_cpus_trade_through_the_depot)
+{
+  static void* out[3 * MAGAZINE_ROUNDS];
+  uint32_t k, fills;
+
+  reset();
+  for (k = 0; k < 3 * MAGAZINE_ROUNDS; k++) {
+    out[k] = magazine_alloc(&cache);
+  }
+  for (k = 0; k < 3 * MAGAZINE_ROUNDS; k++) {
+    magazine_free(&cache, out[k]);
+  }
+
+  /* a full magazine went to the depot, where another CPU finds it */
+  fills = pool.fills;
+  mock_cpu = 1;
+  for (k = 0; k < MAGAZINE_ROUNDS; k++) {
+    EXPECT(magazine_alloc(&cache));
+  }
+  EXPECT_EQ(pool.fills, fills);
+  mock_cpu = 0;
+}
+
+/* each thread checks nobody else got its objects while it held them */
+static void* magazine_thread(void* arg)
+{
+  uint32_t cpu = (uintptr_t)arg, k, round, wrong = 0;
+  uint64_t* held[BENCH_BATCH];
+
+  mock_cpu = cpu;
+  for (round = 0; round < 2000; round++) {
+    for (k = 0; k < BENCH_BATCH; k++) {
+      held[k] = magazine_alloc(&cache);
+      held[k][0] = cpu;
+    }
+    for (k = 0; k < BENCH_BATCH; k++) {
+      wrong += held[k][0] != cpu;
+      magazine_free(&cache, held[k]);
+    }
+  }
+  return (void*)(uintptr_t)wrong;
+}
+
+TEST(magazine_threads_never_share_an_object)
+{
+  pthread_t threads[CPUS];
+  uint32_t k, wrong = 0;
+  void* result;
+
+  reset();
+  for (k = 0; k < CPUS; k++) {
+    pthread_create(&threads[k], 0, magazine_thread, (void*)(uintptr_t)k);
+  }
+  for (k = 0; k < CPUS; k++) {
+    pthread_join(threads[k], &result);
+    wrong += (uintptr_t)result;
+  }
+  mock_cpu = 0;
+
+  EXPECT_EQ(wrong, 0);
+  EXPECT_EQ(pool.count + magazine_cached(&cache), POOL);
+}
+
+/*
+  Scaling: "iterations" allocations and frees of BENCH_BATCH objects at
+  a time, split over 1 to CPUS threads, each standing in for a CPU.
+  With magazines, the time per operation should fall about as fast as
+  threads are added, as long as the host has the cores; through the
+  pool's lock alone, it does not.
+ */
+typedef struct {
+  uint32_t cpu;
+  uint32_t iterations;
+  uint32_t locked;
+} bench_thread_t;
+
+static void* bench_thread(void* arg)
+{
+  bench_thread_t* bench = arg;
+  void* held[BENCH_BATCH];
+  uint32_t k, n;
+
+  mock_cpu = bench->cpu;
+  for (n = 0; n < bench->iterations; n += BENCH_BATCH) {
+    for (k = 0; k < BENCH_BATCH; k++) {
+      held[k] = bench->locked ? pool_alloc() : magazine_alloc(&cache);
+    }
+    for (k = 0; k < BENCH_BATCH; k++) {
+      if (bench->locked) {
+        pool_free(held[k]);
+      } else {
+        magazine_free(&cache, held[k]);
+      }
+    }
+  }
+  return 0;
+}
+
+static void bench_threads(uint32_t count, uint32_t iterations, uint32_t locked)
+{
+  pthread_t threads[CPUS];
+  bench_thread_t benches[CPUS];
+  uint32_t k;
+
+  reset();
+  for (k = 0; k < count; k++) {
+    benches[k].cpu = k;
+    benches[k].iterations = iterations / count;
+    benches[k].locked = locked;
+    pthread_create(&threads[k], 0, bench_thread, &benches[k]);
+  }
+  for (k = 0; k < count; k++) {
+    pthread_join(threads[k], 0);
+  }
+  mock_cpu = 0;
+}
+
+HOST_BENCH(magazine_1_cpu, 1 << 18)
+{
+  bench_threads(1, iterations, 0);
+}
+
+HOST_BENCH(magazine_2_cpus, 1 << 18)
+{
+  bench_threads(2, iterations, 0);
+}
+
+HOST_BENCH(magazine_4_cpus, 1 << 18)
+{
+  bench_threads(4, iterations, 0);
+}
+
+HOST_BENCH(magazine_8_cpus, 1 << 18)
+{
+  bench_threads(8, iterations, 0);
+}
+
+HOST_BENCH(locked_1_cpu, 1 << 18)
+{
+  bench_threads(1, iterations, 1);
+}
+
+HOST_BENCH(locked_2_cpus, 1 << 18)
+{
+  bench_threads(2, iterations, 1);
+}
+
+HOST_BENCH(locked_4_cpus, 1 << 18)
+{
+  bench_threads(4, iterations, 1);
+}
+
+HOST_BENCH(locked_8_cpus, 1 << 18)
+{
+  bench_threads(8, iterations, 1);
+}
@@ -0,0 +1,203 @@
+#include "test.h"
+#include <memory.h>
+
+static uint8_t source[4096 + 64];
+static uint8_t destination[4096 + 64];
+
+static void fill(uint8_t* buf, uint32_t count, uint8_t seed)
+{
+  uint32_t k;
+  for (k = 0; k < count; k++) {
+    buf[k] = (uint8_t)(k * 31 + seed);
+  }
+}
+
+typedef uint8_t* (*memcpy_t)(uint8_t *dest, const uint8_t *src, uint32_t count);
+typedef uint8_t* (*memset_t)(uint8_t *dest, uint8_t val, uint32_t count);
+
+static void check_memcpy(memcpy_t copy)
+{
+  static uint32_t sizes[] = { 0, 1, 3, 4, 7, 64, 100, 4096 };
+  uint32_t i, k, offset;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (offset = 0; offset < 4; offset++) {
+      fill(source, sizeof(source), i);
+      fill(destination, sizeof(destination), 0xAA);
+
+      EXPECT(copy(destination + offset, source + 3, sizes[i]) == destination + offset);
+
+      for (k = 0; k < sizes[i]; k++) {
+        EXPECT_EQ(destination[offset + k], source[3 + k]);
+      }
+      /* the bytes around are untouched */
+      if (offset) {
+        EXPECT_EQ(destination[offset - 1], (uint8_t)((offset - 1) * 31 + 0xAA));
+      }
+      EXPECT_EQ(destination[offset + sizes[i]], (uint8_t)((offset + sizes[i]) * 31 + 0xAA));
+    }
+  }
+}
+
+static void check_memset(memset_t set)
+{
+  static uint32_t sizes[] = { 0, 1, 3, 4, 7, 100 };
+  uint32_t i, k;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    fill(destination, sizeof(destination), 1);
+    EXPECT(set(destination + 1, 0x5A, sizes[i]) == destination + 1);
+
+    EXPECT_EQ(destination[0], 1);
+    for (k = 1; k <= sizes[i]; k++) {
+      EXPECT_EQ(destination[k], 0x5A);
+    }
+    EXPECT_EQ(destination[sizes[i] + 1], (uint8_t)((sizes[i] + 1) * 31 + 1));
+  }
+}
+
+TEST(memcpy_copies_and_stays_in_bounds)
+{
+  check_memcpy(memcpy);
+}
+
+TEST(memset_fills_and_stays_in_bounds)
+{
+  check_memset(memset);
+}
+
+/* "rep movsb" and "rep stosb" work everywhere, ERMS only makes them fast */
+TEST(memcpy_memset_variants_agree)
+{
+  check_memcpy(memcpy_movsl);
+  check_memcpy(memcpy_erms);
+  check_memset(memset_stosl);
+  check_memset(memset_erms);
+}
+
+TEST(memcpyw_memsetw_work_in_words)
+{
+  uint16_t words[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  uint16_t copy[8] = { 0 };
+
+  memcpyw(copy, words, 7);
+  EXPECT_EQ(copy[6], 7);
+  EXPECT_EQ(copy[7], 0);
+
+  memsetw(copy, 0x0F20, 3);
+  EXPECT_EQ(copy[0], 0x0F20);
+  EXPECT_EQ(copy[2], 0x0F20);
+  EXPECT_EQ(copy[3], 4);
+}
+
+TEST(memcmp_finds_the_first_difference)
+{
+  uint32_t size, k;
+
+  for (k = 0; k < 64; k++) {
+    source[k] = 'a' + k % 26;
+  }
+  for (size = 0; size < 40; size++) {
+    memcpy(destination + 1, source, size);
+    EXPECT_EQ(memcmp(destination + 1, source, size), 0);
+
+    for (k = 0; k < size; k++) {
+      destination[1 + k] = source[k] + 1;
+      EXPECT(memcmp(destination + 1, source, size) > 0);
+      EXPECT(memcmp(source, destination + 1, size) < 0);
+      /* a later difference in the other direction does not count */
+      if (k + 1 < size) {
+        destination[2 + k] = source[k + 1] - 1;
+        EXPECT(memcmp(destination + 1, source, size) > 0);
+        destination[2 + k] = source[k + 1];
+      }
+      destination[1 + k] = source[k];
+    }
+  }
+
+  /* the bytes compare unsigned */
+  source[0] = 0x80;
+  destination[0] = 0x7F;
+  EXPECT(memcmp(source, destination, 1) > 0);
+}
+
+TEST(memchr_finds_the_first_match_within_count)
+{
+  uint32_t offset, k;
+
+  for (offset = 0; offset < 4; offset++) {
+    for (k = 0; k < 64; k++) {
+      source[k] = 'x';
+    }
+    EXPECT(memchr(source + offset, 'y', 40) == 0);
+
+    for (k = 0; k < 40; k++) {
+      source[offset + k] = 'y';
+      source[offset + k + 2] = 'y';
+      EXPECT(memchr(source + offset, 'y', 40) == source + offset + k);
+      EXPECT(memchr(source + offset, 'y', k) == 0);
+      source[offset + k] = 'x';
+      source[offset + k + 2] = 'x';
+    }
+  }
+  EXPECT(memchr(source, 0x80 | 'x', 64) == 0);
+}
+
+/* the 8.3 name of a FAT directory entry */
+HOST_BENCH(memcmp_11, 4096)
+{
+  static const uint8_t a[] = "KERNEL  BIN";
+  static const uint8_t b[] = "KERNEL  BIO";
+  while (iterations--) {
+    BENCH_USE(memcmp(a, b, 11));
+  }
+}
+
+HOST_BENCH(memchr_4096, 256)
+{
+  memset(source, 'x', 4096);
+  source[4095] = 'y';
+  while (iterations--) {
+    BENCH_USE(memchr(source, 'y', 4096));
+  }
+}
+
+HOST_BENCH(memcpy_64, 4096)
+{
+  while (iterations--) {
+    memcpy(destination, source, 64);
+    BENCH_USE(destination);
+  }
+}
+
+HOST_BENCH(memcpy_4096, 256)
+{
+  while (iterations--) {
+    memcpy(destination, source, 4096);
+    BENCH_USE(destination);
+  }
+}
+
+HOST_BENCH(memset_64, 4096)
+{
+  while (iterations--) {
+    memset(destination, 0, 64);
+    BENCH_USE(destination);
+  }
+}
+
+HOST_BENCH(memset_4096, 256)
+{
+  while (iterations--) {
+    memset(destination, 0, 4096);
+    BENCH_USE(destination);
+  }
+}
+
+HOST_BENCH(memsetw_screen, 256)
+{
+  while (iterations--) {
+    memsetw((uint16_t*)destination, 0x0F20, 80 * 25);
+    BENCH_USE(destination);
+  }
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "test.h"
+#include <screen.h>
+#include <fbcon.h>
+#include <gdt.h>
+#include <pmc.h>
+#include <frame.h>
+
+/*
+  Stand-ins for what the host build does not link: the framebuffer
+  console (we always run in text mode), the performance counters, port
+  I/O, the frame allocator and the assembly helpers.
+ */
+
+uint16_t* mock_vga;
+
+__thread uint32_t mock_cpu;
+
+uint32_t mock_frames;
+
+uint8_t mock_crtc[256];
+uint32_t mock_port_writes;
+static uint8_t crtc_index;
+
+void* mock_gdtr;
+uint16_t mock_code_selector;
+uint16_t mock_data_selector;
+
+void mock_init()
+{
+  /* screen.c writes to SCREEN_ADDR << 4, so put the buffer right there */
+  void* address = (void*)(SCREEN_ADDR << 4);
+
+  mock_vga = mmap(address, 4096, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if (mock_vga != address) {
+    perror("mapping the mock VGA buffer");
+    exit(2);
+  }
+}
+
+uint32_t init_fbcon()
+{
+  return 0;
+}
+
+uint32_t fbcon_cols()
+{
+  return SCREEN_COLS;
+}
+
+uint32_t fbcon_rows()
+{
+  return SCREEN_ROWS;
+}
+
+void fbcon_touch(uint32_t row)
+{
+}
+
+void fbcon_touch_all()
+{
+}
+
+void fbcon_scroll()
+{
+}
+
+void fbcon_flush(uint16_t* cells)
+{
+}
+
+void pmc_region_start(pmc_region_t* region)
+{
+}
+
+void pmc_region_stop(pmc_region_t* region)
+{
+}
+
+void set_gdt(gdtr_t* gdtr, uint16_t code, uint16_t data)
+{
+  mock_gdtr = gdtr;
+  mock_code_selector = code;
+  mock_data_selector = data;
+}
+
+/* only the CRT controller, behind its index and data ports */
+void outportb(uint16_t port, uint8_t data)
+{
+  mock_port_writes++;
+  if (port == 0x3D4) {
+    crtc_index = data;
+  } else if (port == 0x3D5) {
+    mock_crtc[crtc_index] = data;
+  }
+}
+
+uint8_t inportb(uint16_t port)
+{
+  return port == 0x3D5 ? mock_crtc[crtc_index] : 0xFF;
+}
+
+/* below 2 GB, so the address fits in 32 bits like a real frame's */
+uint32_t frame_alloc()
+{
+  void* page = mmap(0, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+  if (page == MAP_FAILED) {
+    return 0;
+  }
+  __atomic_add_fetch(&mock_frames, 1, __ATOMIC_RELAXED);
+  return (uint32_t)(uintptr_t)page;
+}
+
+/* there is only ever the one reference */
+void frame_unref(uint32_t frame)
+{
+  munmap((void*)(uintptr_t)frame, PAGE_SIZE);
+  __atomic_sub_fetch(&mock_frames, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,165 @@
+#include "test.h"
+#include <screen.h>
+
+#define BOTTOM (SCREEN_ROWS - 1)
+
+/*
+  screen.c has no way to move the cursor back up, so start every test
+  at the same place: after enough newlines, the cursor is at the start
+  of the last row.
+ */
+static void reset()
+{
+  uint32_t k;
+  for (k = 0; k < SCREEN_ROWS + 1; k++) {
+    printc('\n');
+  }
+  clear_screen();
+}
+
+static uint16_t cell(uint32_t row, uint32_t col)
+{
+  return mock_vga[row * SCREEN_COLS + col];
+}
+
+/* the characters of "row" from "col" on match "expected" */
+static int row_is(uint32_t row, uint32_t col, const char* expected)
+{
+  while (*expected) {
+    if ((cell(row, col++) & 0xFF) != (uint8_t)*expected++) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+TEST(printstr_writes_white_on_black_cells)
+{
+  reset();
+  printstr("Hi");
+
+  EXPECT_EQ(cell(BOTTOM, 0), (WHITE << 8) | 'H');
+  EXPECT_EQ(cell(BOTTOM, 1), (WHITE << 8) | 'i');
+  EXPECT_EQ(cell(BOTTOM, 2), (WHITE << 8) | ' ');
+}
+
+TEST(newline_scrolls_the_screen)
+{
+  reset();
+  printstr("one\ntwo");
+
+  EXPECT(row_is(BOTTOM - 1, 0, "one"));
+  EXPECT(row_is(BOTTOM, 0, "two"));
+}
+
+TEST(tab_backspace_and_wrapping)
+{
+  uint32_t k;
+
+  reset();
+  printstr("a\tb");
+  EXPECT(row_is(BOTTOM, 0, "a   b"));
+
+  reset();
+  printstr("ab\bc");
+  EXPECT(row_is(BOTTOM, 0, "ac "));
+
+  reset();
+  for (k = 0; k < SCREEN_COLS; k++) {
+    printc('x');
+  }
+  printc('y');
+  EXPECT_EQ(cell(BOTTOM - 1, SCREEN_COLS - 1) & 0xFF, 'x');
+  EXPECT_EQ(cell(BOTTOM, 0) & 0xFF, 'y');
+}
+
+TEST(print_calls_take_a_color)
+{
+  reset();
+  printstr_color("!", SCREEN_COLOR(LIGHT_RED, BLUE));
+  printstr("x");
+  screen_set_color(SCREEN_COLOR(BLACK, LIGHT_GREY));
+  printc('y');
+  screen_set_color(SCREEN_DEFAULT_COLOR);
+
+  EXPECT_EQ(cell(BOTTOM, 0), (((BLUE << 4) | LIGHT_RED) << 8) | '!');
+  EXPECT_EQ(cell(BOTTOM, 1), (WHITE << 8) | 'x');
+  EXPECT_EQ(cell(BOTTOM, 2), ((LIGHT_GREY << 4) << 8) | 'y');
+}
+
+/* the cell the CRT controller puts the cursor on */
+static uint32_t cursor()
+{
+  return (mock_crtc[0x0E] << 8) | mock_crtc[0x0F];
+}
+
+TEST(cursor_follows_once_per_call)
+{
+  uint32_t writes;
+
+  reset();
+  printstr("abc");
+  EXPECT_EQ(cursor(), BOTTOM * SCREEN_COLS + 3);
+
+  /* a whole string moves it once, with four port writes */
+  writes = mock_port_writes;
+  printstr("defgh");
+  EXPECT_EQ(mock_port_writes - writes, 4);
+  EXPECT_EQ(cursor(), BOTTOM * SCREEN_COLS + 8);
+
+  /* and not at all if it ends up where it was */
+  writes = mock_port_writes;
+  printstr("i\b");
+  EXPECT_EQ(mock_port_writes, writes);
+
+  /* a newline on the last row scrolls right away, leaving the cursor on the new row */
+  printstr("\n");
+  EXPECT_EQ(cursor(), BOTTOM * SCREEN_COLS);
+  EXPECT(row_is(BOTTOM - 1, 0, "abcdefgh "));
+}
+
+TEST(printk_prints_decimal)
+{
+  reset();
+  printk(0);
+  printc(' ');
+  printk(42);
+  printc(' ');
+  printk(4294967295u);
+
+  EXPECT(row_is(BOTTOM, 0, "0 42 4294967295 "));
+}
+
+TEST(printhl_prints_eight_hex_digits)
+{
+  reset();
+  printhl(0xDEADBEEF);
+  printc(' ');
+  printhw(0x1F);
+
+  EXPECT(row_is(BOTTOM, 0, "DEADBEEF 0000001F"));
+}
+
+TEST(number_of_digits_counts_decimal_digits)
+{
+  EXPECT_EQ(number_of_digits(0), 1);
+  EXPECT_EQ(number_of_digits(9), 1);
+  EXPECT_EQ(number_of_digits(10), 2);
+  EXPECT_EQ(number_of_digits(999999), 6);
+  EXPECT_EQ(number_of_digits(1000000000), 10);
+  EXPECT_EQ(number_of_digits(4294967295u), 10);
+}
+
+HOST_BENCH(printstr_line, 64)
+{
+  while (iterations--) {
+    printstr("The quick brown fox jumps over the lazy dog, then prints a newline.\n");
+  }
+}
+
+HOST_BENCH(printk, 1024)
+{
+  while (iterations--) {
+    printk(iterations);
+  }
+}
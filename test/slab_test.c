@@ -0,0 +1,85 @@
+#include "test.h"
+#include <slab.h>
+#include <memory.h>
+
+#define OBJECTS 1000
+
+static slab_cache_t cache;
+static void* objects[OBJECTS];
+
+TEST(slab_objects_are_aligned_and_apart)
+{
+  uint32_t k, wrong = 0;
+  uint8_t* object;
+
+  slab_cache_init(&cache, 60);
+  EXPECT_EQ(cache.size, 64);
+
+  for (k = 0; k < OBJECTS; k++) {
+    objects[k] = object = slab_alloc(&cache);
+    wrong += !object || ((uintptr_t)object & (SLAB_ALIGN - 1)) != 0;
+    /* on a page of the cache, and after its header */
+    wrong += ((uintptr_t)object & ~PAGE_MASK) + cache.size > PAGE_SIZE;
+    wrong += ((uintptr_t)object & ~PAGE_MASK) < 2 * sizeof(void*);
+  }
+  EXPECT_EQ(wrong, 0);
+
+  /* filled in full, they cannot overlap */
+  for (k = 0; k < OBJECTS; k++) {
+    memset(objects[k], k, cache.size);
+  }
+  for (k = 0; k < OBJECTS; k++) {
+    wrong += ((uint8_t*)objects[k])[0] != (uint8_t)k || ((uint8_t*)objects[k])[cache.size - 1] != (uint8_t)k;
+  }
+  EXPECT_EQ(wrong, 0);
+
+  for (k = 0; k < OBJECTS; k++) {
+    slab_free(&cache, objects[k]);
+  }
+}
+
+TEST(slab_refuses_sizes_that_do_not_fit)
+{
+  EXPECT(!slab_cache_init(&cache, 0));
+  EXPECT(!slab_alloc(&cache));
+  EXPECT(!slab_cache_init(&cache, SLAB_MAX + 1));
+  EXPECT(!slab_alloc(&cache));
+  EXPECT(slab_cache_init(&cache, SLAB_MAX));
+}
+
+TEST(slab_gives_pages_back)
+{
+  uint32_t k, frames = mock_frames, slabs;
+
+  slab_cache_init(&cache, 128);
+  for (k = 0; k < OBJECTS; k++) {
+    objects[k] = slab_alloc(&cache);
+  }
+  slabs = cache.slabs;
+  EXPECT_EQ(mock_frames - frames, slabs);
+  EXPECT(slabs * (PAGE_SIZE / 128) >= OBJECTS);
+
+  /* all but the slabs of what the magazines keep */
+  for (k = 0; k < OBJECTS; k++) {
+    slab_free(&cache, objects[k]);
+  }
+  EXPECT(cache.slabs < slabs);
+  EXPECT(cache.slabs <= magazine_cached(&cache.magazines));
+  EXPECT_EQ(mock_frames - frames, cache.slabs);
+}
+
+/* an object used and given back right away, from the magazine of this CPU */
+HOST_BENCH(slab_alloc_free, 1 << 16)
+{
+  static slab_cache_t bench_cache;
+  void* object;
+
+  if (!bench_cache.size) {
+    slab_cache_init(&bench_cache, 64);
+  }
+  while (iterations--) {
+    object = slab_alloc(&bench_cache);
+    BENCH_USE(object);
+    slab_free(&bench_cache, object);
+  }
+}
@@ -0,0 +1,202 @@
+#include <sys/mman.h>
+#include "test.h"
+#include <string.h>
+
+/* format() does not null-terminate, so compare against the count it returned */
+static int same(const char* buf, uint32_t n, const char* expected)
+{
+  uint32_t k;
+  for (k = 0; k < n; k++) {
+    if (!expected[k] || buf[k] != expected[k]) {
+      return 0;
+    }
+  }
+  return expected[n] == 0;
+}
+
+/* format() without the compiler's printf checks, for the odd cases */
+static uint32_t unchecked(char* buf, uint32_t size, const char* fmt, ...)
+{
+  va_list args;
+  uint32_t n;
+
+  va_start(args, fmt);
+  n = vformat(buf, size, fmt, args);
+  va_end(args);
+  return n;
+}
+
+TEST(strlen_counts_up_to_the_null_byte)
+{
+  EXPECT_EQ(strlen(""), 0);
+  EXPECT_EQ(strlen("a"), 1);
+  EXPECT_EQ(strlen("Welcome to David OS!"), 20);
+}
+
+TEST(strlen_variants_agree_at_every_alignment)
+{
+  static char buf[128] __attribute__((aligned(16)));
+  uint32_t start, length, k;
+
+  for (start = 0; start < 16; start++) {
+    for (length = 0; length < 64; length++) {
+      for (k = 0; k < sizeof(buf); k++) {
+        buf[k] = 'x';
+      }
+      buf[start + length] = 0;
+      EXPECT_EQ(strlen_words(buf + start), length);
+      if (__builtin_cpu_supports("sse2")) {
+        EXPECT_EQ(strlen_sse2(buf + start), length);
+      }
+    }
+  }
+}
+
+TEST(format_numbers)
+{
+  char buf[64];
+  uint32_t n;
+
+  n = format(buf, sizeof(buf), "%u %d %d %x", 0u, 42, -17, 0xBEEFu);
+  EXPECT(same(buf, n, "0 42 -17 beef"));
+
+  n = format(buf, sizeof(buf), "%u", 4294967295u);
+  EXPECT(same(buf, n, "4294967295"));
+
+  n = format(buf, sizeof(buf), "%d", (int32_t)0x80000000);
+  EXPECT(same(buf, n, "-2147483648"));
+
+  n = format(buf, sizeof(buf), "[%5u.%06u] %08x", 3u, 42u, 0x12u);
+  EXPECT(same(buf, n, "[    3.000042] 00000012"));
+}
+
+TEST(format_strings_and_characters)
+{
+  char buf[64];
+  uint32_t n;
+
+  n = format(buf, sizeof(buf), "%s=%c%%", "key", 'v');
+  EXPECT(same(buf, n, "key=v%"));
+
+  n = unchecked(buf, sizeof(buf), "%s", (char*)0);
+  EXPECT(same(buf, n, "(null)"));
+
+  /* a lone '%' at the end is dropped */
+  n = unchecked(buf, sizeof(buf), "100%");
+  EXPECT(same(buf, n, "100"));
+}
+
+TEST(format_never_writes_past_size)
+{
+  char buf[8] = { 0, 0, 0, 0, 0, 0, 0, 'x' };
+  uint32_t n;
+
+  n = format(buf, 7, "%s %u", "abcdef", 123456u);
+  EXPECT_EQ(n, 7);
+  EXPECT_EQ(buf[7], 'x');
+
+  n = format(buf, 3, "%08x", 1u);
+  EXPECT_EQ(n, 3);
+  EXPECT_EQ(buf[7], 'x');
+}
+
+/* the sign of a comparison, which is all strcmp() promises */
+static int32_t sign(int32_t value)
+{
+  return value < 0 ? -1 : value > 0;
+}
+
+TEST(strcmp_orders_like_unsigned_bytes)
+{
+  EXPECT_EQ(strcmp("", ""), 0);
+  EXPECT_EQ(strcmp("KERNEL  BIN", "KERNEL  BIN"), 0);
+  EXPECT_EQ(sign(strcmp("KERNEL  BIN", "KERNEL  BIO")), -1);
+  EXPECT_EQ(sign(strcmp("abc", "ab")), 1);
+  EXPECT_EQ(sign(strcmp("ab", "abc")), -1);
+  EXPECT_EQ(sign(strcmp("a\x80", "a\x7f")), 1);
+}
+
+TEST(strcmp_at_every_alignment)
+{
+  static char a[64] __attribute__((aligned(16)));
+  static char b[64] __attribute__((aligned(16)));
+  uint32_t x, y, k, length = 40;
+
+  for (x = 0; x < 8; x++) {
+    for (y = 0; y < 8; y++) {
+      for (k = 0; k < length; k++) {
+        a[x + k] = b[y + k] = 'a' + k % 26;
+      }
+      a[x + length] = b[y + length] = 0;
+      EXPECT_EQ(strcmp(a + x, b + y), 0);
+
+      /* a difference in every position of a word */
+      for (k = 0; k < 8; k++) {
+        b[y + 20 + k]++;
+        EXPECT_EQ(sign(strcmp(a + x, b + y)), -1);
+        EXPECT_EQ(sign(strcmp(b + y, a + x)), 1);
+        b[y + 20 + k]--;
+      }
+    }
+  }
+}
+
+/* strings whose null byte is the last one before a page that is not mapped */
+TEST(strlen_and_strcmp_stop_at_the_end_of_the_page)
+{
+  char* pages = mmap(0, 2 * 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  char* end = pages + 4096;
+  char copy[16] __attribute__((aligned(16)));
+  uint32_t length, k;
+  char* s;
+
+  EXPECT(pages != MAP_FAILED);
+  EXPECT_EQ(mprotect(end, 4096, PROT_NONE), 0);
+
+  for (length = 0; length < 8; length++) {
+    s = end - length - 1;
+    for (k = 0; k < length; k++) {
+      s[k] = copy[k] = 'a' + k;
+    }
+    s[length] = copy[length] = 0;
+
+    EXPECT_EQ(strlen_words(s), length);
+    EXPECT_EQ(strlen_sse2(s), length);
+    EXPECT_EQ(strcmp(copy, s), 0);
+    EXPECT_EQ(strcmp(s, copy), 0);
+  }
+  munmap(pages, 2 * 4096);
+}
+
+HOST_BENCH(strlen_64, 4096)
+{
+  static const char s[] = "The quick brown fox jumps over the lazy dog, and then some more.";
+  while (iterations--) {
+    BENCH_USE(strlen(s));
+  }
+}
+
+HOST_BENCH(strlen_sse2_64, 4096)
+{
+  static const char s[] = "The quick brown fox jumps over the lazy dog, and then some more.";
+  while (iterations--) {
+    BENCH_USE(strlen_sse2(s));
+  }
+}
+
+HOST_BENCH(strcmp_64, 4096)
+{
+  static const char a[] = "The quick brown fox jumps over the lazy dog, and then some more.";
+  static const char b[] = "The quick brown fox jumps over the lazy dog, and then some more!";
+  while (iterations--) {
+    BENCH_USE(strcmp(a, b));
+  }
+}
+
+HOST_BENCH(format_log_line, 1024)
+{
+  char buf[128];
+  while (iterations--) {
+    BENCH_USE(format(buf, sizeof(buf), "[%5u.%06u] %s: %u KB free", 12u, 345678u, "memory", 32256u));
+  }
+}
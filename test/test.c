@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "test.h"
+
+/* how "make hostbench" measures, like BENCH_WARMUP and BENCH_REPS in bench.h */
+#define WARMUP 16
+#define REPS 128
+
+/* start and end of the sections TEST() and HOST_BENCH() put entries in */
+extern test_t __start_tests[];
+extern test_t __stop_tests[];
+extern host_bench_t __start_benches[];
+extern host_bench_t __stop_benches[];
+
+static uint32_t failures;
+
+void test_expect(int passed, const char* file, int line, const char* what, uint64_t actual, uint64_t expected)
+{
+  if (passed) {
+    return;
+  }
+
+  failures++;
+  if (actual != expected) {
+    printf("  %s:%d: %s (got %llu/0x%llx, expected %llu/0x%llx)\n", file, line, what,
+      (unsigned long long)actual, (unsigned long long)actual,
+      (unsigned long long)expected, (unsigned long long)expected);
+  } else {
+    printf("  %s:%d: %s\n", file, line, what);
+  }
+}
+
+static uint64_t now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare(const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+static void run_tests()
+{
+  test_t* test;
+  uint32_t before, failed = 0, count = 0;
+
+  for (test = __start_tests; test < __stop_tests; test++) {
+    before = failures;
+    test->run();
+    count++;
+    if (failures != before) {
+      printf("FAIL %s\n", test->name);
+      failed++;
+    }
+  }
+
+  printf("%u tests, %u failed\n", count, failed);
+  if (failed) {
+    exit(1);
+  }
+}
+
+/* same output as bench_run_all() in the kernel, but in nanoseconds */
+static void run_benches()
+{
+  static uint64_t samples[REPS];
+  host_bench_t* bench;
+  uint64_t start;
+  uint32_t k;
+
+  printf("# name min median p99, nanoseconds per operation\n");
+  for (bench = __start_benches; bench < __stop_benches; bench++) {
+    for (k = 0; k < WARMUP; k++) {
+      bench->run(bench->iterations);
+    }
+    for (k = 0; k < REPS; k++) {
+      start = now();
+      bench->run(bench->iterations);
+      samples[k] = now() - start;
+    }
+
+    qsort(samples, REPS, sizeof(samples[0]), compare);
+    printf("bench %s %.1f %.1f %.1f\n", bench->name,
+      (double)samples[0] / bench->iterations,
+      (double)samples[REPS / 2] / bench->iterations,
+      (double)samples[(REPS * 99 + 99) / 100 - 1] / bench->iterations);
+  }
+}
+
+/* no strcmp(), the C library's string.h is hidden behind the kernel's */
+static int equal(const char* a, const char* b)
+{
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+int main(int argc, char** argv)
+{
+  mock_init();
+
+  if (argc > 1 && equal(argv[1], "--bench")) {
+    run_benches();
+  } else {
+    run_tests();
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef TEST_H
+#define TEST_H
+
+/*
+  A small harness to run kernel code on the host, see "make test".
+
+    TEST(strlen_empty)
+    {
+      EXPECT_EQ(strlen(""), 0);
+    }
+
+  registers a test; HOST_BENCH(name, iterations) registers a benchmark
+  the same way BENCH() does in the kernel (bench.h). Both are collected
+  by the linker through their own sections.
+ */
+
+#include <stdint.h>
+
+typedef struct {
+  const char* name;
+  void (*run)(void);
+} test_t;
+
+typedef struct {
+  const char* name;
+  void (*run)(uint32_t iterations);
+  uint32_t iterations;
+} host_bench_t;
+
+/* the explicit alignment keeps the compiler from padding entries apart */
+#define ENTRY(section_name) \
+  __attribute__((section(section_name), used, aligned(__alignof__(void*))))
+
+#define TEST(label) \
+  static void test_##label(void); \
+  static test_t test_entry_##label ENTRY("tests") = \
+    { #label, test_##label }; \
+  static void test_##label(void)
+
+#define HOST_BENCH(label, count) \
+  static void host_bench_##label(uint32_t iterations); \
+  static host_bench_t host_bench_entry_##label ENTRY("benches") = \
+    { #label, host_bench_##label, count }; \
+  static void host_bench_##label(uint32_t iterations)
+
+#define EXPECT(condition) \
+  test_expect((condition) != 0, __FILE__, __LINE__, #condition, 0, 0)
+
+#define EXPECT_EQ(actual, expected) \
+  test_expect((uint64_t)(actual) == (uint64_t)(expected), __FILE__, __LINE__, \
+    #actual " == " #expected, (uint64_t)(actual), (uint64_t)(expected))
+
+void test_expect(int passed, const char* file, int line, const char* what, uint64_t actual, uint64_t expected);
+
+/* keeps the compiler from optimizing away what a benchmark computes */
+#define BENCH_USE(value) __asm__ __volatile__ ("" : : "g" (value) : "memory")
+
+/* the CPU the calling thread stands in for, below CPUS; see cpu_id() */
+extern __thread uint32_t mock_cpu;
+
+/* frames handed out by the mocked frame_alloc(), and not given back */
+extern uint32_t mock_frames;
+
+/* the text mode screen, see mock.c */
+extern uint16_t* mock_vga;
+
+/* the CRT controller registers written with outportb(), and how many writes there were */
+extern uint8_t mock_crtc[256];
+extern uint32_t mock_port_writes;
+
+/* what the mocked set_gdt() got */
+extern void* mock_gdtr;
+extern uint16_t mock_code_selector;
+extern uint16_t mock_data_selector;
+
+/* maps the mock VGA buffer where screen.c expects the real one */
+void mock_init();
+
+#endif
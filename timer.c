@@ -0,0 +1,47 @@
+#include <timer.h>
+#include <pit.h>
+#include <pic.h>
+#include <io.h>
+#include <compiler.h>
+
+/* channel 0, low byte then high byte, mode 2 (rate generator) */
+#define PIT_COMMAND_CHANNEL0_RATE 0x34
+
+static volatile uint32_t ticks;
+
+static interrupt_handler_t handlers[TIMER_HANDLERS];
+static uint32_t handlers_used;
+
+HOT static void timer_interrupt(trap_frame_t* frame)
+{
+  uint32_t k;
+
+  ticks++;
+  for (k = 0; k < handlers_used; k++) {
+    handlers[k](frame);
+  }
+}
+
+void init_timer()
+{
+  uint16_t divisor = PIT_FREQUENCY / TIMER_HZ;
+
+  outportb(PIT_COMMAND, PIT_COMMAND_CHANNEL0_RATE);
+  outportb(PIT_CHANNEL0, divisor & 0xFF);
+  outportb(PIT_CHANNEL0, divisor >> 8);
+
+  interrupt_register(IRQ_VECTOR(IRQ_TIMER), timer_interrupt);
+  pic_unmask(IRQ_TIMER);
+}
+
+void timer_register(interrupt_handler_t handler)
+{
+  if (handlers_used < TIMER_HANDLERS) {
+    handlers[handlers_used++] = handler;
+  }
+}
+
+uint32_t timer_ticks()
+{
+  return ticks;
+}
@@ -0,0 +1,21 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <interrupt.h>
+
+/* ticks per second of PIT channel 0 */
+#define TIMER_HZ 1000
+
+/* at most this many handlers can hook the tick */
+#define TIMER_HANDLERS 4
+
+/* programs PIT channel 0 to TIMER_HZ and unmasks IRQ 0 */
+void init_timer();
+
+/* "handler" runs in the timer interrupt, with the interrupted state in "frame" */
+void timer_register(interrupt_handler_t handler);
+
+uint32_t timer_ticks();
+
+#endif
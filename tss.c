@@ -0,0 +1,62 @@
+#include <tss.h>
+#include <gdt.h>
+#include <memory.h>
+#include <idt.h>
+#include <interrupt.h>
+
+/* EFLAGS bit 1, which is always set */
+#define EFLAGS_RESERVED 0x2
+
+static tss_t tss;
+
+/*
+  A double fault often means the kernel stack is gone, so the CPU could
+  not push a trap frame for it: that would be a triple fault and a
+  reset. Instead, vector 8 switches tasks, to one with a stack of its
+  own; the state of the task that faulted is saved in "tss".
+ */
+static tss_t double_fault_tss;
+static uint8_t double_fault_stack[TSS_DOUBLE_FAULT_STACK] __attribute__((aligned(16)));
+
+void init_tss(uint32_t kernel_stack)
+{
+  memset((uint8_t*)&tss, 0, sizeof(tss));
+
+  tss.ss0 = KERNEL_DATA_SELECTOR;
+  tss.esp0 = kernel_stack;
+
+  /* the bitmap starts beyond the TSS limit, so there is none:
+    any port I/O from ring 3 raises #GP */
+  tss.iomap_base = sizeof(tss);
+
+  /* byte granular, so the limit is the size minus 1 */
+  gdt_set_entry(GDT_TSS_INDEX, (uint32_t)&tss, sizeof(tss) - 1, GDT_TSS, 0x0);
+  load_tss(TSS_SELECTOR);
+}
+
+void tss_set_kernel_stack(uint32_t kernel_stack)
+{
+  tss.esp0 = kernel_stack;
+}
+
+void tss_set_double_fault(void (*task)(void), uint32_t cr3)
+{
+  memset((uint8_t*)&double_fault_tss, 0, sizeof(double_fault_tss));
+
+  double_fault_tss.eip = (uint32_t)task;
+  double_fault_tss.esp = (uint32_t)double_fault_stack + sizeof(double_fault_stack);
+  double_fault_tss.eflags = EFLAGS_RESERVED; /* interrupts off */
+  double_fault_tss.cr3 = cr3;
+  double_fault_tss.cs = KERNEL_CODE_SELECTOR;
+  double_fault_tss.ss = double_fault_tss.ds = double_fault_tss.es = KERNEL_DATA_SELECTOR;
+  double_fault_tss.fs = double_fault_tss.gs = KERNEL_DATA_SELECTOR;
+  double_fault_tss.iomap_base = sizeof(double_fault_tss);
+
+  gdt_set_entry(GDT_DOUBLE_FAULT_TSS_INDEX, (uint32_t)&double_fault_tss, sizeof(double_fault_tss) - 1, GDT_TSS, 0x0);
+  idt_set_task_gate(EXCEPTION_DOUBLE_FAULT, DOUBLE_FAULT_TSS_SELECTOR);
+}
+
+const tss_t* tss_interrupted()
+{
+  return &tss;
+}
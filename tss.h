@@ -0,0 +1,75 @@
+#ifndef TSS_H
+#define TSS_H
+
+#include <stdint.h>
+
+/*
+  The Task State Segment. We do not use hardware task switching, so
+  the only fields the CPU looks at are ss0:esp0, the stack it switches
+  to when an interrupt or "int n" brings it from ring 3 to ring 0,
+  and iomap_base. The exception is the double fault handler, which
+  runs as a task of its own, see tss_set_double_fault().
+ */
+typedef struct {
+  uint16_t link;
+  uint16_t reserved0;
+  uint32_t esp0;
+  uint16_t ss0;
+  uint16_t reserved1;
+  uint32_t esp1;
+  uint16_t ss1;
+  uint16_t reserved2;
+  uint32_t esp2;
+  uint16_t ss2;
+  uint16_t reserved3;
+  uint32_t cr3;
+  uint32_t eip;
+  uint32_t eflags;
+  uint32_t eax;
+  uint32_t ecx;
+  uint32_t edx;
+  uint32_t ebx;
+  uint32_t esp;
+  uint32_t ebp;
+  uint32_t esi;
+  uint32_t edi;
+  uint16_t es;
+  uint16_t reserved4;
+  uint16_t cs;
+  uint16_t reserved5;
+  uint16_t ss;
+  uint16_t reserved6;
+  uint16_t ds;
+  uint16_t reserved7;
+  uint16_t fs;
+  uint16_t reserved8;
+  uint16_t gs;
+  uint16_t reserved9;
+  uint16_t ldt;
+  uint16_t reserved10;
+  uint16_t trap;
+  uint16_t iomap_base; /* offset of the I/O permission bitmap */
+} __attribute__((packed)) tss_t;
+
+#define TSS_DOUBLE_FAULT_STACK 4096
+
+/* defined in kernel_helpers.s */
+extern void load_tss(uint16_t selector);
+
+/* installs the TSS into the GDT and loads the task register */
+void init_tss(uint32_t kernel_stack);
+
+/* sets the stack used when entering ring 0 from ring 3 */
+void tss_set_kernel_stack(uint32_t kernel_stack);
+
+/*
+  Makes double faults switch to a task of their own, starting at "task"
+  on a fresh stack with the error code pushed, and with "cr3" for its
+  page directory, which has to map the kernel.
+ */
+void tss_set_double_fault(void (*task)(void), uint32_t cr3);
+
+/* the registers of the task the double fault task switched away from */
+const tss_t* tss_interrupted();
+
+#endif
@@ -0,0 +1,190 @@
+# Transitions between ring 0 and ring 3, and the system call entry points
+.text
+
+.equ KERNEL_DATA_SELECTOR, 0x10
+.equ USER_CODE_SELECTOR,   0x1b
+.equ USER_DATA_SELECTOR,   0x23
+
+# Interrupts enabled; bit 1 is reserved and always set
+.equ USER_EFLAGS,          0x202
+
+.equ RING0_STACK_SIZE,     8192
+
+# uint32_t user_enter(uint32_t eip, uint32_t esp, uint32_t eax, uint32_t edx)
+# Drops to ring 3 at "eip" with "esp", "eax" and "edx" loaded. Returns
+# when the user code leaves through user_exit(), with the code in %eax.
+# "edx" is the high half of a 64-bit system call result, for processes
+# resuming in one of the stubs below; it goes in %esi as well, where
+# syscall_sysenter expects it. The caller's eflags, IF included, are
+# back as they were on return: int $0x80 and sysenter leave ring 3 with
+# interrupts off.
+.globl user_enter
+user_enter:
+	push %ebp
+	mov %esp, %ebp
+	push %ebx
+	push %esi
+	push %edi
+	pushfl
+
+	# where user_exit() picks us up again
+	mov %esp, user_return_esp
+
+	mov 8(%ebp), %ecx
+	mov 12(%ebp), %edx
+
+	mov $USER_DATA_SELECTOR, %eax
+	mov %ax, %ds
+	mov %ax, %es
+	mov %ax, %fs
+	mov %ax, %gs
+
+	# build the frame that iret expects when returning to a lower privilege
+	push $USER_DATA_SELECTOR # ss
+	push %edx                # esp
+	push $USER_EFLAGS        # eflags
+	push $USER_CODE_SELECTOR # cs
+	push %ecx                # eip
+
+	mov 16(%ebp), %eax
+	mov 20(%ebp), %edx
+	mov %edx, %esi
+	iret
+
+# void user_exit(uint32_t code)
+# Abandons the ring 0 stack of the current system call and returns
+# from user_enter() with "code".
+.globl user_exit
+user_exit:
+	mov 4(%esp), %eax
+
+	mov $KERNEL_DATA_SELECTOR, %ecx
+	mov %cx, %ds
+	mov %cx, %es
+	mov %cx, %fs
+	mov %cx, %gs
+
+	mov user_return_esp, %esp
+	popfl
+	pop %edi
+	pop %esi
+	pop %ebx
+	pop %ebp
+	ret
+
+# SYSENTER lands here with %cs, %ss and %esp loaded from the
+# IA32_SYSENTER_* MSRs. The user stub passes its return address in %edx
+# and its stack pointer in %ecx, and the arguments in %eax, %ebx, %esi
+# and %edi. The data segments are flat, so there is no need to reload them.
+# SYSEXIT takes %edx for the return address, so the high half of the
+# result goes back in %esi, which the user stub restores anyway.
+.globl sysenter_entry
+sysenter_entry:
+	# uint32_t syscall_dispatch(number, a1, a2, a3, user_eip, user_esp)
+	push %ecx
+	push %edx
+	push %edi
+	push %esi
+	push %ebx
+	push %eax
+	call syscall_dispatch
+	mov %edx, %esi
+	add $16, %esp
+
+	# SYSEXIT returns to %edx with %esp = %ecx; SYSENTER cleared IF,
+	# and "sti" only takes effect after the next instruction, so no
+	# interrupt can arrive while still on the kernel stack in ring 3
+	pop %edx
+	pop %ecx
+	sti
+	sysexit
+
+# The "int $0x80" fallback; same register convention, but the CPU
+# saves the return state on the TSS stack for us.
+.globl int80_entry
+int80_entry:
+	# user %esp and %eip from the frame the CPU pushed
+	push 12(%esp)
+	push 4(%esp)
+	push %edi
+	push %esi
+	push %ebx
+	push %eax
+	call syscall_dispatch
+	add $24, %esp
+	iret
+
+#
+# User side stubs, these run in ring 3
+#
+.section .user.text, "ax"
+
+# uint64_t syscall_sysenter(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3)
+.globl syscall_sysenter
+syscall_sysenter:
+	push %ebp
+	mov %esp, %ebp
+	push %ebx
+	push %esi
+	push %edi
+
+	mov 8(%ebp), %eax
+	mov 12(%ebp), %ebx
+	mov 16(%ebp), %esi
+	mov 20(%ebp), %edi
+
+	mov %esp, %ecx
+	mov $sysenter_return, %edx
+	sysenter
+sysenter_return:
+	mov %esi, %edx
+	pop %edi
+	pop %esi
+	pop %ebx
+	pop %ebp
+	ret
+
+# uint64_t syscall_int80(uint32_t number, uint32_t a1, uint32_t a2, uint32_t a3)
+.globl syscall_int80
+syscall_int80:
+	push %ebp
+	mov %esp, %ebp
+	push %ebx
+	push %esi
+	push %edi
+
+	mov 8(%ebp), %eax
+	mov 12(%ebp), %ebx
+	mov 16(%ebp), %esi
+	mov 20(%ebp), %edi
+
+	int $0x80
+
+	pop %edi
+	pop %esi
+	pop %ebx
+	pop %ebp
+	ret
+
+# The return address of every process entry point: hands the return
+# value of the entry point to SYS_EXIT (number 0)
+.globl user_return
+user_return:
+	mov %eax, %ebx
+	xor %eax, %eax
+	int $0x80
+1:
+	jmp 1b
+
+.bss
+.align 4
+user_return_esp:
+	.long 0
+
+# the stack the CPU switches to when entering ring 0 from ring 3
+.align 16
+.globl ring0_stack
+ring0_stack:
+	.skip RING0_STACK_SIZE
+.globl ring0_stack_top
+ring0_stack_top:
@@ -0,0 +1,18 @@
+#!/bin/sh
+#
+# Compares two bench.txt files from "make bench", by median:
+#
+#   sh util/bench_compare.sh old_bench.txt bench.txt
+#
+# Prints the old and new median of every benchmark in both, and the
+# change in percent; a positive change means slower.
+
+awk '
+FNR == NR && $1 == "bench" {
+  old[$2] = $4
+  next
+}
+$1 == "bench" && ($2 in old) {
+  change = old[$2] ? ($4 - old[$2]) * 100 / old[$2] : 0
+  printf "%-24s %10d %10d %+7.1f%%\n", $2, old[$2], $4, change
+}' "$1" "$2"
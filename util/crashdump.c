@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <crash.h>
+
+/*
+  Decodes the crash dumps the kernel writes to the serial port when it
+  dies (see crash.h), out of a capture of the port:
+
+    qemu-system-i386 ... -serial file:serial.log
+    crashdump serial.log [kernel.out]
+
+  Every dump found is checked against its checksum and printed with its
+  registers, backtrace and the top of the stack. Given the kernel it
+  came from, addresses are shown as function+offset, including the
+  stack words that point into code, which are likely return addresses
+  the frame pointer chain missed.
+
+  Exits with 1 if there was no valid dump.
+ */
+
+typedef struct {
+	uint32_t address;
+	const char* name;
+} symbol_t;
+
+static symbol_t* symbols;
+static uint32_t symbol_count;
+
+static const char* mnemonics[EXCEPTIONS] = {
+	"#DE", "#DB", "NMI", "#BP", "#OF", "#BR", "#UD", "#NM",
+	"#DF", "", "#TS", "#NP", "#SS", "#GP", "#PF", "",
+	"#MF", "#AC", "#MC", "#XM", "#VE", "#CP", "", "",
+	"", "", "", "", "#HV", "#VC", "#SX", ""
+};
+
+static const uint8_t* map_file(const char* path, size_t* size) {
+	struct stat st;
+	const uint8_t* data;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		return 0;
+	}
+	*size = st.st_size;
+	data = st.st_size ? mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "%s: cannot map an empty file\n", path);
+		return 0;
+	}
+	return data;
+}
+
+static int compare_symbols(const void* a, const void* b) {
+	uint32_t x = ((const symbol_t*)a)->address, y = ((const symbol_t*)b)->address;
+	return x < y ? -1 : x > y;
+}
+
+/* the code symbols of a 32-bit ELF file, like util/symbols.sh takes them */
+static int load_symbols(const char* path) {
+	const Elf32_Ehdr* header;
+	const Elf32_Shdr* sections;
+	const Elf32_Sym* table;
+	const char* names;
+	size_t size;
+	uint32_t k, count, s;
+	const uint8_t* elf = map_file(path, &size);
+
+	if (!elf) {
+		return 0;
+	}
+	header = (const Elf32_Ehdr*)elf;
+	if (size < sizeof(*header) || memcmp(header->e_ident, ELFMAG, SELFMAG) ||
+			header->e_ident[EI_CLASS] != ELFCLASS32 ||
+			header->e_shoff + (size_t)header->e_shnum * sizeof(Elf32_Shdr) > size) {
+		fprintf(stderr, "%s: not a 32-bit ELF file\n", path);
+		return 0;
+	}
+	sections = (const Elf32_Shdr*)(elf + header->e_shoff);
+
+	for (s = 0; s < header->e_shnum; s++) {
+		if (sections[s].sh_type == SHT_SYMTAB) {
+			break;
+		}
+	}
+	if (s == header->e_shnum) {
+		fprintf(stderr, "%s: no symbol table\n", path);
+		return 0;
+	}
+
+	table = (const Elf32_Sym*)(elf + sections[s].sh_offset);
+	names = (const char*)(elf + sections[sections[s].sh_link].sh_offset);
+	count = sections[s].sh_size / sizeof(Elf32_Sym);
+
+	symbols = calloc(count, sizeof(symbol_t));
+	for (k = 0; k < count; k++) {
+		const char* name = names + table[k].st_name;
+		uint32_t type = ELF32_ST_TYPE(table[k].st_info);
+
+		if (table[k].st_shndx == SHN_UNDEF || table[k].st_shndx >= header->e_shnum ||
+				!(sections[table[k].st_shndx].sh_flags & SHF_EXECINSTR) ||
+				(type != STT_FUNC && type != STT_NOTYPE) || name[0] == '_' || name[0] == '.' || !name[0]) {
+			continue;
+		}
+		symbols[symbol_count].address = table[k].st_value;
+		symbols[symbol_count].name = name;
+		symbol_count++;
+	}
+	qsort(symbols, symbol_count, sizeof(symbol_t), compare_symbols);
+	return 1;
+}
+
+/* the function "address" is in, or 0 */
+static const symbol_t* lookup(uint32_t address) {
+	uint32_t low = 0, high = symbol_count, middle;
+
+	if (!symbol_count || address < symbols[0].address) {
+		return 0;
+	}
+	while (high - low > 1) {
+		middle = low + (high - low) / 2;
+		if (symbols[middle].address <= address) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	/* past the last symbol is not code we know of */
+	return low + 1 < symbol_count || address - symbols[low].address < 0x1000 ? &symbols[low] : 0;
+}
+
+static void output_address(uint32_t address) {
+	const symbol_t* symbol = lookup(address);
+
+	printf("%08x", address);
+	if (symbol) {
+		printf(" %s+0x%x", symbol->name, address - symbol->address);
+	}
+}
+
+static int valid(const crash_dump_t* dump) {
+	const uint32_t* words = (const uint32_t*)dump;
+	uint32_t sum = 0, k;
+
+	if (dump->version != CRASH_VERSION || dump->size != sizeof(crash_dump_t)) {
+		return 0;
+	}
+	for (k = 0; k < offsetof(crash_dump_t, checksum) / 4; k++) {
+		sum += words[k];
+	}
+	return sum == dump->checksum && dump->depth <= CRASH_FRAMES && dump->stack_count <= CRASH_STACK;
+}
+
+static void output_dump(const crash_dump_t* dump) {
+	const trap_frame_t* frame = &dump->frame;
+	uint32_t k;
+
+	printf("%s vector %u, error 0x%x, at %04x:", frame->vector < EXCEPTIONS ? mnemonics[frame->vector] : "",
+		frame->vector, frame->error_code, frame->cs);
+	output_address(frame->eip);
+	printf("%s\n", (frame->cs & 3) == 3 ? " (user mode)" : "");
+
+	printf("eax %08x ebx %08x ecx %08x edx %08x\n", frame->eax, frame->ebx, frame->ecx, frame->edx);
+	printf("esi %08x edi %08x ebp %08x esp %08x\n", frame->esi, frame->edi, frame->ebp, dump->esp);
+	printf("cs %04x ds %04x es %04x fs %04x gs %04x eflags %08x\n",
+		frame->cs, frame->ds, frame->es, frame->fs, frame->gs, frame->eflags);
+	printf("cr0 %08x cr2 %08x cr3 %08x cr4 %08x\n", dump->cr0, dump->cr2, dump->cr3, dump->cr4);
+	printf("tsc %llu\n", (unsigned long long)dump->timestamp);
+
+	printf("backtrace:\n");
+	for (k = 0; k < dump->depth; k++) {
+		printf("  ");
+		output_address(dump->backtrace[k]);
+		printf("\n");
+	}
+
+	printf("stack:\n");
+	for (k = 0; k < dump->stack_count; k++) {
+		printf("  %08x: ", dump->esp + k * 4);
+		output_address(dump->stack[k]);
+		printf("\n");
+	}
+}
+
+int main(int argc, char** argv) {
+	const uint8_t* capture;
+	crash_dump_t dump;
+	uint32_t magic = CRASH_MAGIC, found = 0;
+	size_t size, k;
+
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "Usage: %s SERIAL_CAPTURE [KERNEL]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc == 3 && !load_symbols(argv[2])) {
+		return EXIT_FAILURE;
+	}
+	capture = map_file(argv[1], &size);
+	if (!capture) {
+		return EXIT_FAILURE;
+	}
+
+	/* the dump is copied out, as it may start anywhere in the capture */
+	for (k = 0; k + sizeof(dump) <= size; k++) {
+		if (memcmp(capture + k, &magic, sizeof(magic))) {
+			continue;
+		}
+		memcpy(&dump, capture + k, sizeof(dump));
+		if (!valid(&dump)) {
+			printf("ignoring a damaged dump at offset %zu\n", k);
+			continue;
+		}
+
+		printf("%scrash dump at offset %zu\n", found ? "\n" : "", k);
+		output_dump(&dump);
+		found++;
+		k += sizeof(dump) - 1;
+	}
+
+	if (!found) {
+		fprintf(stderr, "%s: no crash dump\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Compresses a flat kernel binary for stage2:
+
+    lz4pack kernel.bin kernel.lz4
+
+  The output is a 12 byte header followed by one LZ4 block:
+
+    "KLZ4"                       magic, see KERNEL_LZ4_MAGIC in stage2.s
+    uint32_t compressed_size     of the block that follows
+    uint32_t size                of the kernel once decompressed
+
+  An LZ4 block is a series of sequences: a token byte whose high nibble
+  is the number of literals and low nibble the match length minus 4 (15
+  meaning "more length bytes follow, each added, until one is not 255"),
+  the literals, a 16 bit little endian offset back into the output and
+  the extra match length bytes. The last sequence has literals only.
+  Compression is greedy with a single hash probe; the kernel is small and
+  decompression speed is what matters.
+ */
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define LAST_LITERALS 5 /* the block format wants the last 5 bytes as literals */
+#define MATCH_LIMIT 12 /* and no match starting in the last 12 */
+
+#define HASH_BITS 14
+
+static uint32_t read32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write32(uint8_t* p, uint32_t value)
+{
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+}
+
+static uint32_t hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* writes the 15+ part of a length */
+static uint8_t* write_length(uint8_t* out, uint32_t length)
+{
+	for (length -= 15; length >= 255; length -= 255) {
+		*out++ = 255;
+	}
+	*out++ = length;
+	return out;
+}
+
+static uint8_t* write_sequence(uint8_t* out, const uint8_t* literals, uint32_t literal_length,
+		uint32_t offset, uint32_t match_length)
+{
+	uint8_t* token = out++;
+
+	*token = (literal_length < 15 ? literal_length : 15) << 4;
+	if (literal_length >= 15) {
+		out = write_length(out, literal_length);
+	}
+	memcpy(out, literals, literal_length);
+	out += literal_length;
+
+	if (!match_length) {
+		return out;
+	}
+
+	*out++ = offset;
+	*out++ = offset >> 8;
+	match_length -= MIN_MATCH;
+	*token |= match_length < 15 ? match_length : 15;
+	if (match_length >= 15) {
+		out = write_length(out, match_length);
+	}
+	return out;
+}
+
+/* returns the size of the block written to "out" */
+static uint32_t compress(const uint8_t* in, uint32_t size, uint8_t* out)
+{
+	static uint32_t table[1 << HASH_BITS]; /* position + 1 of the last sequence with a hash */
+	const uint8_t* anchor = in; /* start of the pending literals */
+	uint8_t* start = out;
+	uint32_t k = 0, h, candidate, length;
+
+	while (size >= MATCH_LIMIT && k + MATCH_LIMIT <= size) {
+		h = hash(read32(in + k));
+		candidate = table[h];
+		table[h] = k + 1;
+
+		if (!candidate-- || k - candidate > MAX_OFFSET || read32(in + candidate) != read32(in + k)) {
+			k++;
+			continue;
+		}
+
+		length = MIN_MATCH;
+		while (k + length < size - LAST_LITERALS && in[candidate + length] == in[k + length]) {
+			length++;
+		}
+
+		out = write_sequence(out, anchor, in + k - anchor, k - candidate, length);
+		k += length;
+		anchor = in + k;
+	}
+
+	out = write_sequence(out, anchor, in + size - anchor, 0, 0);
+	return out - start;
+}
+
+int main(int argc, char** argv)
+{
+	FILE* f;
+	uint8_t* in;
+	uint8_t* out;
+	long size;
+	uint32_t compressed;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s kernel.bin kernel.lz4\n", argv[0]);
+		return 1;
+	}
+
+	f = fopen(argv[1], "rb");
+	if (!f) {
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	/* incompressible data grows by one byte per 255, plus a token */
+	in = malloc(size);
+	out = malloc(12 + size + size / 255 + 16);
+	if (!in || !out || fread(in, 1, size, f) != (size_t)size) {
+		fprintf(stderr, "%s: could not read\n", argv[1]);
+		return 1;
+	}
+	fclose(f);
+
+	compressed = compress(in, size, out + 12);
+	memcpy(out, "KLZ4", 4);
+	write32(out + 4, compressed);
+	write32(out + 8, size);
+
+	f = fopen(argv[2], "wb");
+	if (!f || fwrite(out, 1, 12 + compressed, f) != 12 + compressed || fclose(f)) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	printf("%s: %ld bytes, %u compressed (%u%%)\n", argv[2], size, 12 + compressed,
+		(unsigned)((12 + compressed) * 100 / (size ? size : 1)));
+	return 0;
+}
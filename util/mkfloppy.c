@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Builds a bootable 1.44 MB FAT12 floppy image from scratch:
+
+    mkfloppy my_os.img bootblock.bin SECOND.BIN=stage2.bin KERNEL.BIN=kernel.bin
+
+  The boot sector is bootblock.bin with the BIOS parameter block of
+  bpb.s written over it, and every file goes into the root directory in
+  one run of consecutive clusters, in the order given, so a loader may
+  just as well read it sector after sector. The whole image is put
+  together in memory and written at once. Timestamps are fixed, so the
+  same inputs always give the same image.
+ */
+
+/* the geometry in bpb.s */
+#define SECTOR_SIZE 512
+#define SECTORS_PER_CLUSTER 1
+#define RESERVED_SECTORS 1
+#define FATS 2
+#define ROOT_ENTRIES 224
+#define TOTAL_SECTORS 2880
+#define MEDIA_DESCRIPTOR 0xF0
+#define SECTORS_PER_FAT 9
+#define SECTORS_PER_TRACK 18
+#define HEADS 2
+
+#define IMAGE_SIZE (TOTAL_SECTORS * SECTOR_SIZE)
+#define ROOT_SECTOR (RESERVED_SECTORS + FATS * SECTORS_PER_FAT)
+#define DATA_SECTOR (ROOT_SECTOR + ROOT_ENTRIES * 32 / SECTOR_SIZE)
+#define CLUSTER_SIZE (SECTORS_PER_CLUSTER * SECTOR_SIZE)
+#define CLUSTERS ((TOTAL_SECTORS - DATA_SECTOR) / SECTORS_PER_CLUSTER)
+
+#define FAT12_END 0xFFF
+
+#define ATTRIBUTE_ARCHIVE 0x20
+#define DATE_1980_01_01 ((0 << 9) | (1 << 5) | 1)
+
+static uint8_t image[IMAGE_SIZE];
+
+static void write16(uint8_t* p, uint16_t value)
+{
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+static void write32(uint8_t* p, uint32_t value)
+{
+	write16(p, value);
+	write16(p + 2, value >> 16);
+}
+
+/* the BPB 2.0, 3.31 and extended fields, from offset 11 of the boot sector */
+static void write_bpb(uint8_t* sector)
+{
+	memcpy(sector + 3, "MSWIN4.1", 8);
+	write16(sector + 11, SECTOR_SIZE);
+	sector[13] = SECTORS_PER_CLUSTER;
+	write16(sector + 14, RESERVED_SECTORS);
+	sector[16] = FATS;
+	write16(sector + 17, ROOT_ENTRIES);
+	write16(sector + 19, TOTAL_SECTORS);
+	sector[21] = MEDIA_DESCRIPTOR;
+	write16(sector + 22, SECTORS_PER_FAT);
+	write16(sector + 24, SECTORS_PER_TRACK);
+	write16(sector + 26, HEADS);
+	write32(sector + 28, 0); /* hidden sectors */
+	write32(sector + 32, 0); /* total sectors, when the 16 bit field is too small */
+	sector[36] = 0; /* drive number */
+	sector[37] = 0;
+	sector[38] = 0x29; /* extended boot signature */
+	memcpy(sector + 39, "FLOP", 4);
+	memcpy(sector + 43, "DOS FLOPPY ", 11);
+	memcpy(sector + 54, "FAT12   ", 8);
+}
+
+/* two 12 bit entries share three bytes, see the README */
+static void fat12_set(uint8_t* fat, uint32_t cluster, uint16_t value)
+{
+	uint8_t* p = fat + cluster * 3 / 2;
+
+	if (cluster & 1) {
+		p[0] = (p[0] & 0x0F) | (value << 4);
+		p[1] = value >> 4;
+	} else {
+		p[0] = value;
+		p[1] = (p[1] & 0xF0) | ((value >> 8) & 0x0F);
+	}
+}
+
+/* "KERNEL.BIN" as it is stored in a directory entry, "KERNEL  BIN" */
+static int short_name(const char* name, uint8_t out[11])
+{
+	const char* dot = strchr(name, '.');
+	uint32_t length = dot ? (uint32_t)(dot - name) : strlen(name);
+	uint32_t k, extension = dot ? strlen(dot + 1) : 0;
+
+	if (!length || length > 8 || extension > 3) {
+		return 0;
+	}
+
+	memset(out, ' ', 11);
+	for (k = 0; k < length; k++) {
+		out[k] = name[k] >= 'a' && name[k] <= 'z' ? name[k] - 'a' + 'A' : name[k];
+	}
+	for (k = 0; k < extension; k++) {
+		out[8 + k] = dot[1 + k] >= 'a' && dot[1 + k] <= 'z' ? dot[1 + k] - 'a' + 'A' : dot[1 + k];
+	}
+	return 1;
+}
+
+/* reads a whole file into "buf"; returns its size, or -1 if it does not fit */
+static long read_file(const char* path, uint8_t* buf, long size)
+{
+	FILE* f = fopen(path, "rb");
+	long n;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	n = fread(buf, 1, size, f);
+	if (n == size && fgetc(f) != EOF) {
+		fprintf(stderr, "%s: too large\n", path);
+		n = -1;
+	}
+	fclose(f);
+	return n;
+}
+
+int main(int argc, char** argv)
+{
+	uint8_t* root = image + ROOT_SECTOR * SECTOR_SIZE;
+	uint8_t* entry;
+	uint32_t cluster = 2, clusters, k;
+	char* path;
+	long size;
+	int i;
+	FILE* f;
+
+	if (argc < 3 || argc - 3 > ROOT_ENTRIES) {
+		fprintf(stderr, "usage: %s image bootblock.bin [NAME.EXT=file ...]\n", argv[0]);
+		return 1;
+	}
+
+	size = read_file(argv[2], image, SECTOR_SIZE);
+	if (size < 0) {
+		return 1;
+	}
+	if (size != SECTOR_SIZE || image[510] != 0x55 || image[511] != 0xAA) {
+		fprintf(stderr, "%s: not a 512 byte boot sector\n", argv[2]);
+		return 1;
+	}
+	write_bpb(image);
+
+	/* the first two entries hold the media descriptor and an end marker */
+	fat12_set(image + RESERVED_SECTORS * SECTOR_SIZE, 0, 0xF00 | MEDIA_DESCRIPTOR);
+	fat12_set(image + RESERVED_SECTORS * SECTOR_SIZE, 1, FAT12_END);
+
+	for (i = 3; i < argc; i++) {
+		entry = root + (i - 3) * 32;
+		path = strchr(argv[i], '=');
+		if (!path || (*path = 0, !short_name(argv[i], entry))) {
+			fprintf(stderr, "%s: expected NAME.EXT=file, with an 8.3 name\n", argv[i]);
+			return 1;
+		}
+		path++;
+
+		size = read_file(path, image + (DATA_SECTOR + (cluster - 2) * SECTORS_PER_CLUSTER) * SECTOR_SIZE,
+			(long)(CLUSTERS + 2 - cluster) * CLUSTER_SIZE);
+		if (size < 0) {
+			return 1;
+		}
+
+		entry[11] = ATTRIBUTE_ARCHIVE;
+		write16(entry + 16, DATE_1980_01_01); /* created */
+		write16(entry + 18, DATE_1980_01_01); /* accessed */
+		write16(entry + 24, DATE_1980_01_01); /* modified */
+		write16(entry + 26, size ? cluster : 0);
+		write32(entry + 28, size);
+
+		clusters = (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+		for (k = 0; k < clusters; k++) {
+			fat12_set(image + RESERVED_SECTORS * SECTOR_SIZE, cluster + k,
+				k + 1 < clusters ? cluster + k + 1 : FAT12_END);
+		}
+		cluster += clusters;
+	}
+
+	for (k = 1; k < FATS; k++) {
+		memcpy(image + (RESERVED_SECTORS + k * SECTORS_PER_FAT) * SECTOR_SIZE,
+			image + RESERVED_SECTORS * SECTOR_SIZE, SECTORS_PER_FAT * SECTOR_SIZE);
+	}
+
+	f = fopen(argv[1], "wb");
+	if (!f || fwrite(image, 1, IMAGE_SIZE, f) != IMAGE_SIZE || fclose(f)) {
+		perror(argv[1]);
+		return 1;
+	}
+	return 0;
+}
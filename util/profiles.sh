@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+# Builds the kernel in every profile (see PROFILE in the Makefile) and
+# reports the size of each, and how long it takes to boot:
+#
+#   make profiles
+#
+# The boot time is the timestamp of the "boot: ready" log message, the
+# time from init_log() until the kernel is done initializing. It is
+# measured in QEMU, if there is one, booting a compressed kernel when run
+# as "make profiles COMPRESS=1".
+
+set -e
+
+printf "%-8s %8s %8s %8s %10s %10s %12s\n" profile text data bss kernel.bin kernel.lz4 "boot (s)"
+for profile in debug release profile; do
+  make -s PROFILE=$profile kernel.bin kernel.lz4 > /dev/null
+  set -- $(size kernel.out | tail -n 1)
+  text=$1 data=$2 bss=$3
+  bytes=$(wc -c < kernel.bin)
+  compressed=$(wc -c < kernel.lz4)
+
+  boot=-
+  if command -v qemu-system-i386 > /dev/null; then
+    make -s PROFILE=$profile COMPRESS=$COMPRESS my_os.img > /dev/null
+    boot=$(timeout 30 qemu-system-i386 -fda my_os.img -boot a -serial stdio -display none 2> /dev/null |
+      grep -m 1 "boot: ready" | sed 's/^\[ *\([0-9.]*\)\].*/\1/') || true
+  fi
+
+  printf "%-8s %8s %8s %8s %10s %10s %12s\n" $profile $text $data $bss $bytes $compressed "${boot:--}"
+done
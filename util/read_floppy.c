@@ -1,18 +1,30 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fat.h>
 
-typedef signed char int8_t;
-typedef unsigned char uint8_t;
-
-typedef signed short int16_t;
-typedef unsigned short uint16_t;
+/*
+  Inspects and checks a FAT12 or FAT16 image:
 
-typedef signed int int32_t;
-typedef unsigned int uint32_t;
+    read_floppy [-v] my_os.img
 
-/*
+  The image is mapped into memory rather than read, so the size of the
+  disk hardly matters. Both (all) FAT copies are decoded and compared,
+  every directory is walked from the root down, and each file's cluster
+  chain is followed: files are listed with their number of fragments
+  (runs of consecutive clusters), and chains that are broken, too short
+  or too long for the file size, share clusters with another file
+  (cross-linked), or point at clusters nobody owns (lost) are reported.
+  -v also dumps the BPB and the first sectors. The FATs are decoded by
+  fat.c, the same code the kernel uses.
 
+  Exits with 1 if the image has problems, like fsck.
  */
 
 typedef struct {
@@ -68,7 +80,48 @@ typedef struct {
 	uint32_t filesize;
 } __attribute__((packed)) dir_entry_t;
 
-static void output_chars(char* buf, uint8_t len) {
+#define ATTR_VOLUME_LABEL 0x08
+#define ATTR_DIRECTORY 0x10
+#define ATTR_LONG_NAME 0x0F /* a VFAT long name piece, not a file */
+
+#define ENTRY_END 0x00
+#define ENTRY_DELETED 0xE5
+
+/* cluster counts that decide the FAT type, by the Microsoft spec */
+#define FAT12_MAX_CLUSTERS 4084
+#define FAT16_MAX_CLUSTERS 65524
+
+/* problems of the same kind we list before just counting them */
+#define REPORT_LIMIT 10
+
+#define PATH_MAX_LENGTH 256
+
+typedef struct {
+	const uint8_t* image;
+	size_t size;
+
+	bpb_t* bpb;
+	uint32_t sector_size;
+	uint32_t cluster_size;
+	uint32_t fat_offset; /* bytes */
+	uint32_t fat_size; /* bytes, of one copy */
+	uint32_t root_offset;
+	uint32_t root_entries;
+	uint32_t data_offset;
+	uint32_t clusters; /* data clusters, numbered from 2 */
+	uint8_t bits; /* 12 or 16 */
+
+	fat_t fat; /* the first copy, decoded */
+	fat_extent_t* extents; /* room for the longest chain */
+	uint32_t* owner; /* per cluster, 1 + the file using it, or 0 */
+	char** names; /* per file, its path, to tell cross-linked files */
+	uint32_t files;
+
+	uint32_t errors;
+	uint32_t fragmented;
+} volume_t;
+
+static void output_chars(const uint8_t* buf, uint8_t len) {
 	uint8_t k;
 	for (k = 0; k < len; k++) {
 		printf("%c", buf[k]);
@@ -116,9 +169,9 @@ static void output_time(uint16_t time) {
 		10-5 	Minutes (0-59)
 		4-0 	Seconds/2 (0-29)
 	 */
-	uint8_t hours = time >> 0xB;
-	uint8_t minutes = (time >> 0x5) & 0x6;
-	uint8_t seconds = time & 0x5;
+	uint8_t hours = time >> 11;
+	uint8_t minutes = (time >> 5) & 0x3F;
+	uint8_t seconds = (time & 0x1F) * 2;
 
 	printf("%02d:%02d:%02d", hours, minutes, seconds);
 }
@@ -132,104 +185,134 @@ static void output_date(uint16_t date) {
 
 		[- - - - - - -] [- - - -] [- - - - -]
 	 */
-	uint16_t year = 1980 + (date >> 0x9);
-	uint8_t month = (date >> 0x5) & 0x4;
-	uint8_t day = date & 0x5;
+	uint16_t year = 1980 + (date >> 9);
+	uint8_t month = (date >> 5) & 0xF;
+	uint8_t day = date & 0x1F;
 
 	printf("%02d.%02d.%d", day, month, year);
 }
 
-/* decode the FAT table into the 12 bit entries it should be */
-void decode_fat(FILE* fp, bpb_t* bpb) {
-	uint16_t fat_table_offset = bpb->reserved_logical_sectors + bpb->hidden_sectors_count;
-	uint16_t fat_table_offset_in_bytes = fat_table_offset * bpb->bytes_per_logical_sector;
-
-	/* read the whole FAT into memory. Each FAT consists of
-		bpb->logical_sectors_per_fat sectors
-		the FAT entries occupy 12 bits each */
-	if (fseek(fp, fat_table_offset_in_bytes, SEEK_SET)) {
-		fprintf(stderr, "Could not seek to position %d\n", fat_table_offset_in_bytes);
-		exit(EXIT_FAILURE);
+static void output_hex(const uint8_t* buf, uint32_t len) {
+	uint32_t k;
+	for (k = 0; k < len; k++) {
+		printf("%02x%c", buf[k], (k + 1) % 16 ? ' ' : '\n');
 	}
+}
 
-	uint16_t fat_size = bpb->bytes_per_logical_sector * bpb->logical_sectors_per_fat;
-	uint16_t k;
-	uint8_t buf[fat_size];
-
-	for (k = 0; k < fat_size; k++) {
-		buf[k] = fgetc(fp);
-	}
+/* problems are printed as they are found, and counted */
+static void report(volume_t* volume, const char* fmt, ...) {
+	va_list args;
 
-	uint16_t fat_table[fat_size * 2/3];
-	uint16_t i = 0;
+	volume->errors++;
+	printf("error: ");
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	printf("\n");
+}
 
-	for (k = 0; k < fat_size/3; k++) {
-		/* three bytes = 2 FAT entries */
-		uint16_t offset = 3 * k;
+static void decode_fat(volume_t* volume, uint32_t copy, uint16_t* out) {
+	const uint8_t* fat = volume->image + volume->fat_offset + copy * volume->fat_size;
 
-		uint8_t b1 = buf[offset + 0];
-		uint8_t b2 = buf[offset + 1];
-		uint8_t b3 = buf[offset + 2];
+	if (volume->bits == 12) {
+		fat12_unpack(fat, out, volume->fat.count);
+	} else {
+		fat16_unpack(fat, out, volume->fat.count);
+	}
+}
 
-		/*
-			b1: bc   =  1011 1100
-			b2: fa   =  1111 1010
-			b3: de   =  1101 1110
+/* the data of cluster "cluster" */
+static const uint8_t* cluster_data(volume_t* volume, uint32_t cluster) {
+	return volume->image + volume->data_offset + (size_t)(cluster - 2) * volume->cluster_size;
+}
 
-			because of little endian,
-			"bc" is the LSB in the first entry
-			"f" is the LSB in the second entry
-			"a" is the MSB in the first entry
-			"de" is the MSB in the second entry
+static int valid_cluster(volume_t* volume, uint32_t cluster) {
+	return cluster >= 2 && cluster < volume->clusters + 2;
+}
 
-			entry1 = ((b2 & 0xF) << 8) | b1;
-			entry2 = (b3 << 4) | (b2 >> 4)
-		 */
+static int open_volume(volume_t* volume, const char* path) {
+	struct stat st;
+	uint32_t total_sectors, fat_entries_fit;
+	int fd;
 
-		uint16_t e1 = ((b2 & 0xF) << 8) | b1;
-		uint16_t e2 = (b3 << 4) | (b2 >> 4);
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		return 0;
+	}
+	if (st.st_size < 512) {
+		fprintf(stderr, "%s: too small for a boot sector\n", path);
+		return 0;
+	}
 
-		fat_table[i++] = e1;
-		fat_table[i++] = e2;
+	volume->size = st.st_size;
+	volume->image = mmap(0, volume->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (volume->image == MAP_FAILED) {
+		perror(path);
+		return 0;
+	}
+	madvise((void*)volume->image, volume->size, MADV_WILLNEED);
+
+	volume->bpb = (bpb_t*)(volume->image + sizeof(fat_header_t));
+	volume->sector_size = volume->bpb->bytes_per_logical_sector;
+	if (volume->sector_size < 512 || (volume->sector_size & (volume->sector_size - 1)) ||
+			!volume->bpb->logical_sectors_per_cluster || !volume->bpb->number_of_fats) {
+		fprintf(stderr, "%s: no FAT BIOS parameter block\n", path);
+		return 0;
 	}
-}
 
-#define SECTOR_SIZE 512
-#define FAT_ENTRY_SIZE 32
+	total_sectors = volume->bpb->total_logical_sectors ?
+		volume->bpb->total_logical_sectors : volume->bpb->total_logical_sectors_including_hidden;
 
-int main(int argc, char** argv) {
+	volume->cluster_size = volume->sector_size * volume->bpb->logical_sectors_per_cluster;
+	volume->fat_offset = volume->bpb->reserved_logical_sectors * volume->sector_size;
+	volume->fat_size = volume->bpb->logical_sectors_per_fat * volume->sector_size;
+	volume->root_offset = volume->fat_offset + volume->bpb->number_of_fats * volume->fat_size;
+	volume->root_entries = volume->bpb->root_directory_entries;
+	volume->data_offset = volume->root_offset +
+		(volume->root_entries * sizeof(dir_entry_t) + volume->sector_size - 1) / volume->sector_size * volume->sector_size;
 
-	if (argc != 2) {
-		fprintf(stderr, "Usage: %s INPUT_FILE\n", argv[0]);
-		return EXIT_FAILURE;
+	if ((uint64_t)total_sectors * volume->sector_size > volume->size || volume->data_offset >= volume->size) {
+		fprintf(stderr, "%s: the BPB describes %u sectors, more than the image has\n", path, total_sectors);
+		return 0;
 	}
-
-	FILE* fp;
-	fp = fopen(argv[1], "rb");
-
-	if (!fp) {
-		fprintf(stderr, "Failed to open file for reading\n");
-		return EXIT_FAILURE;
+	volume->clusters = (total_sectors - volume->data_offset / volume->sector_size) / volume->bpb->logical_sectors_per_cluster;
+
+	if (volume->clusters <= FAT12_MAX_CLUSTERS) {
+		volume->bits = 12;
+	} else if (volume->clusters <= FAT16_MAX_CLUSTERS) {
+		volume->bits = 16;
+	} else {
+		fprintf(stderr, "%s: %u clusters, that is FAT32, which is not supported\n", path, volume->clusters);
+		return 0;
 	}
 
-	printf("Size of FAT header: %lu bytes\n", sizeof(fat_header_t));
-	printf("Size of BPB header: %lu bytes\n", sizeof(bpb_t));
-	printf("Size of DIR header: %lu bytes\n", sizeof(dir_entry_t));
-
-	uint8_t buf[SECTOR_SIZE];
-	uint16_t k;
-	for (k = 0; k < SECTOR_SIZE; k++) {
-		buf[k] = fgetc(fp);
+	/* a FAT too small for the clusters makes the ones past its end unusable */
+	fat_entries_fit = volume->fat_size * 8 / volume->bits;
+	if (fat_entries_fit < volume->clusters + 2) {
+		printf("warning: the FAT only has room for %u of %u clusters\n", fat_entries_fit - 2, volume->clusters);
+		volume->clusters = fat_entries_fit - 2;
 	}
 
-	fat_header_t* header;
-	header = (fat_header_t*)&buf;
+	volume->fat.count = volume->clusters + 2;
+	volume->fat.bad = volume->bits == 12 ? FAT12_BAD : FAT16_BAD;
+	volume->fat.entries = calloc(volume->fat.count, sizeof(uint16_t));
+	volume->extents = calloc(volume->clusters, sizeof(fat_extent_t));
+	volume->owner = calloc(volume->fat.count, sizeof(uint32_t));
+	if (!volume->fat.entries || !volume->extents || !volume->owner) {
+		fprintf(stderr, "out of memory\n");
+		return 0;
+	}
+	return 1;
+}
 
-	bpb_t* bpb;
-	bpb = (bpb_t*)&buf[sizeof(fat_header_t)];
+static void output_bpb(volume_t* volume) {
+	fat_header_t* header = (fat_header_t*)volume->image;
+	bpb_t* bpb = volume->bpb;
 
 	printf("OEM: <");
-	output_chars((char*)&header->oem, 8);
+	output_chars(header->oem, 8);
 	printf(">\n");
 
 	printf("Bytes per logical sector: %d\n", bpb->bytes_per_logical_sector);
@@ -238,7 +321,6 @@ int main(int argc, char** argv) {
 	printf("Number of FATs: %d\n", bpb->number_of_fats);
 	printf("Root directory entries: %d\n", bpb->root_directory_entries);
 	printf("Total logical sectors: %d\n", bpb->total_logical_sectors);
-	printf("Total logical sectors: 0x%x\n", bpb->total_logical_sectors);
 	printf("Media descriptor: 0x%x\n", bpb->media_descriptor);
 	printf("Logical sectors per FAT: %d\n", bpb->logical_sectors_per_fat);
 	printf("Physical sectors per track: %d\n", bpb->physical_sectors_per_track);
@@ -249,268 +331,267 @@ int main(int argc, char** argv) {
 	printf("Drive number: %d\n", bpb->drive_number);
 	printf("Boot signature number: 0x%x\n", bpb->extended_boot_signature);
 
-
 	printf("Volume label: <");
-	output_chars((char*)&bpb->partition_volume_label, 11);
+	output_chars(bpb->partition_volume_label, 11);
 	printf(">\n");
 
 	printf("Filesystem type: <");
-	output_chars((char*)&bpb->filesystem_type, 8);
+	output_chars(bpb->filesystem_type, 8);
 	printf(">\n");
 
+	printf("FAT offset: %u bytes\n", volume->fat_offset);
+	printf("Root directory offset: %u bytes\n", volume->root_offset);
+	printf("Data offset: %u bytes\n", volume->data_offset);
+
+	printf("\nOutput of first sector:\n");
+	output_hex(volume->image, 512);
+	printf("\nOutput of FAT table (only first sector):\n");
+	output_hex(volume->image + volume->fat_offset, volume->sector_size);
 	printf("\n");
-	printf("Output of first sector:\n");
-	for (k = 0; k < SECTOR_SIZE; k++) {
-		printf("%02x ", buf[k]);
+}
 
-		if ((k + 1) % 16 == 0) {
-			printf("\n");
+/* compares the other FAT copies against the first, entry by entry */
+static void check_fat_copies(volume_t* volume) {
+	uint16_t* other = calloc(volume->fat.count, sizeof(uint16_t));
+	uint32_t copy, k, differences;
+
+	for (copy = 1; copy < volume->bpb->number_of_fats; copy++) {
+		/* identical bytes are the common case, and need no decoding */
+		if (!memcmp(volume->image + volume->fat_offset, volume->image + volume->fat_offset + copy * volume->fat_size,
+				volume->fat_size)) {
+			continue;
+		}
+
+		decode_fat(volume, copy, other);
+		differences = 0;
+		for (k = 0; k < volume->fat.count; k++) {
+			if (other[k] != volume->fat.entries[k] && differences++ < REPORT_LIMIT) {
+				printf("error: FAT %u has %04x for cluster %u, FAT 1 has %04x\n", copy + 1, other[k], k,
+					volume->fat.entries[k]);
+			}
+		}
+		if (differences) {
+			volume->errors++;
+			printf("error: FAT %u differs from FAT 1 in %u entries\n", copy + 1, differences);
 		}
 	}
-	printf("\n");
+	free(other);
+}
 
-	uint16_t root_dir_size = (FAT_ENTRY_SIZE * bpb->root_directory_entries) / bpb->bytes_per_logical_sector;
-	printf("Root directory size: %d sectors\n", root_dir_size);
-	printf("Root directory size: %d bytes\n", FAT_ENTRY_SIZE * bpb->root_directory_entries);
+/* "KERNEL  BIN" as "KERNEL.BIN", appended to "path" */
+static void append_name(char* path, const dir_entry_t* entry) {
+	char* p = path + strlen(path);
+	int k;
 
-	uint16_t root_dir_offset = bpb->number_of_fats * bpb->logical_sectors_per_fat
-		+ bpb->hidden_sectors_count + bpb->reserved_logical_sectors;
-	uint16_t root_dir_offset_in_bytes = root_dir_offset * bpb->bytes_per_logical_sector;
+	if (p != path) {
+		*p++ = '/';
+	}
+	for (k = 0; k < 8 && entry->filename[k] != ' '; k++) {
+		*p++ = entry->filename[k];
+	}
+	if (entry->ext[0] != ' ') {
+		*p++ = '.';
+		for (k = 0; k < 3 && entry->ext[k] != ' '; k++) {
+			*p++ = entry->ext[k];
+		}
+	}
+	*p = 0;
+}
 
-	printf("Root directory offset: %d\n", root_dir_offset);
-	printf("Root directory offset: %d * %d = %d bytes\n", root_dir_offset, bpb->bytes_per_logical_sector,
-		root_dir_offset_in_bytes);
+/*
+  Follows the chain starting at "cluster", claiming every cluster for
+  file "file". Returns the number of clusters, and their number of runs
+  of consecutive clusters in "fragments".
+ */
+static uint32_t walk_chain(volume_t* volume, const char* path, uint32_t file, uint32_t cluster, uint32_t* fragments) {
+	uint32_t count = volume->clusters, claimed = 0, status, k, c;
+	fat_extent_t* extent;
+
+	status = fat_extents(&volume->fat, cluster, volume->extents, &count, 0);
+
+	/* a loop or a cross-link shows as a cluster that is claimed already */
+	for (k = 0; k < count; k++) {
+		extent = &volume->extents[k];
+		for (c = extent->start; c < extent->start + extent->length; c++) {
+			if (volume->owner[c] == file + 1) {
+				report(volume, "%s: chain loops back to cluster %u", path, c);
+				*fragments = k + (c > extent->start);
+				return claimed;
+			}
+			if (volume->owner[c]) {
+				report(volume, "%s: cross-linked with %s at cluster %u", path, volume->names[volume->owner[c] - 1], c);
+				*fragments = k + (c > extent->start);
+				return claimed;
+			}
+			volume->owner[c] = file + 1;
+			claimed++;
+		}
+	}
+	*fragments = count;
+
+	/* the last cluster of the chain, where it went wrong */
+	c = count ? volume->extents[count - 1].start + volume->extents[count - 1].length - 1 : cluster;
+	if (status == FAT_CHAIN_RANGE) {
+		report(volume, "%s: chain points past the %u clusters, after cluster %u", path, volume->clusters + 1, c);
+	} else if (status == FAT_CHAIN_FREE || status == FAT_CHAIN_BAD) {
+		report(volume, "%s: cluster %u is followed by a %s cluster", path, c, status == FAT_CHAIN_BAD ? "bad" : "free");
+	}
+	return claimed;
+}
 
-	uint16_t fat_table_offset = bpb->reserved_logical_sectors + bpb->hidden_sectors_count;
-	uint16_t fat_table_offset_in_bytes = fat_table_offset * bpb->bytes_per_logical_sector;
-	printf("Offset of FAT table: %d sectors\n", fat_table_offset);
-	printf("Offset of FAT table: %d bytes\n", fat_table_offset_in_bytes);
+static void walk_directory(volume_t* volume, const char* path, uint32_t cluster, uint32_t clusters, uint32_t depth);
 
-	printf("First data sector: %d\n", root_dir_size + root_dir_offset);
+static void check_entry(volume_t* volume, const char* parent, const dir_entry_t* entry, uint32_t depth) {
+	char path[PATH_MAX_LENGTH];
+	uint32_t file = volume->files++, clusters, fragments, expected;
 
-	decode_fat(fp, bpb);
+	strcpy(path, parent);
+	append_name(path, entry);
 
-	/* read the whole FAT into memory. Each FAT consists of
-		bpb->logical_sectors_per_fat sectors
-		the FAT entries occupy 12 bits each */
-	if (fseek(fp, fat_table_offset_in_bytes, SEEK_SET)) {
-		fprintf(stderr, "Could not seek to position %d\n", fat_table_offset_in_bytes);
-		return EXIT_FAILURE;
+	/* doubling, so a disk with many files does not realloc for every one */
+	if (!(file & (file - 1))) {
+		volume->names = realloc(volume->names, (file ? 2 * file : 1) * sizeof(char*));
 	}
-	uint8_t fatbuf[bpb->bytes_per_logical_sector * bpb->logical_sectors_per_fat];
-	for (k = 0; k < bpb->bytes_per_logical_sector * bpb->logical_sectors_per_fat; k++) {
-		fatbuf[k] = fgetc(fp);
+	volume->names[file] = strdup(path);
+
+	if (!entry->cluster) {
+		clusters = fragments = 0;
+	} else {
+		clusters = walk_chain(volume, path, file, entry->cluster, &fragments);
 	}
 
+	if (entry->attr & ATTR_DIRECTORY) {
+		printf("%-40s %10s %8u %9u  ", path, "<DIR>", clusters, fragments);
+	} else {
+		printf("%-40s %10u %8u %9u  ", path, entry->filesize, clusters, fragments);
+	}
+	output_date(entry->last_modified_date);
+	printf(" ");
+	output_time(entry->last_modified_time);
+	printf("  ");
+	output_attribute(entry->attr);
 	printf("\n");
-	printf("Output of FAT table (only first sector):\n");
-	for (k = 0; k < bpb->bytes_per_logical_sector; k++) {
-		printf("%02x ", fatbuf[k]);
 
-		if ((k + 1) % 16 == 0) {
-			printf("\n");
+	if (fragments > 1) {
+		volume->fragmented++;
+	}
+
+	if (entry->attr & ATTR_DIRECTORY) {
+		if (!entry->cluster) {
+			report(volume, "%s: directory without clusters", path);
+		} else if (depth >= PATH_MAX_LENGTH / 2 || strlen(path) + 13 >= PATH_MAX_LENGTH) {
+			report(volume, "%s: nested too deep to follow", path);
+		} else {
+			walk_directory(volume, path, entry->cluster, clusters, depth + 1);
 		}
+		return;
 	}
-	printf("\n");
 
-	if (fseek(fp, root_dir_offset_in_bytes, SEEK_SET)) {
-		fprintf(stderr, "Could not seek to position %d\n", root_dir_offset_in_bytes);
-		return EXIT_FAILURE;
+	expected = (entry->filesize + volume->cluster_size - 1) / volume->cluster_size;
+	if (clusters != expected) {
+		report(volume, "%s: %u clusters in the chain, the size needs %u", path, clusters, expected);
 	}
+}
 
-	uint16_t p;
-	/* read all root directory sectors, one at a time */
-	for (p = 0; p < root_dir_size; p++) {
-		/* read one root directory into memory */
-		uint8_t dirbuf[bpb->bytes_per_logical_sector];
+/* a run of directory entries; returns 0 at the end marker */
+static int walk_entries(volume_t* volume, const char* path, const dir_entry_t* entries, uint32_t count, uint32_t depth) {
+	uint32_t k;
 
-		for (k = 0; k < bpb->bytes_per_logical_sector; k++) {
-			dirbuf[k] = fgetc(fp);
+	for (k = 0; k < count; k++) {
+		const dir_entry_t* entry = &entries[k];
+
+		if (entry->filename[0] == ENTRY_END) {
+			return 0;
+		}
+		if (entry->filename[0] == ENTRY_DELETED || entry->attr == ATTR_LONG_NAME ||
+				(entry->attr & ATTR_VOLUME_LABEL) || entry->filename[0] == '.') {
+			continue;
 		}
+		check_entry(volume, path, entry, depth);
+	}
+	return 1;
+}
 
-		/* we just care about the first sector, because this is an example .. */
-		if (p == 0) {
-			/* each directory entry is 32 bytes, which makes
-				bpb->bytes_per_logical_sector / 32 entries per sector */
-			uint16_t entries_per_sector = bpb->bytes_per_logical_sector / FAT_ENTRY_SIZE;
-			dir_entry_t* entries = (dir_entry_t*)&dirbuf[0];
-
-			for (k = 0; k < entries_per_sector; k++) {
-				printf("Filename: ");
-				output_chars(entries[k].filename, 8);
-				printf(" --> ");
-				printf("Attribute: 0x%02x: ", entries[k].attr);
-				output_attribute(entries[k].attr);
-				printf(" --> Cluster: %d\n", entries[k].cluster);
-				printf("\n");
-			}
+/*
+  The "clusters" clusters of a subdirectory were claimed by check_entry()
+  already. Only those are read: past them, the chain loops or runs into
+  another file, which walk_chain() reported.
+ */
+static void walk_directory(volume_t* volume, const char* path, uint32_t cluster, uint32_t clusters, uint32_t depth) {
+	uint32_t per_cluster = volume->cluster_size / sizeof(dir_entry_t);
 
-			/* loop thru every entry in the directory */
-			for (k = 0; k < entries_per_sector; k++) {
-				dir_entry_t* entry = &entries[k];
-
-				/* look for a special file */
-				char* my_file = "SECOND  ";
-				uint8_t ok = 1;
-				uint8_t pos = 0;
-				/* a filename can only be 8 bytes */
-				for (pos = 0; pos < 8; pos++) {
-					if (my_file[pos] != entry->filename[pos]) {
-						ok = 0;
-						break;
-					}
-				}
-
-				if (ok == 0) {
-					/* test for the directory */
-					my_file = "TESTDIR ";
-					ok = 1;
-					/* a filename can only be 8 bytes */
-					for (pos = 0; pos < 8; pos++) {
-						if (my_file[pos] != entry->filename[pos]) {
-							ok = 0;
-							break;
-						}
-					}
-
-
-					if (ok == 0) {
-						continue;
-					}
-				}
-
-				printf("Dir Entry %d\n", k / FAT_ENTRY_SIZE);
-				printf("Filename: <");
-				output_chars(entry->filename, 8);
-				printf(">\n");
-				printf("Extension: <");
-				output_chars(entry->ext, 3);
-				printf(">\n");
-				printf("Attribute: 0x%02x: ", entry->attr);
-				output_attribute(entry->attr);
-				printf("\n");
-				printf("Create time: ");
-				output_time(entry->creation_time);
-				printf("\n");
-				printf("Create date: ");
-				output_date(entry->creation_date);
-				printf("\n");
-				printf("Cluster: %d\n", entry->cluster);
-				printf("Filesize: %d bytes\n", entry->filesize);
-
-				/*
-					the fat table has one entry per cluster
-					The FAT12 file system uses 12 bits per FAT entry, thus two entries span 3 bytes.
-					The first cluster of the data area is cluster #2.
-					That leaves the first two entries of the FAT unused.
-					In the first byte of the first entry a copy of the media descriptor is stored.
-				 */
-				uint16_t cluster = entry->cluster;
-				uint32_t remaining_size = entry->filesize;
-
-				while (1) {
-					/* subtract two because first two entries in FAT is reserved */
-					uint16_t file_sector = ((cluster - 2) * bpb->logical_sectors_per_cluster) + root_dir_size + root_dir_offset;
-					uint16_t file_sector_offset = file_sector * bpb->bytes_per_logical_sector;
-					uint16_t read_size = bpb->bytes_per_logical_sector;
-
-					if (remaining_size < bpb->bytes_per_logical_sector) {
-						read_size = remaining_size;
-					}
-
-					if (fseek(fp, file_sector_offset, SEEK_SET)) {
-						fprintf(stderr, "Could not seek to position %d\n", file_sector_offset);
-						return EXIT_FAILURE;
-					}
-
-					if (read_size > 0) {
-						uint16_t o;
-						for (o = 0; o < read_size; o++) {
-							printf("%c", fgetc(fp));
-						}
-					} else {
-						/* Subdirectories have a filesize entry of zero. */
-						if (entry->filesize == 0) {
-							printf("Its a directory, the contents of the cluster is a directory entry\n");
-
-							/* read the 512 byte sector size */
-							uint8_t subdirbuf[bpb->bytes_per_logical_sector];
-
-							uint16_t o;
-							for (o = 0; o < bpb->bytes_per_logical_sector; o++) {
-								subdirbuf[o] = fgetc(fp);
-							}
-
-							dir_entry_t* subdirentries = (dir_entry_t*)&subdirbuf[0];
-
-							for (o = 0; o < bpb->bytes_per_logical_sector/FAT_ENTRY_SIZE; o++) {
-								printf("Filename: ");
-								output_chars(subdirentries[o].filename, 8);
-								printf(" --> ");
-								printf("Attribute: 0x%02x: ", subdirentries[o].attr);
-								output_attribute(subdirentries[o].attr);
-								printf(" --> Cluster: %d\n", subdirentries[o].cluster);
-								printf("\n");
-							}
-						}
-					}
-
-					printf("Reading %d bytes in sector %d (offset 0x%04x)\n", read_size, file_sector, file_sector_offset);
-					remaining_size = remaining_size - read_size;
-
-					uint16_t fat_offset = cluster + cluster/2;
-					uint16_t fat_value = *(uint16_t*)&fatbuf[fat_offset];
-
-					printf("FAT offset: %d\n", fat_offset);
-					printf("Value at this offset: 0x%04x\n", fat_value);
-
-					if (cluster & 1) {
-						/* odd value, shift off 4 last bits */
-						cluster = fat_value >> 4;
-					} else {
-						/* even value, mask out upper 4 bits */
-						cluster = fat_value & 0xFFF;
-					}
-
-					if (cluster >= 0xFF8) {
-						printf("No more entries\n");
-						break;
-					} else if (cluster == 0xFF7) {
-						printf("Entry marked as bad\n");
-						break;
-					} else {
-						printf("Next cluster: %d\n", cluster);
-					}
-				}
-
-				//break;
-			}
+	while (clusters-- && valid_cluster(volume, cluster)) {
+		if (!walk_entries(volume, path, (const dir_entry_t*)cluster_data(volume, cluster), per_cluster, depth)) {
+			return;
+		}
+		cluster = volume->fat.entries[cluster];
+	}
+}
 
-			printf("\nOutput of first root dir sector:\n");
-			for (k = 0; k < bpb->bytes_per_logical_sector; k++) {
-				printf("%02x ", dirbuf[k]);
-
-				if ((k + 1) % 16 == 0) {
-					printf("  |  ");
-					uint8_t q;
-					for (q = 0; q < 16; q++) {
-						uint8_t m = dirbuf[k - 15 + q];
-
-						if ((m >= 'a' && m <= 'z') || (m >= 'A' && m <= 'Z') || (m >= '0' && m <= '9')) {
-							printf("%c", m);
-						} else {
-							printf(".");
-						}
-					}
-
-					printf("\n");
-				}
-			}
-			printf("\n");
+/* allocated clusters no file claimed */
+static void check_lost(volume_t* volume) {
+	uint32_t k, lost = 0, bad = 0;
+
+	for (k = 2; k < volume->clusters + 2; k++) {
+		if (volume->fat.entries[k] == volume->fat.bad) {
+			bad++;
+		} else if (volume->fat.entries[k] != FAT_FREE && !volume->owner[k] && lost++ < REPORT_LIMIT) {
+			printf("error: cluster %u is allocated (%04x) but belongs to no file\n", k, volume->fat.entries[k]);
 		}
 	}
+	if (lost) {
+		volume->errors++;
+		printf("error: %u lost clusters\n", lost);
+	}
+	if (bad) {
+		printf("%u clusters marked bad\n", bad);
+	}
+}
+
+int main(int argc, char** argv) {
+	volume_t volume;
+	uint32_t k, used = 0;
+	int verbose = argc == 3 && !strcmp(argv[1], "-v");
+
+	if (argc != 2 && !verbose) {
+		fprintf(stderr, "Usage: %s [-v] INPUT_FILE\n", argv[0]);
+		return EXIT_FAILURE;
+	}
 
-	fclose(fp);
+	memset(&volume, 0, sizeof(volume));
+#if defined(__i386__) || defined(__x86_64__)
+	fat_use_ssse3(__builtin_cpu_supports("ssse3"));
+#endif
+	if (!open_volume(&volume, argv[argc - 1])) {
+		return EXIT_FAILURE;
+	}
+
+	if (verbose) {
+		output_bpb(&volume);
+	}
+
+	printf("FAT%u, %u clusters of %u bytes, %u FATs\n\n", volume.bits, volume.clusters, volume.cluster_size,
+		volume.bpb->number_of_fats);
+
+	decode_fat(&volume, 0, volume.fat.entries);
+	if (volume.fat.entries[0] != ((volume.fat.bad & 0xFF00) | volume.bpb->media_descriptor)) {
+		printf("warning: FAT entry 0 is %04x, the media descriptor is %02x\n", volume.fat.entries[0],
+			volume.bpb->media_descriptor);
+	}
+	check_fat_copies(&volume);
+
+	printf("%-40s %10s %8s %9s  %s\n", "file", "size", "clusters", "fragments", "modified");
+	walk_entries(&volume, "", (const dir_entry_t*)(volume.image + volume.root_offset), volume.root_entries, 0);
+	printf("\n");
+
+	check_lost(&volume);
+
+	for (k = 2; k < volume.clusters + 2; k++) {
+		used += volume.owner[k] != 0;
+	}
+	printf("%u files, %u of %u clusters used, %u fragmented files, %u errors\n", volume.files, used, volume.clusters,
+		volume.fragmented, volume.errors);
 
-	return EXIT_SUCCESS;
+	munmap((void*)volume.image, volume.size);
+	return volume.errors ? EXIT_FAILURE : EXIT_SUCCESS;
 }
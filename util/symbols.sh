@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Turns the code symbols of a linked kernel into an assembly file with a
+# table sorted by address, for symbol_index() in symbols.c:
+#
+#   sh util/symbols.sh kernel_nosyms.out > kernel_symbols.s
+#
+# The table lands in the .symbols section, after all code and data (see
+# kernel.ld), so linking it in does not move anything it describes.
+# Linker script symbols (starting with "_") and local labels are left out.
+
+nm -n --defined-only "$1" | awk '
+BEGIN {
+  n = 0
+}
+$2 ~ /^[tT]$/ && $3 !~ /^[_.]/ {
+  address[n] = $1
+  name[n] = $3
+  n++
+}
+END {
+  print "# generated by util/symbols.sh, do not edit"
+  print ".section .symbols, \"a\""
+  print ".balign 4"
+  print ".globl symbol_count"
+  print "symbol_count:"
+  printf "\t.long %d\n", n
+  print ".globl symbol_addresses"
+  print "symbol_addresses:"
+  for (i = 0; i < n; i++) {
+    printf "\t.long 0x%s\n", address[i]
+  }
+  print ".globl symbol_names"
+  print "symbol_names:"
+  for (i = 0; i < n; i++) {
+    printf "\t.long .Lname%d\n", i
+  }
+  for (i = 0; i < n; i++) {
+    printf ".Lname%d:\t.asciz \"%s\"\n", i, name[i]
+  }
+}'
@@ -0,0 +1,65 @@
+#ifndef VBE_H
+#define VBE_H
+
+#include <stdint.h>
+
+/* where stage2 leaves the VBE handoff, see BOOT_HANDOFF_SEGMENT in stage2.s */
+#define VBE_HANDOFF_ADDR 0x1000
+#define VBE_FONT_ADDR 0x2000
+#define VBE_MAGIC 0x4d454256 /* "VBEM" */
+
+#define VBE_FONT_WIDTH 8
+#define VBE_FONT_HEIGHT 16
+
+/* memory models */
+#define VBE_MODEL_PACKED 0x04
+#define VBE_MODEL_DIRECT 0x06
+
+/* the VBE 2.0 ModeInfoBlock, as returned by int 0x10, ax = 0x4f01 */
+typedef struct {
+  uint16_t attributes;
+  uint8_t window_a;
+  uint8_t window_b;
+  uint16_t granularity;
+  uint16_t window_size;
+  uint16_t segment_a;
+  uint16_t segment_b;
+  uint32_t window_function;
+  uint16_t pitch; /* bytes per scanline */
+  uint16_t width;
+  uint16_t height;
+  uint8_t char_width;
+  uint8_t char_height;
+  uint8_t planes;
+  uint8_t bpp;
+  uint8_t banks;
+  uint8_t memory_model;
+  uint8_t bank_size;
+  uint8_t image_pages;
+  uint8_t reserved0;
+
+  uint8_t red_mask_size;
+  uint8_t red_position;
+  uint8_t green_mask_size;
+  uint8_t green_position;
+  uint8_t blue_mask_size;
+  uint8_t blue_position;
+  uint8_t reserved_mask_size;
+  uint8_t reserved_position;
+  uint8_t direct_color_attributes;
+
+  /* VBE 2.0 */
+  uint32_t framebuffer; /* physical address of the linear framebuffer */
+  uint32_t off_screen_memory;
+  uint16_t off_screen_memory_size;
+  uint8_t reserved1[206];
+} __attribute__((packed)) vbe_mode_info_t;
+
+typedef struct {
+  uint32_t magic; /* VBE_MAGIC if stage2 set a mode */
+  uint16_t mode;
+  uint16_t reserved;
+  vbe_mode_info_t info;
+} __attribute__((packed)) vbe_handoff_t;
+
+#endif
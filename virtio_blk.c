@@ -0,0 +1,304 @@
+#include <virtio_blk.h>
+#include <pci.h>
+#include <io.h>
+#include <log.h>
+#include <memory.h>
+#include <frame.h>
+
+#define VIRTIO_VENDOR 0x1AF4
+#define VIRTIO_DEVICE_FIRST 0x1000 /* legacy and transitional devices */
+#define VIRTIO_DEVICE_LAST 0x103F
+#define VIRTIO_SUBSYSTEM_BLOCK 2
+
+/* legacy registers, from the I/O port in BAR0 */
+#define VIRTIO_DEVICE_FEATURES 0x00
+#define VIRTIO_GUEST_FEATURES 0x04
+#define VIRTIO_QUEUE_ADDRESS 0x08 /* page number */
+#define VIRTIO_QUEUE_SIZE 0x0C
+#define VIRTIO_QUEUE_SELECT 0x0E
+#define VIRTIO_QUEUE_NOTIFY 0x10
+#define VIRTIO_DEVICE_STATUS 0x12
+#define VIRTIO_BLK_CAPACITY 0x14 /* 64 bits, in sectors */
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x1
+#define VIRTIO_STATUS_DRIVER 0x2
+#define VIRTIO_STATUS_DRIVER_OK 0x4
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTQ_DESC_F_NEXT 0x1
+#define VIRTQ_DESC_F_WRITE 0x2 /* the device writes the buffer, rather than reads it */
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 0x1
+#define VIRTQ_USED_F_NO_NOTIFY 0x1
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+
+/*
+  A split virtqueue of "size" entries: the descriptor table, the ring of
+  descriptors made available to the device, and, on the next page, the
+  ring of those it has used. Legacy devices pick the size themselves.
+ */
+#define VIRTQ_SIZE_MAX 256
+#define VIRTQ_ALIGN(x) (((x) + PAGE_SIZE - 1) & PAGE_MASK)
+#define VIRTQ_USED_OFFSET(size) VIRTQ_ALIGN(16 * (size) + 6 + 2 * (size))
+#define VIRTQ_BYTES(size) (VIRTQ_USED_OFFSET(size) + VIRTQ_ALIGN(6 + 8 * (size)))
+
+/* every request takes three descriptors: header, data and status */
+#define DESCRIPTORS_PER_REQUEST 3
+#define SLOTS (VIRTQ_SIZE_MAX / DESCRIPTORS_PER_REQUEST)
+
+/* x86 only reorders a store with a later load, which this prevents */
+#define memory_barrier() __asm__ __volatile__ ("lock; addl $0, (%%esp)" : : : "memory")
+#define barrier() __asm__ __volatile__ ("" : : : "memory")
+
+typedef struct {
+  uint64_t address;
+  uint32_t length;
+  uint16_t flags;
+  uint16_t next;
+} virtq_desc_t;
+
+typedef struct {
+  uint16_t flags;
+  uint16_t index;
+  uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t length;
+} virtq_used_element_t;
+
+typedef struct {
+  uint16_t flags;
+  uint16_t index;
+  virtq_used_element_t ring[];
+} virtq_used_t;
+
+typedef struct {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t sector;
+} virtio_blk_header_t;
+
+/* what the device reads and writes besides the data, per request in flight */
+typedef struct {
+  virtio_blk_header_t header;
+  uint8_t status;
+  virtio_blk_request_t* request;
+} slot_t;
+
+static uint8_t queue[VIRTQ_BYTES(VIRTQ_SIZE_MAX)] __attribute__((aligned(PAGE_SIZE)));
+
+static uint16_t io;
+static uint16_t size;
+static uint64_t capacity;
+
+static virtq_desc_t* descriptors;
+static volatile virtq_avail_t* avail;
+static volatile virtq_used_t* used;
+
+static slot_t slots[SLOTS];
+static uint16_t free_slots[SLOTS];
+static uint32_t free_count;
+
+/* available entries written but not yet published to the device */
+static uint16_t avail_next;
+/* the used entries we have seen */
+static uint16_t used_seen;
+
+uint32_t init_virtio_blk()
+{
+  pci_device_t* device = 0;
+  uint32_t k, d;
+
+  capacity = 0;
+  for (k = 0; k < pci_devices(); k++) {
+    device = pci_device(k);
+    if (device->vendor == VIRTIO_VENDOR && device->device >= VIRTIO_DEVICE_FIRST &&
+        device->device <= VIRTIO_DEVICE_LAST && device->subsystem == VIRTIO_SUBSYSTEM_BLOCK &&
+        (device->bars[0] & PCI_BAR_IO)) {
+      break;
+    }
+    device = 0;
+  }
+  if (!device) {
+    return 0;
+  }
+
+  io = device->bars[0] & ~3;
+  pci_enable(device, PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+
+  /* reset, then introduce ourselves; no optional features are needed */
+  outportb(io + VIRTIO_DEVICE_STATUS, 0);
+  outportb(io + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+  outportb(io + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+  outportl(io + VIRTIO_GUEST_FEATURES, 0);
+
+  outportw(io + VIRTIO_QUEUE_SELECT, 0);
+  size = inportw(io + VIRTIO_QUEUE_SIZE);
+  /* too small for even one request, and we would wait for a slot forever */
+  if (size < DESCRIPTORS_PER_REQUEST || size > VIRTQ_SIZE_MAX) {
+    log_write(LOG_WARNING, "virtio-blk: unusable queue size %u", size);
+    outportb(io + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+    return 0;
+  }
+
+  memset(queue, 0, sizeof(queue));
+  descriptors = (virtq_desc_t*)queue;
+  avail = (virtq_avail_t*)(queue + 16 * size);
+  used = (virtq_used_t*)(queue + VIRTQ_USED_OFFSET(size));
+
+  /* we poll for completions instead */
+  avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+  avail_next = 0;
+  used_seen = 0;
+
+  /* the descriptors of a slot are always chained the same way */
+  free_count = 0;
+  for (k = 0; k < size / DESCRIPTORS_PER_REQUEST; k++) {
+    d = k * DESCRIPTORS_PER_REQUEST;
+    descriptors[d].address = (uint32_t)&slots[k].header;
+    descriptors[d].length = sizeof(virtio_blk_header_t);
+    descriptors[d].flags = VIRTQ_DESC_F_NEXT;
+    descriptors[d].next = d + 1;
+    descriptors[d + 1].next = d + 2;
+    descriptors[d + 2].address = (uint32_t)&slots[k].status;
+    descriptors[d + 2].length = 1;
+    descriptors[d + 2].flags = VIRTQ_DESC_F_WRITE;
+    free_slots[free_count++] = k;
+  }
+
+  /* identity mapped, so the address is the physical one */
+  outportl(io + VIRTIO_QUEUE_ADDRESS, (uint32_t)queue >> PAGE_SHIFT);
+  outportb(io + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+  capacity = inportl(io + VIRTIO_BLK_CAPACITY) | ((uint64_t)inportl(io + VIRTIO_BLK_CAPACITY + 4) << 32);
+
+  log_write(LOG_INFO, "virtio-blk: %u KB at %02x:%02x.%u, queue of %u, %u requests in flight",
+    (uint32_t)(capacity / (1024 / VIRTIO_BLK_SECTOR)), device->bus, device->slot, device->function,
+    size, free_count);
+  return 1;
+}
+
+uint64_t virtio_blk_capacity()
+{
+  return capacity;
+}
+
+uint32_t virtio_blk_submit(virtio_blk_request_t* request)
+{
+  uint32_t k, d;
+
+  if (!free_count || !request->count) {
+    return 0;
+  }
+
+  k = free_slots[--free_count];
+  d = k * DESCRIPTORS_PER_REQUEST;
+
+  slots[k].header.type = request->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  slots[k].header.sector = request->sector;
+  slots[k].status = VIRTIO_BLK_PENDING;
+  slots[k].request = request;
+  request->status = VIRTIO_BLK_PENDING;
+
+  descriptors[d + 1].address = (uint32_t)request->buffer;
+  descriptors[d + 1].length = request->count * VIRTIO_BLK_SECTOR;
+  descriptors[d + 1].flags = VIRTQ_DESC_F_NEXT | (request->write ? 0 : VIRTQ_DESC_F_WRITE);
+
+  avail->ring[avail_next % size] = d;
+  avail_next++;
+  return 1;
+}
+
+void virtio_blk_notify()
+{
+  if (avail->index == avail_next) {
+    return;
+  }
+
+  /* the ring entries first, then the index that publishes them */
+  barrier();
+  avail->index = avail_next;
+
+  /* the device may be busy with the queue anyway, and say so */
+  memory_barrier();
+  if (!(used->flags & VIRTQ_USED_F_NO_NOTIFY)) {
+    outportw(io + VIRTIO_QUEUE_NOTIFY, 0);
+  }
+}
+
+uint32_t virtio_blk_complete()
+{
+  volatile virtq_used_element_t* element;
+  uint32_t completed = 0, k;
+
+  while (used_seen != used->index) {
+    barrier();
+    element = &used->ring[used_seen % size];
+    k = element->id / DESCRIPTORS_PER_REQUEST;
+
+    slots[k].request->status = slots[k].status;
+    free_slots[free_count++] = k;
+    used_seen++;
+    completed++;
+  }
+  return completed;
+}
+
+uint32_t virtio_blk_transfer(uint64_t sector, void* buffer, uint32_t count, uint8_t write)
+{
+  static virtio_blk_request_t requests[SLOTS];
+  uint32_t k, n, pending = 0, failed = 0;
+  virtio_blk_request_t* request;
+
+  if (!capacity || sector + count > capacity) {
+    return 0;
+  }
+
+  for (k = 0; k < SLOTS; k++) {
+    requests[k].status = VIRTIO_BLK_S_OK;
+  }
+
+  while (count || pending) {
+    /* queue as much as fits, then tell the device once */
+    for (k = 0; k < SLOTS && count; k++) {
+      request = &requests[k];
+      if (request->status == VIRTIO_BLK_PENDING) {
+        continue;
+      }
+      failed |= request->status != VIRTIO_BLK_S_OK;
+
+      n = count < VIRTIO_BLK_REQUEST_SECTORS ? count : VIRTIO_BLK_REQUEST_SECTORS;
+      request->sector = sector;
+      request->buffer = buffer;
+      request->count = n;
+      request->write = write;
+      if (!virtio_blk_submit(request)) {
+        break;
+      }
+
+      pending++;
+      sector += n;
+      buffer = (uint8_t*)buffer + n * VIRTIO_BLK_SECTOR;
+      count -= n;
+    }
+    virtio_blk_notify();
+
+    if (!virtio_blk_complete()) {
+      __asm__ __volatile__ ("pause");
+    }
+
+    /* counted rather than tracked, as completions may include others' requests */
+    pending = 0;
+    for (k = 0; k < SLOTS; k++) {
+      pending += requests[k].status == VIRTIO_BLK_PENDING;
+    }
+  }
+
+  for (k = 0; k < SLOTS; k++) {
+    failed |= requests[k].status != VIRTIO_BLK_S_OK;
+  }
+  return !failed;
+}
@@ -0,0 +1,55 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+
+#define VIRTIO_BLK_SECTOR 512
+
+/* the most sectors virtio_blk_transfer() puts in one request */
+#define VIRTIO_BLK_REQUEST_SECTORS 128
+
+/* request status, filled in by the device */
+#define VIRTIO_BLK_S_OK 0
+#define VIRTIO_BLK_S_IOERR 1
+#define VIRTIO_BLK_S_UNSUPP 2
+#define VIRTIO_BLK_PENDING 0xFF /* not completed yet */
+
+/*
+  One read or write. "buffer" is handed to the device as a physical
+  address, so it has to be in identity mapped kernel memory.
+ */
+typedef struct {
+  uint64_t sector;
+  void* buffer;
+  uint32_t count; /* sectors */
+  uint8_t write;
+  volatile uint8_t status; /* VIRTIO_BLK_PENDING until the device is done */
+} virtio_blk_request_t;
+
+/* finds and sets up the first legacy virtio block device; returns 0 without one */
+uint32_t init_virtio_blk();
+
+/* the size of the disk in sectors, 0 without one */
+uint64_t virtio_blk_capacity();
+
+/*
+  Queues a request without telling the device; returns 0 if the queue
+  is full. Any number of requests can be queued before one
+  virtio_blk_notify() hands them all to the device at once.
+ */
+uint32_t virtio_blk_submit(virtio_blk_request_t* request);
+
+/* makes the requests submitted so far visible to the device, and kicks it */
+void virtio_blk_notify();
+
+/* collects finished requests, setting their status; returns how many */
+uint32_t virtio_blk_complete();
+
+/*
+  Reads or writes "count" sectors from "sector" on, split into requests
+  of VIRTIO_BLK_REQUEST_SECTORS that are all in flight together, as far
+  as the queue allows. Waits for all of them; returns 0 on any error.
+ */
+uint32_t virtio_blk_transfer(uint64_t sector, void* buffer, uint32_t count, uint8_t write);
+
+#endif
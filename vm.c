@@ -0,0 +1,431 @@
+#include <vm.h>
+#include <paging.h>
+#include <frame.h>
+#include <interrupt.h>
+#include <process.h>
+#include <memory.h>
+#include <screen.h>
+#include <cpu.h>
+#include <pmc.h>
+#include <slab.h>
+#include <log.h>
+
+static PMC_REGION(copy_region, "copy-on-write");
+
+static vm_space_t kernel_space;
+static vm_space_t* current_space = &kernel_space;
+
+/* read faults on anonymous memory share this page until written to */
+static uint32_t zero_frame;
+
+static slab_cache_t spaces;
+
+static void page_fault(trap_frame_t* frame)
+{
+  uint32_t address = read_cr2();
+
+  if (vm_handle_fault(address, frame->error_code)) {
+    return;
+  }
+
+  if (trap_from_user(frame)) {
+    printstr("Segmentation fault at 0x");
+    printhl(address);
+    printstr(", eip 0x");
+    printhl(frame->eip);
+    printstr("\n");
+    process_exit(PROCESS_KILLED);
+  }
+
+  interrupt_unhandled(frame);
+}
+
+void init_vm()
+{
+  kernel_space.directory = paging_kernel_directory();
+  kernel_space.areas_used = 0;
+
+  zero_frame = frame_alloc_zeroed();
+  /* without it, creating an address space fails like out of memory */
+  if (!slab_cache_init(&spaces, sizeof(vm_space_t))) {
+    log_write(LOG_ERROR, "vm: address spaces of %u bytes are too big for a slab", (uint32_t)sizeof(vm_space_t));
+  }
+
+  interrupt_register(EXCEPTION_PAGE_FAULT, page_fault);
+}
+
+vm_space_t* vm_kernel_space()
+{
+  return &kernel_space;
+}
+
+vm_space_t* vm_current()
+{
+  return current_space;
+}
+
+void vm_switch(vm_space_t* space)
+{
+  if (space != current_space) {
+    current_space = space;
+    write_cr3((uint32_t)space->directory);
+  }
+}
+
+vm_space_t* vm_space_create()
+{
+  uint32_t i;
+  uint32_t* kernel_directory = paging_kernel_directory();
+
+  vm_space_t* space = slab_alloc(&spaces);
+  if (!space) {
+    return 0;
+  }
+
+  /* frames are identity mapped, so this is the physical address too */
+  space->directory = (uint32_t*)frame_alloc_zeroed();
+  if (!space->directory) {
+    slab_free(&spaces, space);
+    return 0;
+  }
+  space->areas_used = 0;
+
+  for (i = 0; i < PT_ENTRIES; i++) {
+    if (i < PD_INDEX(USER_BASE) || i >= PD_INDEX(USER_END)) {
+      space->directory[i] = kernel_directory[i];
+    }
+  }
+
+  return space;
+}
+
+vm_space_t* vm_space_clone(vm_space_t* parent)
+{
+  uint32_t i, j;
+  vm_space_t* child = vm_space_create();
+  if (!child) {
+    return 0;
+  }
+
+  child->areas_used = parent->areas_used;
+  memcpy((uint8_t*)child->areas, (uint8_t*)parent->areas, sizeof(parent->areas));
+
+  for (i = PD_INDEX(USER_BASE); i < PD_INDEX(USER_END); i++) {
+    if (!(parent->directory[i] & PTE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* parent_table = (uint32_t*)PTE_FRAME(parent->directory[i]);
+    uint32_t* child_table = (uint32_t*)frame_alloc_zeroed();
+    if (!child_table) {
+      vm_space_destroy(child);
+      return 0;
+    }
+
+    for (j = 0; j < PT_ENTRIES; j++) {
+      uint32_t entry = parent_table[j];
+      if (!(entry & PTE_PRESENT)) {
+        continue;
+      }
+
+      /* both sides get a read-only view, the first writer copies */
+      if (entry & PTE_WRITE) {
+        entry = (entry & ~PTE_WRITE) | PTE_COW;
+        parent_table[j] = entry;
+      }
+
+      frame_ref(PTE_FRAME(entry));
+      child_table[j] = entry;
+    }
+
+    child->directory[i] = (uint32_t)child_table | PTE_PRESENT | PTE_WRITE | PTE_USER;
+  }
+
+  /* the parent may have cached writable translations */
+  if (parent == current_space) {
+    write_cr3((uint32_t)parent->directory);
+  }
+
+  return child;
+}
+
+void vm_space_destroy(vm_space_t* space)
+{
+  uint32_t i, j;
+
+  for (i = PD_INDEX(USER_BASE); i < PD_INDEX(USER_END); i++) {
+    if (!(space->directory[i] & PTE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* table = (uint32_t*)PTE_FRAME(space->directory[i]);
+    for (j = 0; j < PT_ENTRIES; j++) {
+      if (table[j] & PTE_PRESENT) {
+        frame_unref(PTE_FRAME(table[j]));
+      }
+    }
+    frame_unref((uint32_t)table);
+  }
+
+  frame_unref((uint32_t)space->directory);
+  slab_free(&spaces, space);
+}
+
+static uint32_t vm_map(vm_space_t* space, uint32_t start, uint32_t size, uint32_t flags, vm_file_t* file, uint32_t offset)
+{
+  uint32_t i;
+  uint32_t end = start + size;
+
+  if ((start & ~PAGE_MASK) || (size & ~PAGE_MASK) || start < USER_BASE || end > USER_END || end <= start) {
+    return 0;
+  }
+
+  if (space->areas_used == VM_AREAS) {
+    return 0;
+  }
+
+  for (i = 0; i < space->areas_used; i++) {
+    if (start < space->areas[i].end && end > space->areas[i].start) {
+      return 0;
+    }
+  }
+
+  vm_area_t* area = &space->areas[space->areas_used++];
+  area->start = start;
+  area->end = end;
+  area->flags = flags;
+  area->file = file;
+  area->offset = offset;
+
+  return start;
+}
+
+uint32_t vm_map_anonymous(vm_space_t* space, uint32_t start, uint32_t size, uint32_t flags)
+{
+  return vm_map(space, start, size, flags, 0, 0);
+}
+
+uint32_t vm_map_file(vm_space_t* space, uint32_t start, uint32_t size, uint32_t flags, vm_file_t* file, uint32_t offset)
+{
+  return vm_map(space, start, size, flags, file, offset);
+}
+
+static void vm_memory_file_read(vm_file_t* file, uint32_t offset, uint8_t* page)
+{
+  uint32_t count = 0;
+
+  if (offset < file->size) {
+    count = file->size - offset;
+    if (count > PAGE_SIZE) {
+      count = PAGE_SIZE;
+    }
+    memcpy(page, file->data + offset, count);
+  }
+
+  memset(page + count, 0, PAGE_SIZE - count);
+}
+
+void vm_file_init_memory(vm_file_t* file, const uint8_t* data, uint32_t size)
+{
+  file->read = vm_memory_file_read;
+  file->data = data;
+  file->size = size;
+}
+
+static vm_area_t* vm_find_area(vm_space_t* space, uint32_t address)
+{
+  uint32_t i;
+  for (i = 0; i < space->areas_used; i++) {
+    if (address >= space->areas[i].start && address < space->areas[i].end) {
+      return &space->areas[i];
+    }
+  }
+  return 0;
+}
+
+/* a write to a present, copy-on-write page */
+static uint32_t vm_copy_on_write(uint32_t* pte, uint32_t page)
+{
+  uint32_t old = PTE_FRAME(*pte);
+
+  if (old != zero_frame && frame_refcount(old) == 1) {
+    /* everyone else has already taken their copy */
+    *pte = (*pte | PTE_WRITE) & ~PTE_COW;
+  } else {
+    uint32_t copy = (old == zero_frame) ? frame_alloc_zeroed() : frame_alloc();
+    if (!copy) {
+      return 0;
+    }
+    if (old != zero_frame) {
+      pmc_region_start(&copy_region);
+      memcpy((uint8_t*)copy, (uint8_t*)old, PAGE_SIZE);
+      pmc_region_stop(&copy_region);
+    }
+
+    *pte = copy | PTE_PRESENT | PTE_WRITE | PTE_USER;
+    frame_unref(old);
+  }
+
+  invlpg(page);
+  return 1;
+}
+
+uint32_t vm_handle_fault(uint32_t address, uint32_t error_code)
+{
+  vm_space_t* space = current_space;
+  uint32_t page = address & PAGE_MASK;
+  uint32_t frame, flags;
+
+  if (address < USER_BASE || address >= USER_END) {
+    return 0;
+  }
+
+  vm_area_t* area = vm_find_area(space, address);
+  if (!area) {
+    return 0;
+  }
+
+  if ((error_code & FAULT_WRITE) && !(area->flags & VM_WRITE)) {
+    return 0;
+  }
+
+  uint32_t* pte = paging_get_pte(space->directory, page, 1);
+  if (!pte) {
+    return 0;
+  }
+
+  if (error_code & FAULT_PRESENT) {
+    if ((error_code & FAULT_WRITE) && (*pte & PTE_COW)) {
+      return vm_copy_on_write(pte, page);
+    }
+    return 0;
+  }
+
+  flags = PTE_USER;
+  if (area->flags & VM_WRITE) {
+    flags |= PTE_WRITE;
+  }
+
+  if (area->file) {
+    frame = frame_alloc();
+    if (!frame) {
+      return 0;
+    }
+    area->file->read(area->file, area->offset + (page - area->start), (uint8_t*)frame);
+  } else if (error_code & FAULT_WRITE) {
+    frame = frame_alloc_zeroed();
+    if (!frame) {
+      return 0;
+    }
+  } else {
+    /* reading untouched anonymous memory costs no memory */
+    frame = zero_frame;
+    frame_ref(frame);
+    if (flags & PTE_WRITE) {
+      flags = (flags & ~PTE_WRITE) | PTE_COW;
+    }
+  }
+
+  return paging_map(space->directory, page, frame, flags);
+}
+
+static uint32_t vm_range_ok(vm_space_t* space, uint32_t address, uint32_t size)
+{
+  uint32_t end = address + size;
+
+  if (address < USER_BASE || end > USER_END || end < address) {
+    return 0;
+  }
+
+  /* every page in the range must belong to an area */
+  while (address < end) {
+    vm_area_t* area = vm_find_area(space, address);
+    if (!area) {
+      return 0;
+    }
+    address = area->end;
+  }
+
+  return 1;
+}
+
+uint32_t vm_user_range_ok(uint32_t address, uint32_t size)
+{
+  return vm_range_ok(current_space, address, size);
+}
+
+uint32_t vm_take_pages(vm_space_t* space, uint32_t start, uint32_t count, uint32_t* entries)
+{
+  uint32_t k, page, *pte;
+
+  if ((start & ~PAGE_MASK) || count > (USER_END - USER_BASE) >> PAGE_SHIFT ||
+      !vm_range_ok(space, start, count * PAGE_SIZE)) {
+    return 0;
+  }
+
+  for (k = 0; k < count; k++) {
+    page = start + k * PAGE_SIZE;
+    pte = paging_get_pte(space->directory, page, 0);
+
+    if (pte && (*pte & PTE_PRESENT)) {
+      entries[k] = *pte;
+      *pte = 0;
+      if (space == current_space) {
+        invlpg(page);
+      }
+    } else {
+      frame_ref(zero_frame);
+      entries[k] = zero_frame | PTE_PRESENT | PTE_USER | PTE_COW;
+    }
+  }
+
+  return 1;
+}
+
+uint32_t vm_give_pages(vm_space_t* space, uint32_t start, uint32_t count, const uint32_t* entries)
+{
+  uint32_t k, page, flags, *pte;
+  vm_area_t* area;
+
+  if ((start & ~PAGE_MASK) || count > (USER_END - USER_BASE) >> PAGE_SHIFT ||
+      !vm_range_ok(space, start, count * PAGE_SIZE)) {
+    vm_drop_pages(count, entries);
+    return 0;
+  }
+
+  for (k = 0; k < count; k++) {
+    page = start + k * PAGE_SIZE;
+    area = vm_find_area(space, page);
+    pte = paging_get_pte(space->directory, page, 1);
+    if (!pte) {
+      vm_drop_pages(count - k, entries + k);
+      return 0;
+    }
+
+    if (*pte & PTE_PRESENT) {
+      frame_unref(PTE_FRAME(*pte));
+    }
+
+    /* a writable entry had the frame to itself, and still does */
+    flags = PTE_PRESENT | PTE_USER;
+    if (area->flags & VM_WRITE) {
+      flags |= (entries[k] & PTE_WRITE) ? PTE_WRITE : PTE_COW;
+    }
+    *pte = PTE_FRAME(entries[k]) | flags;
+
+    if (space == current_space) {
+      invlpg(page);
+    }
+  }
+
+  return 1;
+}
+
+void vm_drop_pages(uint32_t count, const uint32_t* entries)
+{
+  uint32_t k;
+
+  for (k = 0; k < count; k++) {
+    frame_unref(PTE_FRAME(entries[k]));
+  }
+}
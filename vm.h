@@ -0,0 +1,112 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+
+/*
+  Virtual memory layout
+
+  0x00000000 - 0x3FFFFFFF  kernel, physical memory identity mapped,
+                           shared by all address spaces
+  0x40000000 - 0xBFFFFFFF  user space, private to each address space
+  0xC0000000 - 0xFFFFFFFF  kernel, shared by all address spaces
+
+  Kernel mappings are copied into an address space when it is created,
+  so any page tables for the kernel parts must exist before that.
+ */
+#define USER_BASE 0x40000000
+#define USER_END 0xC0000000
+
+#define VM_READ 0x1
+#define VM_WRITE 0x2
+
+#define VM_AREAS 16
+
+typedef struct vm_file vm_file_t;
+
+/* something pages can be faulted in from */
+struct vm_file {
+  /* fills "page" with the PAGE_SIZE bytes at "offset" */
+  void (*read)(vm_file_t* file, uint32_t offset, uint8_t* page);
+  const uint8_t* data;
+  uint32_t size;
+};
+
+/*
+  A range of user space. Nothing is mapped up front: anonymous areas
+  are zero-filled on first touch, and file areas are read in one page
+  at a time as they are touched. File mappings are private, writes are
+  never written back.
+ */
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+  uint32_t flags;
+  vm_file_t* file; /* 0 for anonymous memory */
+  uint32_t offset; /* of "start" in the file */
+} vm_area_t;
+
+typedef struct {
+  uint32_t* directory;
+  uint32_t areas_used;
+  vm_area_t areas[VM_AREAS];
+} vm_space_t;
+
+/* installs the page fault handler */
+void init_vm();
+
+/* an empty address space, only sharing the kernel mappings */
+vm_space_t* vm_space_create();
+
+/*
+  A copy-on-write clone of "space". Only the pages present in "space"
+  are touched; they are made read-only in both spaces and copied on the
+  first write to them.
+ */
+vm_space_t* vm_space_clone(vm_space_t* space);
+
+void vm_space_destroy(vm_space_t* space);
+
+vm_space_t* vm_kernel_space();
+vm_space_t* vm_current();
+
+/* makes "space" the active address space */
+void vm_switch(vm_space_t* space);
+
+/* returns "start", or 0 if the range is invalid or there are no more areas */
+uint32_t vm_map_anonymous(vm_space_t* space, uint32_t start, uint32_t size, uint32_t flags);
+uint32_t vm_map_file(vm_space_t* space, uint32_t start, uint32_t size, uint32_t flags, vm_file_t* file, uint32_t offset);
+
+/* a file backed by a buffer in kernel memory */
+void vm_file_init_memory(vm_file_t* file, const uint8_t* data, uint32_t size);
+
+/*
+  Resolves a fault on "address" in the current address space.
+  Returns non-zero if the access may be retried.
+ */
+uint32_t vm_handle_fault(uint32_t address, uint32_t error_code);
+
+/* non-zero if [address, address + size) is a mapped part of user space */
+uint32_t vm_user_range_ok(uint32_t address, uint32_t size);
+
+/*
+  Moving pages between address spaces without copying them: the pages
+  of "count" at "start" leave "space" as their page table entries, put
+  in "entries", and the range reads as zeroes again. Pages never
+  touched go as the shared zero page. Returns 0, taking nothing, unless
+  the range is mapped and page aligned.
+ */
+uint32_t vm_take_pages(vm_space_t* space, uint32_t start, uint32_t count, uint32_t* entries);
+
+/*
+  Maps pages taken by vm_take_pages() at "start" in "space", in place
+  of what was there, and writable (copy-on-write if shared) where the
+  area is. Returns 0, freeing the pages that could not be mapped,
+  unless the range is mapped and page aligned.
+ */
+uint32_t vm_give_pages(vm_space_t* space, uint32_t start, uint32_t count, const uint32_t* entries);
+
+/* frees pages taken by vm_take_pages() */
+void vm_drop_pages(uint32_t count, const uint32_t* entries);
+
+#endif
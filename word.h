@@ -0,0 +1,34 @@
+#ifndef WORD_H
+#define WORD_H
+
+#include <stdint.h>
+
+/*
+  For going through memory a word (4 bytes) at a time. The loads may be
+  unaligned, which x86 handles at little cost, but an aligned load never
+  crosses into the next page, so it cannot fault where a byte by byte
+  loop would not.
+ */
+#define WORD_ONES 0x01010101u
+#define WORD_HIGHS 0x80808080u
+
+typedef uint32_t word_t __attribute__((may_alias));
+typedef uint32_t unaligned_word_t __attribute__((may_alias, aligned(1)));
+
+/*
+  Non-zero if any byte of "x" is zero. Bytes above a zero byte may be
+  flagged as well, but never the ones below it, so the lowest flag is
+  always right.
+ */
+static inline uint32_t word_zero_bytes(uint32_t x)
+{
+  return (x - WORD_ONES) & ~x & WORD_HIGHS;
+}
+
+/* the first byte, in memory order, with a bit set in "mask", which must not be 0 */
+static inline uint32_t word_first_byte(uint32_t mask)
+{
+  return __builtin_ctz(mask) >> 3;
+}
+
+#endif